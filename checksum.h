@@ -0,0 +1,25 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stdint.h>
+
+/**
+* Checksum
+*
+* The CRC-32 (the one of zlib and PNG) that the journal and priority queue snapshots store to detect
+* torn or corrupt files. A checksum can be computed in pieces: updating the checksum of some bytes with
+* the bytes that follow them gives the checksum of all of them. The empty checksum, of no bytes, is
+* CHECKSUM_EMPTY. Safe to use from any number of threads at once.
+*
+* The following functions are available:
+*   checksumUpdate  - Extends a checksum with more bytes
+*/
+
+#define CHECKSUM_EMPTY 0U
+
+
+/* this function returns the checksum of the bytes checksum was computed over, followed by the size
+   bytes at bytes. checksumUpdate(CHECKSUM_EMPTY, bytes, size) is the checksum of those bytes alone */
+uint32_t checksumUpdate(uint32_t checksum, const void* bytes, int size);
+
+#endif //CHECKSUM_H
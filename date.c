@@ -1,4 +1,3 @@
-
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -13,25 +12,41 @@
 
 enum {JAN = 1, FEB, MAR, APR, MAY, JUN, JUL, AUG, SEP, OCT, NOV, DEC};
 
+/* a date is kept as its serial, so comparing and moving it are integer operations */
 struct Date_t{
-    unsigned int day;
-    unsigned int month;
-    int year;
+    DateSerial serial;
 };
 
+/* rounds the quotient down, also for negative serials */
+static int floorDivide(int dividend, int divisor){
+    int quotient = dividend / divisor;
+    if(dividend % divisor != 0 && dividend < 0){
+        quotient--;
+    }
+    return quotient;
+}
+
 
 Date dateCreate(int day, int month, int year){
     if ((day <= 0) || (day > 30) || (month <= 0) || (month > MONTH_NUM)){
         return NULL;
     }
+    if ((year < DATE_MIN_YEAR) || (year > DATE_MAX_YEAR)){
+        return NULL;
+    }
+    return dateCreateFromSerial((year * MONTH_NUM + (month - JAN)) * DAYS_IN_MONTH + (day - FIRST_DAY));
+}
+
+Date dateCreateFromSerial(DateSerial serial){
+    if ((serial < DATE_SERIAL_MIN) || (serial > DATE_SERIAL_MAX)){
+        return NULL;
+    }
     Date new_date = malloc(sizeof(*new_date));
     if (!new_date){
         return NULL;
     }
-    new_date->day = day;
-    new_date->month = month;
-    new_date->year = year;
-    return new_date;    
+    new_date->serial = serial;
+    return new_date;
 }
 
 void dateDestroy(Date date){
@@ -42,20 +57,31 @@ Date dateCopy(Date date){
     if (date == NULL){
         return NULL;
     }
-    return dateCreate(date->day, date->month, date->year);
+    return dateCreateFromSerial(date->serial);
 }
 
 bool dateGet(Date date, int* day, int* month, int* year){
-    if(day == NULL || month == NULL || year == NULL){
+    if(date == NULL){
         return false;
     }
-    if ((date->day <= 0) || (date->day > 30) || (date->month <= 0) || (date->month > MONTH_NUM)){
-        return false;
+    return dateSerialGet(date->serial, day, month, year);
+}
+
+DateSerial dateGetSerial(Date date){
+    if(date == NULL){
+        return 0;
     }
+    return date->serial;
+}
 
-    *day = date->day;
-    *month = date->month;
-    *year = date->year;
+bool dateSerialGet(DateSerial serial, int* day, int* month, int* year){
+    if(day == NULL || month == NULL || year == NULL){
+        return false;
+    }
+    int months = floorDivide(serial, DAYS_IN_MONTH);
+    *day = serial - months * DAYS_IN_MONTH + FIRST_DAY;
+    *year = floorDivide(months, MONTH_NUM);
+    *month = months - *year * MONTH_NUM + JAN;
     return true;
 }
 
@@ -64,33 +90,31 @@ int dateCompare(Date date1, Date date2){
     if (date1 == NULL || date2 == NULL){
         return 0;
     }
-    if (date1->year == date2->year){
-        if (date1->month == date2->month){
-            if (date1->day == date2->day){
-                return 0;
-            }
-            return date1->day > date2->day ? POS : NEG;
-        }
-        return date1->month > date2->month ? POS : NEG;
+    if (date1->serial == date2->serial){
+        return 0;
     }
-    return date1->year > date2->year ? POS : NEG;
+    return date1->serial > date2->serial ? POS : NEG;
 }
 
 void dateTick(Date date){
+    dateAddDays(date, 1);
+}
+
+void dateAddDays(Date date, int days){
     if(date == NULL){
         return;
     }
-    if(date->day == DAYS_IN_MONTH){
-        if (date->month == DEC){
-            date->day = FIRST_DAY;
-            date->month = JAN;
-            date->year++;
-            return;
-        }
-        date->day = FIRST_DAY;
-        date->month++;
-        return;
+    //a date moved past the first or the last date there can be stops there:
+    if(days >= 0){
+        date->serial = date->serial > DATE_SERIAL_MAX - days ? DATE_SERIAL_MAX : date->serial + days;
+    } else {
+        date->serial = date->serial < DATE_SERIAL_MIN - days ? DATE_SERIAL_MIN : date->serial + days;
     }
-    date->day++;
-    return;
-}
\ No newline at end of file
+}
+
+int dateDiffDays(Date date1, Date date2){
+    if (date1 == NULL || date2 == NULL){
+        return 0;
+    }
+    return date1->serial - date2->serial;
+}
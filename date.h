@@ -6,6 +6,20 @@
 /** Type for defining the date */
 typedef struct Date_t *Date;
 
+/**
+* Type for a date as a value: the number of days since 1.1.0, where every month has 30 days and every
+* year 12 months. Serials need no allocation, and compare and subtract like the dates they stand for.
+*/
+typedef int DateSerial;
+
+/** The range of years a date can be in, so that every serial fits in an int */
+#define DATE_MAX_YEAR 5965231
+#define DATE_MIN_YEAR (-DATE_MAX_YEAR)
+
+/** The serials of the first and the last date there can be */
+#define DATE_SERIAL_MIN (DATE_MIN_YEAR * 360)
+#define DATE_SERIAL_MAX (DATE_MAX_YEAR * 360 + 359)
+
 /**
 * dateCreate: Allocates a new date.
 *
@@ -18,6 +32,16 @@ typedef struct Date_t *Date;
 */
 Date dateCreate(int day, int month, int year);
 
+/**
+* dateCreateFromSerial: Allocates a new date from its serial.
+*
+* @param serial - the serial of the date.
+* @return
+* 	NULL - if allocation failed or serial is out of range.
+* 	A new Date in case of success.
+*/
+Date dateCreateFromSerial(DateSerial serial);
+
 /**
 * dateDestroy: Deallocates an existing Date.
 *
@@ -49,6 +73,30 @@ Date dateCopy(Date date);
 */
 bool dateGet(Date date, int* day, int* month, int* year);
 
+/**
+* dateGetSerial: Returns the serial of a date
+*
+* @param date - Target Date
+* @return
+* 	0 if a NULL was sent.
+* 	Otherwise the serial of the date.
+*/
+DateSerial dateGetSerial(Date date);
+
+/**
+* dateSerialGet: Returns the day, month and year of a date serial, without allocating a Date
+*
+* @param serial - the serial of the date.
+* @param day - the pointer to assign to day of the date into.
+* @param month - the pointer to assign to month of the date into.
+* @param year - the pointer to assign to year of the date into.
+*
+* @return
+* 	false if one of pointers is NULL.
+* 	Otherwise true and the date is assigned to the pointers.
+*/
+bool dateSerialGet(DateSerial serial, int* day, int* month, int* year);
+
 /**
 * dateCompare: compares to dates and return which comes first
 *
@@ -61,10 +109,32 @@ int dateCompare(Date date1, Date date2);
 
 /**
 * dateTick: increases the date by one day, if date is NULL should do nothing.
+* The last date there can be, DATE_SERIAL_MAX, stays as it is.
 *
 * @param date - Target Date
 *
 */
 void dateTick(Date date);
 
+/**
+* dateAddDays: moves the date by a number of days in O(1), if date is NULL should do nothing.
+*
+* @param date - Target Date
+* @param days - the number of days to move, back if negative. a date that would move past
+*   DATE_SERIAL_MIN or DATE_SERIAL_MAX stops there instead
+*
+*/
+void dateAddDays(Date date, int days);
+
+/**
+* dateDiffDays: returns the number of days from date2 to date1, in O(1). The dates have to be at most
+* INT_MAX days apart.
+*
+* @return
+* 		A negative integer if date1 occurs first;
+* 		0 if they're equal or one of the given dates is NULL;
+*		A positive integer if date1 arrives after date2.
+*/
+int dateDiffDays(Date date1, Date date2);
+
 #endif //DATE_H_
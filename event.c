@@ -2,14 +2,15 @@
 #include "priority_queue.h"
 #include "member.h"
 #include "date.h"
+#include "string_table.h"
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
 struct event_t{
     int event_id;
-    char* event_name;
-    Date event_date;
+    const char* event_name;  /* interned, so copies of an event share it */
+    DateSerial event_date;
     PriorityQueue event_members;  
 };
 
@@ -29,6 +30,10 @@ static bool memberEqualWrapper (PQElement member_1, PQElement member_2) {
     return memberEqual((Member)member_1, (Member)member_2);
 }
 
+static unsigned int memberHashWrapper (PQElement member) {
+    return (unsigned int)memberGetID((Member)member);
+}
+
 static PQElementPriority memberCopyPriorityWrapper(PQElementPriority member_priority){
     return (PQElementPriority)memberCopyPriority((MemberPriority)member_priority);
 }
@@ -51,7 +56,7 @@ static EventResult checkLegalEvent (Event event){
     if(event == NULL){
         return EVENT_NULL_ARGUMENT;
     }
-    if(event->event_name == NULL || event->event_date == NULL){
+    if(event->event_name == NULL){
         return EVENT_NULL_ARGUMENT;
     }
     if(event->event_id < 0){
@@ -61,43 +66,41 @@ static EventResult checkLegalEvent (Event event){
 }
 
 
-/* this function creates a new event, if NULL was sent, or illegal id - the function returns NULL.
-   needs to get a legal ID! */
-Event eventCreate(int event_id, char* event_name, Date date){
-    if (event_name == NULL || date == NULL){
-        return NULL;
-    }
-    assert(event_id >= 0);
-    
-    Event event = malloc(sizeof(*event));
+/* creates an event that takes over a reference to the interned name and the members queue.
+   releases both on failure */
+static Event eventCreateWith(int event_id, const char* event_name, DateSerial date, PriorityQueue event_members){
+    Event event = event_members == NULL ? NULL : malloc(sizeof(*event));
     if(event == NULL){
+        stringRelease(event_name);
+        pqDestroy(event_members);
         return NULL;
     }
-    
-    event->event_name = malloc(strlen(event_name) + 1);
-    if(event->event_name == NULL){
-        free(event);
-        return NULL;
-    }
-    strcpy(event->event_name, event_name);
+    event->event_id = event_id;
+    event->event_name = event_name;
+    event->event_date = date;
+    event->event_members = event_members;
+    return event;    
+}
+
 
-    event->event_date = dateCopy(date);
-    if(event->event_date == NULL){
-        free(event->event_name);
-        free(event);
+/* this function creates a new event, if NULL was sent, or illegal id - the function returns NULL.
+   needs to get a legal ID! */
+Event eventCreate(int event_id, char* event_name, DateSerial date, StringTable names){
+    if (event_name == NULL){
         return NULL;
     }
+    assert(event_id >= 0);
 
-    event->event_members = pqCreate(memberCopyWrapper, memberDestroyWrapper, memberEqualWrapper, memberCopyPriorityWrapper,
-                                      memberDestroyPriorityWrapper, memberComparePrioritiesWrapper);
-    if(event->event_members == NULL){
-        free(event->event_name);
-        dateDestroy(event->event_date);
-        free(event);
+    const char* interned_name = stringIntern(names, event_name);
+    if(interned_name == NULL){
         return NULL;
     }
-    event->event_id = event_id;
-    return event;    
+    PriorityQueue event_members = pqCreateIndexed(memberCopyWrapper, memberDestroyWrapper, memberEqualWrapper,
+                                                  memberHashWrapper, memberCopyPriorityWrapper,
+                                                  memberDestroyPriorityWrapper, memberComparePrioritiesWrapper);
+    /* copies of an event share its members until one of them links or unlinks a member */
+    pqSetCopyOnWrite(event_members, true);
+    return eventCreateWith(event_id, interned_name, date, event_members);
 }
 
 
@@ -109,24 +112,14 @@ Event eventCopy(Event event){
         return NULL;
     }
     
-    Event event_copy = eventCreate(event->event_id, event->event_name, event->event_date);
-    if(event_copy == NULL){
-        return NULL;
-    }
-    pqDestroy(event_copy->event_members);
-    event_copy->event_members = pqCopy(event->event_members);
-    if(event_copy->event_members == NULL){
-        eventDestroy(event_copy);
-        return NULL;
-    }
-    return event_copy;
+    return eventCreateWith(event->event_id, stringRetain(event->event_name), event->event_date,
+                           pqCopy(event->event_members));
 }
 
 
 /* this function de-allocate the event & the event's arguments */
 void eventDestroy(Event event){
-    free(event->event_name);
-    dateDestroy(event->event_date);
+    stringRelease(event->event_name);
     pqDestroy(event->event_members);
     free(event);
 }
@@ -138,33 +131,9 @@ bool eventEqual(Event event1, Event event2){
 }
 
 
-/* this function copies the priority */
-Date eventCopyPriority(Date event_priority){
-    Date date = dateCopy(event_priority);
-    return date;
-}
-
-
-/* this function de-allocates the event's priority */
-void eventDestroyPriority(Date event_priority){
-    dateDestroy(event_priority);
-    return;    
-}
-
-
-/* this function compare 2 priorities
-    if the first one is greater - returns 1
-    if the priorities are equal - returns 0
-    if the first one is less - returns -1*/
-int eventComparePriorities(Date event_priority1, Date event_priority2){
-    return (-1) * dateCompare(event_priority1, event_priority2);
-}
-
-
-
-Date eventGetPriority(Event event){
+DateSerial eventGetDate(Event event){
     if(event == NULL){
-        return NULL;
+        return 0;
     }
     return event->event_date;    
 }
@@ -174,7 +143,7 @@ char* eventGetName(Event event){
     if(event == NULL){
         return NULL;
     }
-    return event->event_name;
+    return (char*)event->event_name;
 }
 
 
@@ -186,16 +155,11 @@ int eventGetId(Event event){
 }
 
 
-EventResult eventChangeDate(Event event, Date new_date){
+EventResult eventChangeDate(Event event, DateSerial new_date){
     if(event == NULL){
         return EVENT_NULL_ARGUMENT;
     }
-    Date copy = dateCopy(new_date);
-    if(copy == NULL){
-        return EVENT_OUT_OF_MEMORY;
-    }
-    dateDestroy(event->event_date);
-    event->event_date = copy;
+    event->event_date = new_date;
     return EVENT_SUCCESS;
 }
 
@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include "date.h"
 #include "priority_queue.h"
+#include "string_table.h"
 
 
 
@@ -22,8 +23,9 @@ typedef enum event_result {
 } EventResult;
 
 
-/* this function creates a new event, if NULL was sent, or illegal id - the function returns NULL */
-Event eventCreate(int event_id, char* event_name, Date date);
+/* this function creates a new event on the date with the given serial, its name interned in names,
+   if NULL was sent, or illegal id - the function returns NULL */
+Event eventCreate(int event_id, char* event_name, DateSerial date, StringTable names);
 
 
 /* this function creates a new event containing the arguments of a specific event, a copy 
@@ -39,26 +41,12 @@ void eventDestroy(Event event);
 bool eventEqual(Event event1, Event event2);
 
 
-/* this function copies the priority */
-Date eventCopyPriority(Date event_priority);
+/* this function returns the serial of the event's date, 0 if NULL was sent */
+DateSerial eventGetDate(Event event);
 
 
-/* this function de-allocates the event's priority */
-void eventDestroyPriority(Date event_priority);
-
-
-/* this function compare 2 priorities
-    if the first one is greater - returns 1
-    if the priorities are equal - returns 0
-    if the first one is less - returns -1*/
-int eventComparePriorities(Date event_priority1, Date event_priority2);
-
-
-/* this function returns the event's priority (date) */
-Date eventGetPriority(Event event);
-
-
-/* this function returns the event's name*/
+/* this function returns the event's name. names are interned, so events with equal names return
+   the same pointer. the name must not be changed */
 char* eventGetName(Event event);
 
 
@@ -66,7 +54,8 @@ char* eventGetName(Event event);
 int eventGetId(Event event);
 
 
-EventResult eventChangeDate(Event event, Date new_date);
+/* this function moves the event to the date with the given serial */
+EventResult eventChangeDate(Event event, DateSerial new_date);
 
 
 PQElement eventGetPQ(Event);
@@ -0,0 +1,487 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <assert.h>
+#include "event_calendar.h"
+#include "event.h"
+#include "date.h"
+
+#define INITIAL_BUCKETS 16
+#define EXPAND_FACTOR 2
+#define NO_ITERATOR -1
+
+typedef struct calendar_entry_t {
+    Event event;
+    int day;
+    struct calendar_entry_t* previous_in_day_bucket;
+    struct calendar_entry_t* next_in_day_bucket;
+    struct calendar_entry_t* next_in_id_bucket;
+    struct calendar_entry_t* next_in_name_bucket;
+} *CalendarEntry;
+
+/* a day bucket holds the events of every day d with d & (bucket_count - 1) equal to its index,
+   sorted by day and in insertion order within the same day */
+typedef struct day_bucket_t {
+    CalendarEntry first;
+    CalendarEntry last;
+} DayBucket;
+
+struct EventCalendar_t {
+    DayBucket* days;
+    CalendarEntry* ids;
+    /* hashed by the event's interned name and its day, so a name is compared by its address */
+    CalendarEntry* names;
+    int bucket_count;
+    int size;
+
+    /* no event is earlier than this day, the search for the first event starts from it */
+    int earliest_day;
+
+    /* the entries sorted by date, built on demand for iteration */
+    CalendarEntry* order;
+    bool order_valid;
+    int iterator;
+};
+
+/*=========================================================================*/
+
+static int bucketOf(EventCalendar calendar, int key){
+    return (int)((unsigned int)key & (unsigned int)(calendar->bucket_count - 1));
+}
+
+static int nameBucketOf(EventCalendar calendar, const char* name, int day){
+    unsigned int hash = (unsigned int)((uintptr_t)name >> 4) * 31U + (unsigned int)day;
+    hash ^= hash >> 16;
+    hash *= 0x45D9F3BU;
+    hash ^= hash >> 16;
+    return bucketOf(calendar, (int)(hash & INT_MAX));
+}
+
+static void invalidateIteration(EventCalendar calendar){
+    calendar->iterator = NO_ITERATOR;
+    calendar->order_valid = false;
+}
+
+/* appends entry to its day bucket, after every entry of the same or an earlier day */
+static void linkDay(EventCalendar calendar, CalendarEntry entry){
+    DayBucket* bucket = &calendar->days[bucketOf(calendar, entry->day)];
+    CalendarEntry previous = bucket->last;
+    while(previous != NULL && previous->day > entry->day){
+        previous = previous->previous_in_day_bucket;
+    }
+    entry->previous_in_day_bucket = previous;
+    entry->next_in_day_bucket = previous == NULL ? bucket->first : previous->next_in_day_bucket;
+    if(previous == NULL){
+        bucket->first = entry;
+    }else{
+        previous->next_in_day_bucket = entry;
+    }
+    if(entry->next_in_day_bucket == NULL){
+        bucket->last = entry;
+    }else{
+        entry->next_in_day_bucket->previous_in_day_bucket = entry;
+    }
+    if(calendar->size == 0 || entry->day < calendar->earliest_day){
+        calendar->earliest_day = entry->day;
+    }
+}
+
+static void unlinkDay(EventCalendar calendar, CalendarEntry entry){
+    DayBucket* bucket = &calendar->days[bucketOf(calendar, entry->day)];
+    if(entry->previous_in_day_bucket == NULL){
+        bucket->first = entry->next_in_day_bucket;
+    }else{
+        entry->previous_in_day_bucket->next_in_day_bucket = entry->next_in_day_bucket;
+    }
+    if(entry->next_in_day_bucket == NULL){
+        bucket->last = entry->previous_in_day_bucket;
+    }else{
+        entry->next_in_day_bucket->previous_in_day_bucket = entry->previous_in_day_bucket;
+    }
+    entry->previous_in_day_bucket = NULL;
+    entry->next_in_day_bucket = NULL;
+}
+
+static void linkId(EventCalendar calendar, CalendarEntry entry){
+    CalendarEntry* bucket = &calendar->ids[bucketOf(calendar, eventGetId(entry->event))];
+    entry->next_in_id_bucket = *bucket;
+    *bucket = entry;
+}
+
+static void unlinkId(EventCalendar calendar, CalendarEntry entry){
+    CalendarEntry* link = &calendar->ids[bucketOf(calendar, eventGetId(entry->event))];
+    while(*link != entry){
+        assert(*link != NULL);
+        link = &(*link)->next_in_id_bucket;
+    }
+    *link = entry->next_in_id_bucket;
+    entry->next_in_id_bucket = NULL;
+}
+
+static void linkName(EventCalendar calendar, CalendarEntry entry){
+    CalendarEntry* bucket = &calendar->names[nameBucketOf(calendar, eventGetName(entry->event), entry->day)];
+    entry->next_in_name_bucket = *bucket;
+    *bucket = entry;
+}
+
+static void unlinkName(EventCalendar calendar, CalendarEntry entry){
+    CalendarEntry* link = &calendar->names[nameBucketOf(calendar, eventGetName(entry->event), entry->day)];
+    while(*link != entry){
+        assert(*link != NULL);
+        link = &(*link)->next_in_name_bucket;
+    }
+    *link = entry->next_in_name_bucket;
+    entry->next_in_name_bucket = NULL;
+}
+
+static CalendarEntry findEntry(EventCalendar calendar, int event_id){
+    CalendarEntry entry = calendar->ids[bucketOf(calendar, event_id)];
+    while(entry != NULL && eventGetId(entry->event) != event_id){
+        entry = entry->next_in_id_bucket;
+    }
+    return entry;
+}
+
+/* doubles the number of buckets once there are more events than buckets. entries are moved bucket by
+   bucket in their order, so every new day bucket stays sorted. a failed allocation only leaves the
+   buckets longer than they should be, so it is not reported */
+static void growIfNeeded(EventCalendar calendar){
+    if(calendar->size <= calendar->bucket_count){
+        return;
+    }
+    int new_count = calendar->bucket_count * EXPAND_FACTOR;
+    DayBucket* new_days = calloc(new_count, sizeof(*new_days));
+    CalendarEntry* new_ids = calloc(new_count, sizeof(*new_ids));
+    CalendarEntry* new_names = calloc(new_count, sizeof(*new_names));
+    if(new_days == NULL || new_ids == NULL || new_names == NULL){
+        free(new_days);
+        free(new_ids);
+        free(new_names);
+        return;
+    }
+    DayBucket* old_days = calendar->days;
+    int old_count = calendar->bucket_count;
+    free(calendar->ids);
+    free(calendar->names);
+    calendar->days = new_days;
+    calendar->ids = new_ids;
+    calendar->names = new_names;
+    calendar->bucket_count = new_count;
+    for(int i = 0; i < old_count; i++){
+        CalendarEntry entry = old_days[i].first;
+        while(entry != NULL){
+            CalendarEntry next = entry->next_in_day_bucket;
+            DayBucket* bucket = &calendar->days[bucketOf(calendar, entry->day)];
+            entry->previous_in_day_bucket = bucket->last;
+            entry->next_in_day_bucket = NULL;
+            if(bucket->last == NULL){
+                bucket->first = entry;
+            }else{
+                bucket->last->next_in_day_bucket = entry;
+            }
+            bucket->last = entry;
+            linkId(calendar, entry);
+            linkName(calendar, entry);
+            entry = next;
+        }
+    }
+    free(old_days);
+}
+
+/* returns the entry of the earliest event. scans one day per bucket from earliest_day: the first bucket
+   whose first entry falls on the scanned day holds the earliest event. if no bucket does within a full
+   round, the events are sparse and the first entries of all buckets are compared instead.
+   the round stops at DATE_SERIAL_MAX, as no event comes after it */
+static CalendarEntry findFirstEntry(EventCalendar calendar){
+    if(calendar->size == 0){
+        return NULL;
+    }
+    long long days_left = (long long)DATE_SERIAL_MAX - calendar->earliest_day + 1;
+    int scanned = days_left < calendar->bucket_count ? (int)days_left : calendar->bucket_count;
+    for(int i = 0; i < scanned; i++){
+        int day = calendar->earliest_day + i;
+        CalendarEntry first = calendar->days[bucketOf(calendar, day)].first;
+        if(first != NULL && first->day == day){
+            calendar->earliest_day = day;
+            return first;
+        }
+    }
+    CalendarEntry earliest = NULL;
+    for(int i = 0; i < calendar->bucket_count; i++){
+        CalendarEntry first = calendar->days[i].first;
+        if(first != NULL && (earliest == NULL || first->day < earliest->day)){
+            earliest = first;
+        }
+    }
+    assert(earliest != NULL);
+    calendar->earliest_day = earliest->day;
+    return earliest;
+}
+
+static void removeEntry(EventCalendar calendar, CalendarEntry entry){
+    unlinkDay(calendar, entry);
+    unlinkId(calendar, entry);
+    unlinkName(calendar, entry);
+    calendar->size--;
+    invalidateIteration(calendar);
+}
+
+/*=========================================================================*/
+
+EventCalendar calendarCreate(void){
+    EventCalendar calendar = malloc(sizeof(*calendar));
+    if(calendar == NULL){
+        return NULL;
+    }
+    calendar->days = calloc(INITIAL_BUCKETS, sizeof(*calendar->days));
+    calendar->ids = calloc(INITIAL_BUCKETS, sizeof(*calendar->ids));
+    calendar->names = calloc(INITIAL_BUCKETS, sizeof(*calendar->names));
+    if(calendar->days == NULL || calendar->ids == NULL || calendar->names == NULL){
+        free(calendar->days);
+        free(calendar->ids);
+        free(calendar->names);
+        free(calendar);
+        return NULL;
+    }
+    calendar->bucket_count = INITIAL_BUCKETS;
+    calendar->size = 0;
+    calendar->earliest_day = 0;
+    calendar->order = NULL;
+    calendar->order_valid = false;
+    calendar->iterator = NO_ITERATOR;
+    return calendar;
+}
+
+
+void calendarDestroy(EventCalendar calendar){
+    if(calendar == NULL){
+        return;
+    }
+    for(int i = 0; i < calendar->bucket_count; i++){
+        CalendarEntry entry = calendar->days[i].first;
+        while(entry != NULL){
+            CalendarEntry next = entry->next_in_day_bucket;
+            eventDestroy(entry->event);
+            free(entry);
+            entry = next;
+        }
+    }
+    free(calendar->days);
+    free(calendar->ids);
+    free(calendar->names);
+    free(calendar->order);
+    free(calendar);
+}
+
+
+int calendarGetSize(EventCalendar calendar){
+    if(calendar == NULL){
+        return -1;
+    }
+    return calendar->size;
+}
+
+
+CalendarResult calendarInsert(EventCalendar calendar, Event event){
+    if(calendar == NULL || event == NULL){
+        return CALENDAR_NULL_ARGUMENT;
+    }
+    if(findEntry(calendar, eventGetId(event)) != NULL){
+        return CALENDAR_EVENT_ID_ALREADY_EXISTS;
+    }
+    CalendarEntry entry = malloc(sizeof(*entry));
+    if(entry == NULL){
+        return CALENDAR_OUT_OF_MEMORY;
+    }
+    entry->event = event;
+    entry->day = eventGetDate(event);
+    linkDay(calendar, entry);
+    linkId(calendar, entry);
+    linkName(calendar, entry);
+    calendar->size++;
+    invalidateIteration(calendar);
+    growIfNeeded(calendar);
+    return CALENDAR_SUCCESS;
+}
+
+
+Event calendarFind(EventCalendar calendar, int event_id){
+    if(calendar == NULL){
+        return NULL;
+    }
+    CalendarEntry entry = findEntry(calendar, event_id);
+    return entry == NULL ? NULL : entry->event;
+}
+
+
+Event calendarFindByName(EventCalendar calendar, const char* interned_name, DateSerial date){
+    if(calendar == NULL || interned_name == NULL){
+        return NULL;
+    }
+    CalendarEntry entry = calendar->names[nameBucketOf(calendar, interned_name, date)];
+    while(entry != NULL && (entry->day != date || eventGetName(entry->event) != interned_name)){
+        entry = entry->next_in_name_bucket;
+    }
+    return entry == NULL ? NULL : entry->event;
+}
+
+
+CalendarResult calendarRemove(EventCalendar calendar, int event_id){
+    if(calendar == NULL){
+        return CALENDAR_NULL_ARGUMENT;
+    }
+    CalendarEntry entry = findEntry(calendar, event_id);
+    if(entry == NULL){
+        return CALENDAR_EVENT_NOT_EXISTS;
+    }
+    removeEntry(calendar, entry);
+    eventDestroy(entry->event);
+    free(entry);
+    return CALENDAR_SUCCESS;
+}
+
+
+CalendarResult calendarChangeDate(EventCalendar calendar, int event_id, DateSerial new_date){
+    if(calendar == NULL){
+        return CALENDAR_NULL_ARGUMENT;
+    }
+    CalendarEntry entry = findEntry(calendar, event_id);
+    if(entry == NULL){
+        return CALENDAR_EVENT_NOT_EXISTS;
+    }
+    eventChangeDate(entry->event, new_date);
+    invalidateIteration(calendar);
+    unlinkDay(calendar, entry);
+    unlinkName(calendar, entry);
+    entry->day = new_date;
+    linkDay(calendar, entry);
+    linkName(calendar, entry);
+    return CALENDAR_SUCCESS;
+}
+
+
+Event calendarPopFirst(EventCalendar calendar){
+    if(calendar == NULL){
+        return NULL;
+    }
+    CalendarEntry first = findFirstEntry(calendar);
+    if(first == NULL){
+        return NULL;
+    }
+    Event event = first->event;
+    removeEntry(calendar, first);
+    free(first);
+    return event;
+}
+
+
+int calendarRemoveBefore(EventCalendar calendar, DateSerial date, CalendarRemoveFunction remove, void* context){
+    if(calendar == NULL){
+        return -1;
+    }
+    if(calendar->size == 0 || date <= calendar->earliest_day){
+        return 0;
+    }
+    /* the events before date are at the front of their day buckets, and the buckets of the days from
+       earliest_day up to date are all the buckets there are once that span is bucket_count days long */
+    long long span = (long long)date - calendar->earliest_day;
+    int scanned = span < calendar->bucket_count ? (int)span : calendar->bucket_count;
+    int removed = 0;
+    for(int i = 0; i < scanned; i++){
+        DayBucket* bucket = &calendar->days[bucketOf(calendar, calendar->earliest_day + i)];
+        while(bucket->first != NULL && bucket->first->day < date){
+            CalendarEntry entry = bucket->first;
+            removeEntry(calendar, entry);
+            if(remove != NULL){
+                remove(entry->event, context);
+            }
+            eventDestroy(entry->event);
+            free(entry);
+            removed++;
+        }
+    }
+    calendar->earliest_day = date;
+    return removed;
+}
+
+
+/* fills calendar->order with every entry sorted by day. the entries are collected bucket by bucket and
+   merge sorted, which is stable, so entries of the same day keep their order in the bucket */
+static bool buildIterationOrder(EventCalendar calendar){
+    if(calendar->order_valid){
+        return true;
+    }
+    CalendarEntry* order = realloc(calendar->order, sizeof(*order) * calendar->size * 2);
+    if(order == NULL){
+        return false;
+    }
+    calendar->order = order;
+    CalendarEntry* source = order;
+    CalendarEntry* target = order + calendar->size;
+    int count = 0;
+    for(int i = 0; i < calendar->bucket_count; i++){
+        for(CalendarEntry entry = calendar->days[i].first; entry != NULL; entry = entry->next_in_day_bucket){
+            source[count++] = entry;
+        }
+    }
+    for(int width = 1; width < count; width *= 2){
+        for(int low = 0; low < count; low += 2 * width){
+            int middle = low + width < count ? low + width : count;
+            int high = low + 2 * width < count ? low + 2 * width : count;
+            int left = low, right = middle, out = low;
+            while(left < middle && right < high){
+                if(source[right]->day < source[left]->day){
+                    target[out++] = source[right++];
+                }else{
+                    target[out++] = source[left++];
+                }
+            }
+            while(left < middle){
+                target[out++] = source[left++];
+            }
+            while(right < high){
+                target[out++] = source[right++];
+            }
+        }
+        CalendarEntry* tmp = source;
+        source = target;
+        target = tmp;
+    }
+    for(int i = 0; source != order && i < count; i++){
+        order[i] = source[i];
+    }
+    calendar->order_valid = true;
+    return true;
+}
+
+
+Event calendarGetFirst(EventCalendar calendar){
+    if(calendar == NULL){
+        return NULL;
+    }
+    CalendarEntry first = findFirstEntry(calendar);
+    if(first == NULL){
+        return NULL;
+    }
+    /* the first entry is found without sorting, so the sort is deferred to calendarGetNext */
+    calendar->iterator = 0;
+    return first->event;
+}
+
+
+Event calendarGetNext(EventCalendar calendar){
+    if(calendar == NULL || calendar->iterator == NO_ITERATOR){
+        return NULL;
+    }
+    if(!buildIterationOrder(calendar)){
+        calendar->iterator = NO_ITERATOR;
+        return NULL;
+    }
+    calendar->iterator++;
+    if(calendar->iterator >= calendar->size){
+        calendar->iterator = NO_ITERATOR;
+        return NULL;
+    }
+    return calendar->order[calendar->iterator]->event;
+}
@@ -0,0 +1,100 @@
+#ifndef EVENT_CALENDAR_H
+#define EVENT_CALENDAR_H
+
+#include <stdbool.h>
+#include "date.h"
+#include "event.h"
+
+/**
+* Event Calendar
+*
+* Holds the events of an event manager, ordered by date and, within the same date, by the order they
+* were added or moved to it. Dates are whole days, so events are kept in a calendar queue: a ring of
+* day buckets indexed by the date serial, plus a hash from event id to event and a hash from
+* event name and day to event. Event names are interned, so the name hash compares them by address.
+* Adding, finding, moving and removing an event, and taking the next one, cost expected O(1).
+* The calendar owns its events and destroys them with eventDestroy.
+*/
+
+typedef struct EventCalendar_t *EventCalendar;
+
+/** Type of function calendarRemoveBefore passes every event it removes to, with the context given to it */
+typedef void(*CalendarRemoveFunction)(Event, void*);
+
+/** Type used for returning error codes from calendar functions */
+typedef enum CalendarResult_t {
+    CALENDAR_SUCCESS,
+    CALENDAR_OUT_OF_MEMORY,
+    CALENDAR_NULL_ARGUMENT,
+    CALENDAR_EVENT_NOT_EXISTS,
+    CALENDAR_EVENT_ID_ALREADY_EXISTS
+} CalendarResult;
+
+
+/* this function creates a new empty calendar, returns NULL if an allocation failed */
+EventCalendar calendarCreate(void);
+
+
+/* this function de-allocates the calendar and every event in it */
+void calendarDestroy(EventCalendar calendar);
+
+
+/* this function returns the number of events in the calendar, -1 if NULL was sent */
+int calendarGetSize(EventCalendar calendar);
+
+
+/* this function adds the event on its date, after the events already on that date.
+   on success the calendar owns the event, otherwise the caller still does */
+CalendarResult calendarInsert(EventCalendar calendar, Event event);
+
+
+/* this function returns the event with the given id, or NULL if there is none */
+Event calendarFind(EventCalendar calendar, int event_id);
+
+
+/* this function returns the event with the given name on the given date, or NULL if there is none.
+   the name is compared by address, so it has to be interned in the table the events' names are in,
+   see eventCreate. NULL, like a name that was never interned, finds nothing */
+Event calendarFindByName(EventCalendar calendar, const char* interned_name, DateSerial date);
+
+
+/* this function removes the event with the given id and de-allocates it */
+CalendarResult calendarRemove(EventCalendar calendar, int event_id);
+
+
+/* this function changes the date of the event with the given id. the event is considered as added
+   again, so it goes after the events already on the new date */
+CalendarResult calendarChangeDate(EventCalendar calendar, int event_id, DateSerial new_date);
+
+
+/* this function removes the first event of the calendar and returns it, the caller becomes its owner.
+   returns NULL if the calendar is empty */
+Event calendarPopFirst(EventCalendar calendar);
+
+
+/* this function removes every event before the date with the given serial, passing each one to remove,
+   if it is not NULL, before de-allocating it. the events are not passed in date order. costs
+   O(removed events) plus at most one step per day between the first event and the date.
+   returns the number of events removed, -1 if NULL was sent */
+int calendarRemoveBefore(EventCalendar calendar, DateSerial date, CalendarRemoveFunction remove, void* context);
+
+
+/* this function sets the internal iterator to the first event in the calendar and returns it */
+Event calendarGetFirst(EventCalendar calendar);
+
+
+/* this function advances the internal iterator to the next event and returns it, NULL at the end.
+   the iterator is undefined after the calendar is changed */
+Event calendarGetNext(EventCalendar calendar);
+
+
+/*!
+* Macro for iterating over the calendar's events in order.
+* Declares a new iterator for the loop.
+*/
+#define CALENDAR_FOREACH(iterator, calendar) \
+    for(Event iterator = calendarGetFirst(calendar) ; \
+        iterator ;\
+        iterator = calendarGetNext(calendar))
+
+#endif //EVENT_CALENDAR_H
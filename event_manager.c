@@ -1,27 +1,89 @@
 /*=========================================================================*/
 // Include files:
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <assert.h>
 #include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "priority_queue.h"
 #include "date.h"
 #include "event_manager.h"
 #include "member.h"
 #include "event.h"
+#include "event_calendar.h"
+#include "journal.h"
+#include "string_table.h"
 
 /*=========================================================================*/
 // Constants and definitions:
 #define NULL_VALUE -1
+#define SNAPSHOT_SUFFIX ".snapshot"
+#define LOG_SUFFIX ".log"
+#define REPORT_BUFFER_SIZE 65536
+#define INITIAL_REPORT_CAPACITY 4096
+#define EXPAND_FACTOR 2
+#define MAX_INT_CHARACTERS 11
+#define NO_FILE -1
+#define REPORT_FILE_MODE 0666
+#define INITIAL_EVENTS_NUM_BUCKETS 16
+#define NO_LIMIT -1
+#define INITIAL_MEMBER_SLOTS 16
+#define DENSE_IDS_FACTOR 4
+#define NO_DATE INT_MIN
+
+/* the members of members_pq by id, see the member id table below */
+typedef struct member_table_t {
+    Member* direct;
+    int direct_size;
+    Member* hashed;
+    int hashed_capacity;
+    int hashed_count;
+    int count;
+} MemberTable;
 
 struct EventManager_t {
-    Date system_date;
+    DateSerial system_date;
     PriorityQueue members_pq;
-    PriorityQueue events;
+    EventCalendar events;
+    MemberTable members_by_id;
+
+    //the names of the events and members, interned so events are found by name with pointer comparisons
+    //and copies of a member share its name:
+    StringTable names;
+
+    //durable event managers only, journal is NULL otherwise:
+    Journal journal;
+    char* snapshot_path;
+    int snapshot_interval;
+    int changes_since_snapshot;
+
+    //the buffer reports to file descriptors are formatted in, allocated by the first one:
+    char* report_buffer;
+
+    //the events count index, NULL until a report builds it:
+    PriorityQueue* members_by_events_num;
+    int events_num_buckets;
 };
 
+/* the changes a durable event manager logs. every record holds the type, two ids, a name and a date,
+   the ones a type does not use are 0, empty or 0.0.0 */
+typedef enum change_type_t {
+    CHANGE_ADD_EVENT,
+    CHANGE_REMOVE_EVENT,
+    CHANGE_EVENT_DATE,
+    CHANGE_ADD_MEMBER,
+    CHANGE_ADD_MEMBER_TO_EVENT,
+    CHANGE_REMOVE_MEMBER_FROM_EVENT,
+    CHANGE_TICK
+} ChangeType;
+
 
 static bool checkLegalMemberID(int id);
 
@@ -88,26 +150,20 @@ static EventManagerResult changePQResultToMemberResult(PriorityQueueResult resul
 }
 
 
-static bool checkLegalDate(Date date, Date system_date){
-    if(date == NULL || system_date == NULL){
+static bool checkLegalDate(Date date, DateSerial system_date){
+    if(date == NULL){
         return false;
     }
-    return (dateCompare(date, system_date) >= 0);
+    return (dateGetSerial(date) >= system_date);
 }
 
 static bool checkLegalEventID(int event_id){
     return (event_id >= 0);
 }
 
-//check
-static bool checkEventNameExist(PriorityQueue events, const char* name, Date date){
-    PQ_FOREACH(Event, iterator, events){
-        if ((strcmp(name, eventGetName(iterator)) == 0) &&
-                 (dateCompare(date, eventGetPriority(iterator)) == 0)){
-            return true;
-        }
-    }
-    return false;
+static bool checkEventNameExist(EventManager em, const char* name, DateSerial date){
+    //a name that was never interned is not the name of any event:
+    return calendarFindByName(em->events, stringFind(em->names, name), date) != NULL;
 }
 
 
@@ -129,6 +185,10 @@ static bool memberEqualWrapper (PQElement member_1, PQElement member_2) {
     return memberEqual((Member)member_1, (Member)member_2);
 }
 
+static unsigned int memberHashWrapper (PQElement member) {
+    return (unsigned int)memberGetID((Member)member);
+}
+
 static PQElementPriority memberCopyPriorityWrapper(PQElementPriority member_priority){
     return (PQElementPriority)memberCopyPriority((MemberPriority)member_priority);
 }
@@ -142,38 +202,468 @@ static int memberComparePrioritiesWrapper (PQElementPriority priority_1, PQEleme
     return memberComparePriorities ((MemberPriority)priority_1, (MemberPriority)priority_2);
 }
 
+//borrowed member wrappers, for queues that point to members of members_pq and are their own priority:
+static PQElement memberBorrowWrapper (PQElement member) {
+    return member;
+}
+
+static void memberForgetWrapper (PQElement member) {
+    (void)member;
+}
+
+static int memberCompareIDsWrapper (PQElementPriority member_1, PQElementPriority member_2){
+    int id_1 = memberGetID((Member)member_1);
+    int id_2 = memberGetID((Member)member_2);
+    return (id_1 < id_2) - (id_1 > id_2);
+}
+
+
+
+
+
+/*=========================================================================*/
+/* the member id table: ids below direct_size are kept directly in an array, which grows to cover a new
+   id only while it stays within DENSE_IDS_FACTOR times the number of members. other ids go to a hash
+   table with linear probing. members are never removed, so neither needs deletion */
+
+static void memberTableInit(MemberTable* table){
+    table->direct = NULL;
+    table->direct_size = 0;
+    table->hashed = NULL;
+    table->hashed_capacity = 0;
+    table->hashed_count = 0;
+    table->count = 0;
+}
+
+static void memberTableFree(MemberTable* table){
+    free(table->direct);
+    free(table->hashed);
+    memberTableInit(table);
+}
+
+static int hashSlotOf(const MemberTable* table, int member_id){
+    unsigned int hash = (unsigned int)member_id;
+    hash ^= hash >> 16;
+    hash *= 0x45D9F3BU;
+    hash ^= hash >> 16;
+    return (int)(hash & (unsigned int)(table->hashed_capacity - 1));
+}
+
+static Member memberTableFind(const MemberTable* table, int member_id){
+    if(member_id < 0){
+        return NULL;
+    }
+    if(member_id < table->direct_size && table->direct[member_id] != NULL){
+        return table->direct[member_id];
+    }
+    if(table->hashed_count == 0){
+        return NULL;
+    }
+    int mask = table->hashed_capacity - 1;
+    for(int slot = hashSlotOf(table, member_id); table->hashed[slot] != NULL; slot = (slot + 1) & mask){
+        if(memberGetID(table->hashed[slot]) == member_id){
+            return table->hashed[slot];
+        }
+    }
+    return NULL;
+}
+
+static void hashedPlace(MemberTable* table, Member member){
+    int mask = table->hashed_capacity - 1;
+    int slot = hashSlotOf(table, memberGetID(member));
+    while(table->hashed[slot] != NULL){
+        slot = (slot + 1) & mask;
+    }
+    table->hashed[slot] = member;
+}
+
+/* keeps the hash table at most half full */
+static bool hashedReserve(MemberTable* table){
+    if((table->hashed_count + 1) * EXPAND_FACTOR <= table->hashed_capacity){
+        return true;
+    }
+    int new_capacity = table->hashed_capacity > 0 ? table->hashed_capacity * EXPAND_FACTOR : INITIAL_MEMBER_SLOTS;
+    Member* new_hashed = calloc(new_capacity, sizeof(*new_hashed));
+    if(new_hashed == NULL){
+        return false;
+    }
+    Member* old_hashed = table->hashed;
+    int old_capacity = table->hashed_capacity;
+    table->hashed = new_hashed;
+    table->hashed_capacity = new_capacity;
+    for(int i = 0; i < old_capacity; i++){
+        if(old_hashed[i] != NULL){
+            hashedPlace(table, old_hashed[i]);
+        }
+    }
+    free(old_hashed);
+    return true;
+}
+
+/* grows the direct array to cover member_id if the ids would still be dense, returns false otherwise */
+static bool directCover(MemberTable* table, int member_id){
+    if(member_id < table->direct_size){
+        return true;
+    }
+    int dense_limit = (table->count + 1) * DENSE_IDS_FACTOR + INITIAL_MEMBER_SLOTS;
+    if(member_id >= dense_limit){
+        return false;
+    }
+    int new_size = table->direct_size > 0 ? table->direct_size * EXPAND_FACTOR : INITIAL_MEMBER_SLOTS;
+    if(new_size > dense_limit){
+        new_size = dense_limit;
+    }
+    if(new_size <= member_id){
+        new_size = member_id + 1;
+    }
+    Member* new_direct = realloc(table->direct, sizeof(*new_direct) * new_size);
+    if(new_direct == NULL){
+        return false;
+    }
+    for(int i = table->direct_size; i < new_size; i++){
+        new_direct[i] = NULL;
+    }
+    table->direct = new_direct;
+    table->direct_size = new_size;
+    return true;
+}
+
+/* adds a member whose id is not in the table yet. returns false if an allocation failed */
+static bool memberTableAdd(MemberTable* table, Member member){
+    int member_id = memberGetID(member);
+    if(directCover(table, member_id)){
+        table->direct[member_id] = member;
+    } else {
+        if(!hashedReserve(table)){
+            return false;
+        }
+        hashedPlace(table, member);
+        table->hashed_count++;
+    }
+    table->count++;
+    return true;
+}
 
+/*=========================================================================*/
+/* the events count index: members_by_events_num[n] holds the members that are linked to n events, for
+   every n > 0, so the responsible members report only visits the members it prints. the buckets hold
+   the members of members_pq themselves, ordered by id. the index is built by the first report that
+   needs it, and dropped if keeping it up to date fails, until the next report builds it again */
+
+static void dropEventsNumIndex(EventManager em){
+    for(int i = 0; i < em->events_num_buckets; i++){
+        pqDestroy(em->members_by_events_num[i]);
+    }
+    free(em->members_by_events_num);
+    em->members_by_events_num = NULL;
+    em->events_num_buckets = 0;
+}
+
+/* adds member to the bucket of its number of events, creating the bucket if needed */
+static bool indexMember(EventManager em, Member member){
+    int events_num = memberGetEventsNum(member);
+    if(events_num <= 0){
+        return true;
+    }
+    if(events_num >= em->events_num_buckets){
+        int new_count = em->events_num_buckets > 0 ? em->events_num_buckets : INITIAL_EVENTS_NUM_BUCKETS;
+        while(new_count <= events_num){
+            new_count *= EXPAND_FACTOR;
+        }
+        PriorityQueue* new_buckets = realloc(em->members_by_events_num, sizeof(*new_buckets) * new_count);
+        if(new_buckets == NULL){
+            return false;
+        }
+        for(int i = em->events_num_buckets; i < new_count; i++){
+            new_buckets[i] = NULL;
+        }
+        em->members_by_events_num = new_buckets;
+        em->events_num_buckets = new_count;
+    }
+    if(em->members_by_events_num[events_num] == NULL){
+        em->members_by_events_num[events_num] = pqCreateIndexed(memberBorrowWrapper,
+                                                                memberForgetWrapper,
+                                                                memberEqualWrapper,
+                                                                memberHashWrapper,
+                                                                memberBorrowWrapper,
+                                                                memberForgetWrapper,
+                                                                memberCompareIDsWrapper);
+        if(em->members_by_events_num[events_num] == NULL){
+            return false;
+        }
+    }
+    return pqInsert(em->members_by_events_num[events_num], member, member) == PQ_SUCCESS;
+}
+
+static bool buildEventsNumIndex(EventManager em){
+    em->members_by_events_num = malloc(sizeof(*em->members_by_events_num) * INITIAL_EVENTS_NUM_BUCKETS);
+    if(em->members_by_events_num == NULL){
+        return false;
+    }
+    em->events_num_buckets = INITIAL_EVENTS_NUM_BUCKETS;
+    for(int i = 0; i < em->events_num_buckets; i++){
+        em->members_by_events_num[i] = NULL;
+    }
+    //a cursor that could not be opened or advanced ends early, so the members are counted:
+    int indexed = 0;
+    PQ_FOREACH_CURSOR(Member, member, cursor, em->members_pq){
+        if(!indexMember(em, member)){
+            break;
+        }
+        indexed++;
+    }
+    if(indexed != pqGetSize(em->members_pq)){
+        dropEventsNumIndex(em);
+        return false;
+    }
+    return true;
+}
+
+/* changes the number of events of a member of members_pq, moving it between buckets of the index */
+static void changeEventsNum(EventManager em, Member member, int events_num){
+    int old_events_num = memberGetEventsNum(member);
+    if(em->members_by_events_num != NULL && old_events_num > 0 &&
+       pqRemoveElement(em->members_by_events_num[old_events_num], member) != PQ_SUCCESS){
+        dropEventsNumIndex(em);
+    }
+    memberChangeEventsNum(member, events_num);
+    if(em->members_by_events_num != NULL && !indexMember(em, member)){
+        dropEventsNumIndex(em);
+    }
+}
+
+/*=========================================================================*/
+/* durability: a durable event manager logs every change it made to its journal, and writes snapshots
+   of its whole state, see createDurableEventManager */
+
+static void putDate(JournalBuffer* buffer, DateSerial date){
+    int day = 0, month = 0, year = 0;
+    if(date != NO_DATE){
+        dateSerialGet(date, &day, &month, &year);
+    }
+    journalPutInt(buffer, day);
+    journalPutInt(buffer, month);
+    journalPutInt(buffer, year);
+}
 
+/* returns a new date read from reader, NULL if it could not be read or created */
+static Date getDate(JournalReader* reader){
+    int day = journalGetInt(reader);
+    int month = journalGetInt(reader);
+    int year = journalGetInt(reader);
+    return reader->failed ? NULL : dateCreate(day, month, year);
+}
 
+/* logs a change that is about to be made, if em is durable. returns EM_ERROR if it could not be logged,
+   and then the change must not be made. the caller checked before that the change cannot fail */
+static EventManagerResult logChange(EventManager em, ChangeType type, int first_id, int second_id,
+                                    const char* name, DateSerial date){
+    if(em->journal == NULL){
+        return EM_SUCCESS;
+    }
+    JournalBuffer record;
+    journalBufferInit(&record);
+    journalPutInt(&record, type);
+    journalPutInt(&record, first_id);
+    journalPutInt(&record, second_id);
+    journalPutString(&record, name == NULL ? "" : name);
+    putDate(&record, date);
+    bool logged = journalAppend(em->journal, &record);
+    journalBufferFree(&record);
+    return logged ? EM_SUCCESS : EM_ERROR;
+}
 
-/*=========================*/
-//event wrappers:
-static PQElement eventCopyWrapper (PQElement event) {
-    return (void*)eventCopy((Event)event);
+/* counts a logged change that was made, taking the periodic snapshot when it is due. the change is
+   already safe in the log, so a failed snapshot is only tried again after the next change */
+static EventManagerResult changeMade(EventManager em){
+    if(em->journal == NULL){
+        return EM_SUCCESS;
+    }
+    em->changes_since_snapshot++;
+    if(em->snapshot_interval > 0 && em->changes_since_snapshot >= em->snapshot_interval){
+        emCheckpoint(em);
+    }
+    return EM_SUCCESS;
 }
 
-static void eventDestroyWrapper (PQElement event) {
-    eventDestroy((Event)event);
+/* the state after the change with the given LSN: the system date, the members with their number of
+   events, and the events in calendar order, each with the ids of its members */
+static void encodeSnapshot(EventManager em, unsigned long long lsn, JournalBuffer* content){
+    journalPutLong(content, lsn);
+    putDate(content, em->system_date);
+    journalPutInt(content, pqGetSize(em->members_pq));
+    PQ_FOREACH_CURSOR(Member, member, members_cursor, em->members_pq){
+        journalPutInt(content, memberGetID(member));
+        journalPutString(content, memberGetName(member));
+        journalPutInt(content, memberGetEventsNum(member));
+    }
+    journalPutInt(content, calendarGetSize(em->events));
+    CALENDAR_FOREACH(event, em->events){
+        journalPutInt(content, eventGetId(event));
+        journalPutString(content, eventGetName(event));
+        putDate(content, eventGetDate(event));
+        PriorityQueue linked_members = eventGetPQ(event);
+        journalPutInt(content, pqGetSize(linked_members));
+        PQ_FOREACH_CURSOR(Member, member, linked_cursor, linked_members){
+            journalPutInt(content, memberGetID(member));
+        }
+    }
 }
 
-static bool eventEqualWrapper (PQElement event_1, PQElement event_2) {
-    return eventEqual((Event)event_1, (Event)event_2);
+/* adds the snapshot's members to em */
+static bool restoreMembers(EventManager em, JournalReader* content, int member_count){
+    for(int i = 0; i < member_count; i++){
+        int member_id = journalGetInt(content);
+        const char* name = journalGetString(content);
+        int events_num = journalGetInt(content);
+        if(content->failed){
+            return false;
+        }
+        Member member = memberCreate(member_id, (char*)name, em->names);
+        MemberPriority priority = memberCopyPriority(&member_id);
+        if(member == NULL || priority == NULL || pqInsertTake(em->members_pq, member, priority) != PQ_SUCCESS){
+            memberDestroy(member);
+            memberDestroyPriority(priority);
+            return false;
+        }
+        memberChangeEventsNum(member, events_num);
+        if(!memberTableAdd(&em->members_by_id, member)){
+            return false;
+        }
+    }
+    return true;
 }
 
-static PQElementPriority eventCopyPriorityWrapper(PQElementPriority event_priority){
-    return (PQElementPriority)eventCopyPriority((Date)event_priority);
+/* adds the snapshot's events to em, in the calendar order they were saved in, and links their members.
+   no legality check is repeated, the snapshot was taken from a legal state */
+static bool restoreEvents(EventManager em, JournalReader* content){
+    int event_count = journalGetInt(content);
+    for(int i = 0; i < event_count && !content->failed; i++){
+        int event_id = journalGetInt(content);
+        const char* name = journalGetString(content);
+        Date date = getDate(content);
+        Event event = date == NULL ? NULL : eventCreate(event_id, (char*)name, dateGetSerial(date), em->names);
+        dateDestroy(date);
+        if(event == NULL || calendarInsert(em->events, event) != CALENDAR_SUCCESS){
+            eventDestroy(event);
+            return false;
+        }
+        int linked_count = journalGetInt(content);
+        for(int j = 0; j < linked_count && !content->failed; j++){
+            int member_id = journalGetInt(content);
+            Member member = memberTableFind(&em->members_by_id, member_id);
+            if(member == NULL || pqInsert(eventGetPQ(event), member, &member_id) != PQ_SUCCESS){
+                return false;
+            }
+        }
+    }
+    return !content->failed;
 }
 
-// typedef void(*FreePQElementPriority)(PQElementPriority);
-static void eventDestroyPriorityWrapper (PQElementPriority priority){
-    eventDestroyPriority ((Date)priority);
+/* returns a new event manager holding the state of a snapshot, and the LSN of its last change */
+static EventManager decodeSnapshot(JournalReader* content, unsigned long long* lsn){
+    *lsn = journalGetLong(content);
+    Date system_date = getDate(content);
+    int member_count = journalGetInt(content);
+    if(system_date == NULL || member_count < 0){
+        dateDestroy(system_date);
+        return NULL;
+    }
+    EventManager em = createEventManager(system_date);
+    dateDestroy(system_date);
+    if(em == NULL || !restoreMembers(em, content, member_count) || !restoreEvents(em, content)){
+        destroyEventManager(em);
+        return NULL;
+    }
+    return em;
 }
 
+typedef struct replay_t {
+    EventManager em;
+    bool destroyed;
+} Replay;
+
+/* makes a logged change again. it succeeded when it was logged, so it has to succeed again */
+static bool replayChange(JournalReader* record, void* context){
+    Replay* replay = context;
+    ChangeType type = journalGetInt(record);
+    int first_id = journalGetInt(record);
+    int second_id = journalGetInt(record);
+    char* name = (char*)journalGetString(record);
+    Date date = getDate(record);
+    if(record->failed){
+        return false;
+    }
+    EventManagerResult result = EM_ERROR;
+    switch(type){
+        case CHANGE_ADD_EVENT:
+            result = emAddEventByDate(replay->em, name, date, first_id);
+            break;
+        case CHANGE_REMOVE_EVENT:
+            result = emRemoveEvent(replay->em, first_id);
+            break;
+        case CHANGE_EVENT_DATE:
+            result = emChangeEventDate(replay->em, first_id, date);
+            break;
+        case CHANGE_ADD_MEMBER:
+            result = emAddMember(replay->em, name, first_id);
+            break;
+        case CHANGE_ADD_MEMBER_TO_EVENT:
+            result = emAddMemberToEvent(replay->em, first_id, second_id);
+            break;
+        case CHANGE_REMOVE_MEMBER_FROM_EVENT:
+            result = emRemoveMemberFromEvent(replay->em, first_id, second_id);
+            break;
+        case CHANGE_TICK:
+            result = emTick(replay->em, first_id);
+            break;
+        default:
+            break;
+    }
+    dateDestroy(date);
+    //event manager functions destroy the event manager when they run out of memory:
+    replay->destroyed = result == EM_OUT_OF_MEMORY;
+    return result == EM_SUCCESS;
+}
 
-static int eventComparePrioritiesWrapper (PQElementPriority priority_1, PQElementPriority priority_2){
-    return eventComparePriorities ((Date)priority_1, (Date)priority_2);
+/* returns path followed by suffix in a new string */
+static char* pathWithSuffix(const char* path, const char* suffix){
+    char* result = malloc(strlen(path) + strlen(suffix) + 1);
+    if(result != NULL){
+        strcpy(result, path);
+        strcat(result, suffix);
+    }
+    return result;
 }
 
+/* returns the event manager of the snapshot and log, or a new one on date if there is no snapshot.
+   snapshot_exists tells which, and last_lsn receives the LSN of the last change it holds */
+static EventManager recoverEventManager(Date date, const char* snapshot_path, const char* log_path,
+                                       bool* snapshot_exists, unsigned long long* last_lsn){
+    JournalBuffer content;
+    journalBufferInit(&content);
+    bool loaded = journalReadSnapshot(snapshot_path, &content, snapshot_exists);
+    EventManager em = NULL;
+    unsigned long long snapshot_lsn = 0;
+    if(loaded){
+        JournalReader reader = {content.bytes, content.size, 0, false};
+        em = decodeSnapshot(&reader, &snapshot_lsn);
+    } else if(!*snapshot_exists){
+        em = createEventManager(date);
+    }
+    journalBufferFree(&content);
+    if(em == NULL){
+        return NULL;
+    }
+    Replay replay = {em, false};
+    if(!journalReplay(log_path, snapshot_lsn, replayChange, &replay, last_lsn)){
+        if(!replay.destroyed){
+            destroyEventManager(em);
+        }
+        return NULL;
+    }
+    return em;
+}
 
 /*=========================================================================*/
 
@@ -186,36 +676,37 @@ EventManager createEventManager(Date date){
     if(event_manager == NULL){
         return NULL;
     }
-    event_manager->system_date = dateCopy(date);
-    if(event_manager->system_date == NULL){
-        free(event_manager);
-        return NULL;
-    }
-    event_manager->members_pq = pqCreate (memberCopyWrapper,
+    event_manager->system_date = dateGetSerial(date);
+    event_manager->members_pq = pqCreateIndexed (memberCopyWrapper,
                                           memberDestroyWrapper,
                                           memberEqualWrapper,
+                                          memberHashWrapper,
                                           memberCopyPriorityWrapper,
                                           memberDestroyPriorityWrapper,
                                           memberComparePrioritiesWrapper);
 
 
     if (event_manager->members_pq == NULL){
-        dateDestroy (event_manager->system_date);
         free(event_manager);
         return NULL;
     }
-    event_manager->events = pqCreate (eventCopyWrapper,
-                                      eventDestroyWrapper,
-                                      eventEqualWrapper,
-                                      eventCopyPriorityWrapper,
-                                      eventDestroyPriorityWrapper,
-                                      eventComparePrioritiesWrapper);
-    if(event_manager->events == NULL){
-        dateDestroy (event_manager->system_date);
+    event_manager->events = calendarCreate();
+    event_manager->names = stringTableCreate();
+    if(event_manager->events == NULL || event_manager->names == NULL){
+        calendarDestroy(event_manager->events);
+        stringTableDestroy(event_manager->names);
         pqDestroy(event_manager->members_pq);
         free(event_manager);
         return NULL;
     }
+    event_manager->journal = NULL;
+    event_manager->snapshot_path = NULL;
+    event_manager->snapshot_interval = 0;
+    event_manager->changes_since_snapshot = 0;
+    event_manager->report_buffer = NULL;
+    event_manager->members_by_events_num = NULL;
+    event_manager->events_num_buckets = 0;
+    memberTableInit(&event_manager->members_by_id);
     return event_manager;
 }
 
@@ -225,118 +716,99 @@ void destroyEventManager(EventManager em){
     if (em == NULL){
         return;
     }
-    dateDestroy(em->system_date);    
     pqDestroy(em->members_pq);
-    pqDestroy(em->events);
+    calendarDestroy(em->events);
+    stringTableDestroy(em->names);
+    journalClose(em->journal);
+    free(em->snapshot_path);
+    free(em->report_buffer);
+    dropEventsNumIndex(em);
+    memberTableFree(&em->members_by_id);
     free(em);
     return;
 }
 
 
 
-EventManagerResult emAddEventByDate(EventManager em, char* event_name, Date date, int event_id){
-
-    if(em == NULL || event_name == NULL || date == NULL){
-        return EM_NULL_ARGUMENT;
-    }
-    if(checkLegalDate(date, em->system_date) == false){
-        return EM_INVALID_DATE;
-    }
+/* adds an event on a date that was checked to be legal, without allocating a Date for it */
+static EventManagerResult addEventOnDate(EventManager em, char* event_name, DateSerial date, int event_id){
     if (checkLegalEventID(event_id) == false){
         return EM_INVALID_EVENT_ID;
     }
-    if(checkEventNameExist(em->events, event_name, date)){
+    if(checkEventNameExist(em, event_name, date)){
         return EM_EVENT_ALREADY_EXISTS;
     }
+    if(calendarFind(em->events, event_id) != NULL){
+        return EM_EVENT_ID_ALREADY_EXISTS;
+    }
     
 
-    Event event = eventCreate(event_id, event_name, date);
+    Event event = eventCreate(event_id, event_name, date, em->names);
     if(event == NULL){
         destroyEventManager(em);
         return EM_OUT_OF_MEMORY;
     }
-    if(pqContains(em->events, event)){
+    if(logChange(em, CHANGE_ADD_EVENT, event_id, 0, event_name, date) != EM_SUCCESS){
         eventDestroy(event);
-        return EM_EVENT_ID_ALREADY_EXISTS;
+        return EM_ERROR;
     }
-    PriorityQueueResult result = pqInsert(em->events, event, date);
-    eventDestroy(event);
-    if(result == PQ_OUT_OF_MEMORY){
+    //the calendar adopts the new event instead of copying it:
+    if(calendarInsert(em->events, event) != CALENDAR_SUCCESS){
+        eventDestroy(event);
         destroyEventManager(em);
         return EM_OUT_OF_MEMORY;
     }
-    return changePQResultToEventResult(result);
+    return changeMade(em);
 }
 
-static Date createDateByDifference (Date date, int days){
-    if (date == NULL){
-        return NULL;
-    } 
-    Date date_copy = dateCopy(date);
-    if (date_copy == NULL){
-        return NULL;
+EventManagerResult emAddEventByDate(EventManager em, char* event_name, Date date, int event_id){
+
+    if(em == NULL || event_name == NULL || date == NULL){
+        return EM_NULL_ARGUMENT;
     }
-    assert(days >= 0);
-    for(int i = 0; i < days; i++){
-        dateTick(date_copy);
+    if(checkLegalDate(date, em->system_date) == false){
+        return EM_INVALID_DATE;
     }
-    return date_copy;
+    return addEventOnDate(em, event_name, dateGetSerial(date), event_id);
+}
+
+//days is not negative:
+static bool checkDaysFit(DateSerial date, int days){
+    return days <= DATE_SERIAL_MAX - date;
 }
 
 EventManagerResult emAddEventByDiff(EventManager em, char* event_name, int days, int event_id){
     if(em == NULL || event_name == NULL){
         return EM_NULL_ARGUMENT;
     }
-    if(days < 0){
+    if(days < 0 || !checkDaysFit(em->system_date, days)){
         return EM_INVALID_DATE;
-    }   
-    Date date = createDateByDifference(em->system_date, days);
-    if(date == NULL){
-        destroyEventManager(em);
-        return EM_OUT_OF_MEMORY;
     }
-    
-    EventManagerResult result = emAddEventByDate(em, event_name, date, event_id);
-    dateDestroy(date);
-    return result;
+    return addEventOnDate(em, event_name, em->system_date + days, event_id);
 }
 
-static Member getMemberByID(PriorityQueue members_pq, int member_id){
+static Member getMemberByID(EventManager em, int member_id){
     //legality checks:
-    if(members_pq == NULL){
-        return NULL;
-    }
     if(!checkLegalMemberID(member_id)){
         return NULL;
     }
-    //get the member:
-    PQ_FOREACH(Member, iterator, members_pq){
-        if(memberGetID(iterator) == member_id){
-            return iterator;
-        }
-    }
-    return NULL;
+    return memberTableFind(&em->members_by_id, member_id);
 }
 
 //memberChangeEventsNum
-static void removeLinkedMembersEventsNum(PriorityQueue members_pq, PriorityQueue members_linkes_to_event){
+static void removeLinkedMembersEventsNum(EventManager em, PriorityQueue members_linkes_to_event){
     Member tmp;
-    PQ_FOREACH(Member, iterator, members_linkes_to_event){
-        tmp = getMemberByID(members_pq, memberGetID(iterator));
-        memberChangeEventsNum(tmp, memberGetEventsNum(tmp) - 1);
+    PQ_FOREACH_CURSOR(Member, iterator, cursor, members_linkes_to_event){
+        tmp = getMemberByID(em, memberGetID(iterator));
+        changeEventsNum(em, tmp, memberGetEventsNum(tmp) - 1);
     }
 }
 
-static Event getEventByID(PriorityQueue events, int id){
+static Event getEventByID(EventCalendar events, int id){
     if(events == NULL){
         return NULL;
     }
-    PQ_FOREACH(Event, iterator, events){
-        if(eventGetId(iterator) == id){
-           return iterator;
-        }
-    }
-    return NULL;
+    return calendarFind(events, id);
 } 
 
 EventManagerResult emRemoveEvent(EventManager em, int event_id){
@@ -351,29 +823,18 @@ EventManagerResult emRemoveEvent(EventManager em, int event_id){
         return EM_EVENT_NOT_EXISTS;
     }
   
-    removeLinkedMembersEventsNum(em->members_pq, eventGetPQ(event));
-    PriorityQueueResult result = pqRemoveElement(em->events, event);
-    return changePQResultToEventResult(result);
+    if(logChange(em, CHANGE_REMOVE_EVENT, event_id, 0, NULL, NO_DATE) != EM_SUCCESS){
+        return EM_ERROR;
+    }
+    removeLinkedMembersEventsNum(em, eventGetPQ(event));
+    calendarRemove(em->events, event_id);
+    return changeMade(em);
 }
 
 
 
-static Date getDateByEventID(PriorityQueue events, int id){
-    if(events == NULL){
-        return NULL;
-    }
-    Event event = getEventByID(events, id);
-    return eventGetPriority(event);
-}
-
-static Event getEventByNameAndDate(PriorityQueue events, Date date, char* event_name){
-    PQ_FOREACH(Event, iterator, events){
-        if((strcmp(eventGetName(iterator), event_name) == 0) && 
-                (dateCompare(date, eventGetPriority(iterator)) == 0)){
-                    return iterator;
-                }
-    }
-    return NULL;  
+static Event getEventByNameAndDate(EventCalendar events, DateSerial date, char* event_name){
+    return calendarFindByName(events, event_name, date);
 }
 
 //need to checkif event exist in the same date
@@ -393,31 +854,19 @@ EventManagerResult emChangeEventDate(EventManager em, int event_id, Date new_dat
     if(event == NULL){
         return EM_EVENT_ID_NOT_EXISTS;
     }
-    Date old_date = getDateByEventID(em->events, event_id);
-
     //check if event with this name is already in destination date:
-    Event check_new_date = getEventByNameAndDate(em->events, new_date, eventGetName(event));
+    Event check_new_date = getEventByNameAndDate(em->events, dateGetSerial(new_date), eventGetName(event));
     if(check_new_date != NULL){
         return EM_EVENT_ALREADY_EXISTS;
     }
 
 
-    //change priority:
-    PriorityQueueResult priority_result = pqChangePriority(em->events, event, old_date, new_date);
-    if(priority_result == PQ_OUT_OF_MEMORY){
-        destroyEventManager(em);
-        return EM_OUT_OF_MEMORY;
-    }
-
-    //change event date:
-    event = getEventByID(em->events, event_id);
-    EventResult event_result = eventChangeDate(event, new_date);
-    if(event_result == EVENT_OUT_OF_MEMORY){
-        destroyEventManager(em);
-        return EM_OUT_OF_MEMORY;
+    if(logChange(em, CHANGE_EVENT_DATE, event_id, 0, NULL, dateGetSerial(new_date)) != EM_SUCCESS){
+        return EM_ERROR;
     }
-
-    return changePQResultToEventResult(priority_result);
+    //move the event to its new date:
+    calendarChangeDate(em->events, event_id, dateGetSerial(new_date));
+    return changeMade(em);
 }
 
 
@@ -428,22 +877,39 @@ EventManagerResult emAddMember(EventManager em, char* member_name, int member_id
     if(member_id < 0){
         return EM_INVALID_MEMBER_ID;
     }
-    Member member = memberCreate(member_id, member_name);
+    if(getMemberByID(em, member_id) != NULL){
+        return EM_MEMBER_ID_ALREADY_EXISTS;
+    }
+    Member member = memberCreate(member_id, member_name, em->names);
     if(member == NULL){
         destroyEventManager(em);
         return EM_OUT_OF_MEMORY;        
     }
-    if (pqContains(em->members_pq, member)){
+
+    MemberPriority priority = memberCopyPriority(&member_id);
+    if(priority == NULL){
         memberDestroy(member);
-        return EM_MEMBER_ID_ALREADY_EXISTS;
+        destroyEventManager(em);
+        return EM_OUT_OF_MEMORY;
     }
-
-    PriorityQueueResult pq_result = pqInsert(em->members_pq, member, &member_id);
-    memberDestroy(member);
-    if(pq_result == PQ_OUT_OF_MEMORY){
+    if(logChange(em, CHANGE_ADD_MEMBER, member_id, 0, member_name, NO_DATE) != EM_SUCCESS){
+        memberDestroy(member);
+        memberDestroyPriority(priority);
+        return EM_ERROR;
+    }
+    PriorityQueueResult pq_result = pqInsertTake(em->members_pq, member, priority);
+    if(pq_result != PQ_SUCCESS){
+        memberDestroy(member);
+        memberDestroyPriority(priority);
+    }
+    if(pq_result == PQ_OUT_OF_MEMORY ||
+       (pq_result == PQ_SUCCESS && !memberTableAdd(&em->members_by_id, member))){
             destroyEventManager(em);
             return EM_OUT_OF_MEMORY;
     }
+    if(pq_result == PQ_SUCCESS){
+        return changeMade(em);
+    }
     return changePQResultToMemberResult(pq_result);
 }
 
@@ -469,7 +935,7 @@ EventManagerResult emAddMemberToEvent(EventManager em, int member_id, int event_
     if(event == NULL){
         return EM_EVENT_ID_NOT_EXISTS;
     }    
-    Member member = getMemberByID(em->members_pq, member_id);
+    Member member = getMemberByID(em, member_id);
     if(member == NULL){
         return EM_MEMBER_ID_NOT_EXISTS;
     }    
@@ -479,15 +945,23 @@ EventManagerResult emAddMemberToEvent(EventManager em, int member_id, int event_
     if(pqContains(linked_members, member)){
         return EM_EVENT_AND_MEMBER_ALREADY_LINKED;
     }
+    if(logChange(em, CHANGE_ADD_MEMBER_TO_EVENT, member_id, event_id, NULL, NO_DATE) != EM_SUCCESS){
+        return EM_ERROR;
+    }
     
+    //counting the event first gives the copy in the event the same number, without looking it up:
+    changeEventsNum(em, member, memberGetEventsNum(member) + 1);
     PriorityQueueResult result = pqInsert(linked_members, member, &member_id);
     if(result == PQ_OUT_OF_MEMORY){
         destroyEventManager(em);
         return EM_OUT_OF_MEMORY;
     }
-    memberChangeEventsNum(member, memberGetEventsNum(member) + 1);
-    member = getMemberByID(eventGetPQ(event), member_id);
-    memberChangeEventsNum(member, memberGetEventsNum(member) + 1);
+    if(result != PQ_SUCCESS){
+        changeEventsNum(em, member, memberGetEventsNum(member) - 1);
+    }
+    if(result == PQ_SUCCESS){
+        return changeMade(em);
+    }
     return changePQResultToEventResult(result);
 }
 
@@ -510,7 +984,7 @@ EventManagerResult emRemoveMemberFromEvent (EventManager em, int member_id, int
     if(event == NULL){
         return EM_EVENT_ID_NOT_EXISTS;
     }  
-    Member member = getMemberByID(em->members_pq, member_id);
+    Member member = getMemberByID(em, member_id);
     if(member == NULL){
         return EM_MEMBER_ID_NOT_EXISTS;
     }   
@@ -518,28 +992,30 @@ EventManagerResult emRemoveMemberFromEvent (EventManager em, int member_id, int
     //get linked_members pq
     PriorityQueue linked_members = eventGetPQ(event);
 
-    //remove member
-    PriorityQueueResult result = pqRemoveElement(linked_members, member);
-    if(result == PQ_ELEMENT_DOES_NOT_EXISTS){
+    if(!pqContains(linked_members, member)){
         return EM_EVENT_AND_MEMBER_NOT_LINKED;
     }
-    memberChangeEventsNum(member, memberGetEventsNum(member) - 1);
+    if(logChange(em, CHANGE_REMOVE_MEMBER_FROM_EVENT, member_id, event_id, NULL, NO_DATE) != EM_SUCCESS){
+        return EM_ERROR;
+    }
+
+    //remove member
+    if(pqRemoveElement(linked_members, member) == PQ_OUT_OF_MEMORY){
+        destroyEventManager(em);
+        return EM_OUT_OF_MEMORY;
+    }
+    changeEventsNum(em, member, memberGetEventsNum(member) - 1);
         
-    return EM_SUCCESS;
+    return changeMade(em);
 }
 
 
 
 
 
-static Date dateTickLoop(Date date, int days){
-    if(days < 0){
-        return NULL;
-    }
-    for(int i = 0; i < days; i++){
-        dateTick(date);
-    }
-    return date;
+/* the members of an event that expired on a tick are linked to one event less */
+static void expireEvent(Event event, void* em){
+    removeLinkedMembersEventsNum(em, eventGetPQ(event));
 }
 
 EventManagerResult emTick(EventManager em, int days){
@@ -547,25 +1023,20 @@ EventManagerResult emTick(EventManager em, int days){
     if(em == NULL){
         return EM_NULL_ARGUMENT;
     }
-    if(days <= 0){
+    if(days <= 0 || !checkDaysFit(em->system_date, days)){
         return EM_INVALID_DATE;
     }
 
-    //change system date:
-    em->system_date = dateTickLoop(em->system_date, days);
-
-    // delete past events:
-    Event first_event = pqGetFirst(em->events);
-    while((first_event != NULL) && (dateCompare(eventGetPriority(first_event), em->system_date) < 0)){
-        int first_event_id = eventGetId(first_event);
-        EventManagerResult result = emRemoveEvent(em, first_event_id);
-        if(result == EM_OUT_OF_MEMORY){
-            destroyEventManager(em);
-            return result;
-        }
-        first_event = pqGetFirst(em->events);
+    if(logChange(em, CHANGE_TICK, days, 0, NULL, NO_DATE) != EM_SUCCESS){
+        return EM_ERROR;
     }
-    return EM_SUCCESS;
+
+    //change system date:
+    em->system_date += days;
+
+    // delete past events, all at once:
+    calendarRemoveBefore(em->events, em->system_date, expireEvent, em);
+    return changeMade(em);
 }
 
 
@@ -573,7 +1044,7 @@ int emGetEventsAmount(EventManager em){
     if(em == NULL){
         return NULL_VALUE;
     }
-    return (pqGetSize(em->events));
+    return (calendarGetSize(em->events));
 }
 
 
@@ -581,81 +1052,356 @@ char* emGetNextEvent(EventManager em){
     if(em == NULL){
         return NULL;
     }
-    return eventGetName(pqGetFirst(em->events));
+    return eventGetName(calendarGetFirst(em->events));
 }
 
 
-static void printEvent (Event event, FILE* file){
-    assert (file && event);
-    Date date = eventGetPriority(event);
-    int day, month, year;
-    dateGet(date, &day, &month, &year);
-    fprintf(file, "%s,%d.%d.%d",eventGetName(event), day, month, year);
+/*=========================================================================*/
+/* reports: lines are formatted by hand into a large buffer, which is written out in big chunks when
+   the report goes to a file descriptor, or grows to hold the whole report when it goes to memory */
+
+typedef struct report_t {
+    char* bytes;
+    int size;
+    int capacity;
+    int fd;
+    bool failed;
+
+    //the number of lines the report may still have, NO_LIMIT if it has no limit:
+    int lines_left;
+} Report;
+
+typedef void (*ReportFunction)(EventManager, Report*);
+
+static bool writeAll(int fd, const char* bytes, int size){
+    while(size > 0){
+        ssize_t written = write(fd, bytes, size);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= (int)written;
+    }
+    return true;
+}
 
-    PQ_FOREACH(Member, iterator, eventGetPQ(event)){
-        fprintf(file, ",%s", memberGetName(iterator));
+static void reportFlush(Report* report){
+    if(report->fd != NO_FILE && !report->failed){
+        report->failed = !writeAll(report->fd, report->bytes, report->size);
+        report->size = 0;
     }
-    fprintf(file, "\n");
-    
-    return;
 }
 
+/* makes room for length more bytes: a report to a file writes out what it holds, a report to memory
+   grows. returns false if the bytes should not be added to the buffer */
+static bool reportReserve(Report* report, int length){
+    if(report->failed){
+        return false;
+    }
+    if(report->size + length <= report->capacity){
+        return true;
+    }
+    if(report->fd != NO_FILE){
+        reportFlush(report);
+        return !report->failed && length <= report->capacity;
+    }
+    int new_capacity = report->capacity;
+    while(new_capacity - report->size <= length){
+        if(new_capacity > INT_MAX / EXPAND_FACTOR){
+            report->failed = true;
+            return false;
+        }
+        new_capacity *= EXPAND_FACTOR;
+    }
+    char* new_bytes = realloc(report->bytes, new_capacity);
+    if(new_bytes == NULL){
+        report->failed = true;
+        return false;
+    }
+    report->bytes = new_bytes;
+    report->capacity = new_capacity;
+    return true;
+}
 
-void emPrintAllEvents(EventManager em, const char* file_name){
-    //legality checks:
-    if(em == NULL || file_name == NULL){
-        return;
+static void reportBytes(Report* report, const char* bytes, int length){
+    if(reportReserve(report, length)){
+        memcpy(report->bytes + report->size, bytes, length);
+        report->size += length;
+    } else if(report->fd != NO_FILE && !report->failed){
+        //too long for the buffer, which was just written out:
+        report->failed = !writeAll(report->fd, bytes, length);
     }
-    //open file:
-    FILE* file = fopen (file_name, "w");
-    if(file == NULL){
-        return;
+}
+
+static void reportChar(Report* report, char character){
+    if(reportReserve(report, 1)){
+        report->bytes[report->size++] = character;
+    }
+}
+
+static void reportString(Report* report, const char* string){
+    reportBytes(report, string, (int)strlen(string));
+}
+
+static void reportInt(Report* report, int value){
+    char characters[MAX_INT_CHARACTERS];
+    int first = MAX_INT_CHARACTERS;
+    unsigned int magnitude = value < 0 ? 0U - (unsigned int)value : (unsigned int)value;
+    do{
+        characters[--first] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    }while(magnitude > 0);
+    if(value < 0){
+        characters[--first] = '-';
+    }
+    reportBytes(report, characters + first, MAX_INT_CHARACTERS - first);
+}
+
+//a line of emPrintAllEvents: the name, the date as day.month.year and the names of the members
+static void reportEvent(Report* report, Event event){
+    assert (report && event);
+    int day, month, year;
+    dateSerialGet(eventGetDate(event), &day, &month, &year);
+    reportString(report, eventGetName(event));
+    reportChar(report, ',');
+    reportInt(report, day);
+    reportChar(report, '.');
+    reportInt(report, month);
+    reportChar(report, '.');
+    reportInt(report, year);
+
+    PQ_FOREACH(Member, iterator, eventGetPQ(event)){
+        reportChar(report, ',');
+        reportString(report, memberGetName(iterator));
     }
-    //print into file:
-    PQ_FOREACH(Event, iterator, em->events){
-        printEvent(iterator, file);
+    reportChar(report, '\n');
+}
+
+static void reportAllEvents(EventManager em, Report* report){
+    CALENDAR_FOREACH(iterator, em->events){
+        reportEvent(report, iterator);
     }
-    //close file and return:
-    fclose(file);
-    return;
 }
 
-static void printMembersByAmount(FILE* file, int num_of_events, PriorityQueue members, bool first_print){
+//a line of emPrintAllResponsibleMembers: the name and the number of events
+static void reportMember(Report* report, Member member, int num_of_events){
+    reportString(report, memberGetName(member));
+    reportChar(report, ',');
+    reportInt(report, num_of_events);
+    reportChar(report, '\n');
+    if(report->lines_left != NO_LIMIT){
+        report->lines_left--;
+    }
+}
+
+static void reportMembersByAmount(Report* report, int num_of_events, PriorityQueue members){
     PQ_FOREACH(Member, iterator, members){
-        // if(memberGetEventsNum(iterator) == num_of_events){
-        //     if(first_print){
-        //         fprintf(file, "%s,%d", memberGetName(iterator), num_of_events);
-        //         first_print = false;  
-        //     }else{
-        //         fprintf(file, "\n%s,%d", memberGetName(iterator), num_of_events);
-        //     }
-        // }       
+        if(report->lines_left == 0){
+            return;
+        }
         if(memberGetEventsNum(iterator) == num_of_events){
-            fprintf(file, "%s,%d\n", memberGetName(iterator), num_of_events);
-        }     
+            reportMember(report, iterator, num_of_events);
+        }
+    }
+}
+
+static void reportAllResponsibleMembers(EventManager em, Report* report){
+    //get max event num
+    int max = calendarGetSize(em->events);
+    if(em->members_by_events_num != NULL || buildEventsNumIndex(em)){
+        if(max >= em->events_num_buckets){
+            max = em->events_num_buckets - 1;
+        }
+        for(int amount = max; amount > 0 && report->lines_left != 0; amount--){
+            //every member in the bucket has amount events
+            PriorityQueue bucket = em->members_by_events_num[amount];
+            if(bucket != NULL){
+                reportMembersByAmount(report, amount, bucket);
+            }
+        }
+        return;
+    }
+    //without the index every member is checked for every amount:
+    for(int amount = max; amount > 0 && report->lines_left != 0; amount--){
+        //print members by amount of events
+        reportMembersByAmount(report, amount, em->members_pq);
     }
 }
 
+/* runs a report into the file descriptor, through the event manager's buffer */
+static EventManagerResult writeReport(EventManager em, int fd, int limit, ReportFunction report_function){
+    if(em == NULL){
+        return EM_NULL_ARGUMENT;
+    }
+    if(em->report_buffer == NULL){
+        em->report_buffer = malloc(REPORT_BUFFER_SIZE);
+        if(em->report_buffer == NULL){
+            return EM_OUT_OF_MEMORY;
+        }
+    }
+    Report report = {em->report_buffer, 0, REPORT_BUFFER_SIZE, fd, fd < 0, limit};
+    report_function(em, &report);
+    reportFlush(&report);
+    return report.failed ? EM_ERROR : EM_SUCCESS;
+}
 
+/* runs a report into a new string */
+static char* formatReport(EventManager em, int* length, int limit, ReportFunction report_function){
+    if(em == NULL){
+        return NULL;
+    }
+    Report report = {malloc(INITIAL_REPORT_CAPACITY), 0, INITIAL_REPORT_CAPACITY, NO_FILE, false, limit};
+    report.failed = report.bytes == NULL;
+    report_function(em, &report);
+    reportChar(&report, '\0');
+    if(report.failed){
+        free(report.bytes);
+        return NULL;
+    }
+    if(length != NULL){
+        *length = report.size - 1;
+    }
+    return report.bytes;
+}
 
-void emPrintAllResponsibleMembers(EventManager em, const char* file_name){
+/* runs a report into the named file, replacing its content */
+static void printReport(EventManager em, const char* file_name, int limit, ReportFunction report_function){
     //legality checks:
     if(em == NULL || file_name == NULL){
         return;
     }
     //open file:
-    FILE* file = fopen (file_name, "w");
-    if(file == NULL){
+    int fd = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, REPORT_FILE_MODE);
+    if(fd < 0){
         return;
     }
-    //get max event num
-    int max = pqGetSize(em->events);
-    for(int amount = max; amount > 0; amount--){
-        //print members by amount of events
-        printMembersByAmount(file, amount, em->members_pq, amount == max);
+    writeReport(em, fd, limit, report_function);
+    close(fd);
+}
+
+
+void emPrintAllEvents(EventManager em, const char* file_name){
+    printReport(em, file_name, NO_LIMIT, reportAllEvents);
+}
+
+
+void emPrintAllResponsibleMembers(EventManager em, const char* file_name){
+    printReport(em, file_name, NO_LIMIT, reportAllResponsibleMembers);
+}
+
+
+EventManagerResult emWriteAllEvents(EventManager em, int fd){
+    return writeReport(em, fd, NO_LIMIT, reportAllEvents);
+}
+
+
+EventManagerResult emWriteAllResponsibleMembers(EventManager em, int fd){
+    return writeReport(em, fd, NO_LIMIT, reportAllResponsibleMembers);
+}
+
+
+char* emFormatAllEvents(EventManager em, int* length){
+    return formatReport(em, length, NO_LIMIT, reportAllEvents);
+}
+
+
+char* emFormatAllResponsibleMembers(EventManager em, int* length){
+    return formatReport(em, length, NO_LIMIT, reportAllResponsibleMembers);
+}
+
+
+void emPrintTopResponsibleMembers(EventManager em, const char* file_name, int count){
+    if(count >= 0){
+        printReport(em, file_name, count, reportAllResponsibleMembers);
     }
-    
-    //close file
-    fclose(file);
-    return;
+}
+
+
+EventManagerResult emWriteTopResponsibleMembers(EventManager em, int fd, int count){
+    if(count < 0){
+        return em == NULL ? EM_NULL_ARGUMENT : EM_ERROR;
+    }
+    return writeReport(em, fd, count, reportAllResponsibleMembers);
+}
+
+
+char* emFormatTopResponsibleMembers(EventManager em, int count, int* length){
+    if(count < 0){
+        return NULL;
+    }
+    return formatReport(em, length, count, reportAllResponsibleMembers);
+}
+
+
+EventManager createDurableEventManager(Date date, const char* path, EMSyncMode sync_mode, int batch_size,
+                                       int snapshot_interval){
+    if(date == NULL || path == NULL){
+        return NULL;
+    }
+    if((sync_mode != EM_SYNC_EACH_OPERATION && sync_mode != EM_SYNC_EACH_BATCH) || batch_size < 1 ||
+       snapshot_interval < 0){
+        return NULL;
+    }
+    char* snapshot_path = pathWithSuffix(path, SNAPSHOT_SUFFIX);
+    char* log_path = pathWithSuffix(path, LOG_SUFFIX);
+    bool snapshot_exists = false;
+    unsigned long long last_lsn = 0;
+    EventManager em = NULL;
+    if(snapshot_path != NULL && log_path != NULL){
+        em = recoverEventManager(date, snapshot_path, log_path, &snapshot_exists, &last_lsn);
+    }
+    if(em == NULL){
+        free(snapshot_path);
+        free(log_path);
+        return NULL;
+    }
+    em->journal = journalOpen(log_path, last_lsn, sync_mode == EM_SYNC_EACH_OPERATION, batch_size);
+    em->snapshot_path = snapshot_path;
+    em->snapshot_interval = snapshot_interval;
+    free(log_path);
+    //a new event manager starts with a snapshot, so it is recovered on its own date:
+    if(em->journal == NULL || (!snapshot_exists && emCheckpoint(em) != EM_SUCCESS)){
+        destroyEventManager(em);
+        return NULL;
+    }
+    return em;
+}
+
+
+EventManagerResult emSync(EventManager em){
+    if(em == NULL){
+        return EM_NULL_ARGUMENT;
+    }
+    if(em->journal == NULL){
+        return EM_SUCCESS;
+    }
+    return journalCommit(em->journal) ? EM_SUCCESS : EM_ERROR;
+}
+
+
+EventManagerResult emCheckpoint(EventManager em){
+    if(em == NULL){
+        return EM_NULL_ARGUMENT;
+    }
+    if(em->journal == NULL){
+        return EM_ERROR;
+    }
+    JournalBuffer content;
+    journalBufferInit(&content);
+    encodeSnapshot(em, journalLastLSN(em->journal), &content);
+    if(content.failed){
+        journalBufferFree(&content);
+        return EM_OUT_OF_MEMORY;
+    }
+    //once the snapshot is in place the log only holds changes it already has:
+    bool written = journalWriteSnapshot(em->snapshot_path, &content) && journalReset(em->journal);
+    journalBufferFree(&content);
+    if(!written){
+        return EM_ERROR;
+    }
+    em->changes_since_snapshot = 0;
+    return EM_SUCCESS;
 }
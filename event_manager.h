@@ -51,4 +51,55 @@ char* emGetNextEvent(EventManager em);
 void emPrintAllEvents(EventManager em, const char* file_name);
 
 void emPrintAllResponsibleMembers(EventManager em, const char* file_name);
+
+/* these functions write the same lines as emPrintAllEvents and emPrintAllResponsibleMembers to an open
+   file descriptor, such as a pipe or a socket. the lines are formatted into a buffer the event manager
+   keeps for all its reports and written out in large chunks.
+   return EM_NULL_ARGUMENT if em is NULL, EM_ERROR if fd is illegal or writing failed */
+EventManagerResult emWriteAllEvents(EventManager em, int fd);
+
+EventManagerResult emWriteAllResponsibleMembers(EventManager em, int fd);
+
+/* these functions return the same lines as emPrintAllEvents and emPrintAllResponsibleMembers in a new
+   string, which the caller should free. length receives its length if it is not NULL.
+   return NULL if em is NULL or an allocation failed */
+char* emFormatAllEvents(EventManager em, int* length);
+
+char* emFormatAllResponsibleMembers(EventManager em, int* length);
+
+/* these functions report like emPrintAllResponsibleMembers, emWriteAllResponsibleMembers and
+   emFormatAllResponsibleMembers, but only the first count lines: the count most responsible members.
+   a negative count is illegal, and makes them do nothing, return EM_ERROR and return NULL */
+void emPrintTopResponsibleMembers(EventManager em, const char* file_name, int count);
+
+EventManagerResult emWriteTopResponsibleMembers(EventManager em, int fd, int count);
+
+char* emFormatTopResponsibleMembers(EventManager em, int count, int* length);
+
+/** How often a durable event manager fsyncs the changes it logs, see createDurableEventManager */
+typedef enum EMSyncMode_t {
+    EM_SYNC_EACH_OPERATION,
+    EM_SYNC_EACH_BATCH
+} EMSyncMode;
+
+/* this function creates an event manager that keeps its state in two files whose names start with path:
+   a snapshot, path.snapshot, and a write-ahead log of the changes made after it, path.log.
+   if the snapshot exists the event manager is recovered by loading it and replaying the log, and date
+   is ignored. otherwise a new event manager is created on date, and its first snapshot written.
+   with EM_SYNC_EACH_OPERATION every change is fsync'ed before its function returns. with
+   EM_SYNC_EACH_BATCH changes are fsync'ed batch_size at a time and by emSync, so a crash may lose the
+   changes since the last fsync. a snapshot is taken after every snapshot_interval changes, or only by
+   emCheckpoint if it is 0. every change is logged before it is made: a function that could not log its
+   change does not make it, and returns EM_ERROR.
+   returns NULL if an argument is illegal, the files could not be read or written, or they are corrupt */
+EventManager createDurableEventManager(Date date, const char* path, EMSyncMode sync_mode, int batch_size,
+                                       int snapshot_interval);
+
+/* this function fsyncs the changes a durable event manager logged since its last fsync.
+   does nothing for other event managers */
+EventManagerResult emSync(EventManager em);
+
+/* this function writes a snapshot of a durable event manager and empties its log, so recovery has
+   nothing to replay. returns EM_ERROR if em is not durable or writing failed */
+EventManagerResult emCheckpoint(EventManager em);
 #endif //EVENT_MANAGER_H
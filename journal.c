@@ -0,0 +1,454 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "journal.h"
+#include "checksum.h"
+
+#define INITIAL_BUFFER_CAPACITY 256
+#define READ_CHUNK_SIZE 65536
+#define EXPAND_FACTOR 2
+#define INT_SIZE 4
+#define LONG_SIZE 8
+#define FRAME_HEADER_SIZE (INT_SIZE + LONG_SIZE)
+#define FRAME_OVERHEAD (FRAME_HEADER_SIZE + INT_SIZE)
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_SIZE (sizeof(SNAPSHOT_MAGIC) + INT_SIZE + LONG_SIZE)
+#define TEMPORARY_SUFFIX ".tmp"
+
+/* a log is a sequence of frames: u32 payload size, u64 LSN, the payload, and a u32 CRC-32 of the LSN
+   and the payload. a snapshot file is the magic, a u32 version, a u64 content size, the content, and
+   a u32 CRC-32 of everything before it */
+static const unsigned char SNAPSHOT_MAGIC[] = {'J', 'N', 'S', 'N'};
+
+struct Journal_t {
+    int fd;
+    unsigned long long last_lsn;
+    bool sync_each_record;
+    int batch_size;
+
+    /* frames appended since the last commit, and how many of their bytes a failed commit already wrote */
+    JournalBuffer pending;
+    int pending_records;
+    int pending_written;
+};
+
+/*=========================================================================*/
+/* checksums */
+
+static uint32_t checksumOf(const unsigned char* bytes, int size){
+    return checksumUpdate(CHECKSUM_EMPTY, bytes, size);
+}
+
+/*=========================================================================*/
+/* buffers and readers */
+
+void journalBufferInit(JournalBuffer* buffer){
+    buffer->bytes = NULL;
+    buffer->size = 0;
+    buffer->capacity = 0;
+    buffer->failed = false;
+}
+
+void journalBufferFree(JournalBuffer* buffer){
+    free(buffer->bytes);
+    journalBufferInit(buffer);
+}
+
+/* makes room for size more bytes and returns where they go, NULL if that failed */
+static unsigned char* reserveBytes(JournalBuffer* buffer, int size){
+    if(buffer->failed || size > INT_MAX / EXPAND_FACTOR - buffer->size){
+        buffer->failed = true;
+        return NULL;
+    }
+    if(buffer->size + size > buffer->capacity){
+        int new_capacity = buffer->capacity > 0 ? buffer->capacity : INITIAL_BUFFER_CAPACITY;
+        while(new_capacity < buffer->size + size){
+            new_capacity *= EXPAND_FACTOR;
+        }
+        unsigned char* new_bytes = realloc(buffer->bytes, new_capacity);
+        if(new_bytes == NULL){
+            buffer->failed = true;
+            return NULL;
+        }
+        buffer->bytes = new_bytes;
+        buffer->capacity = new_capacity;
+    }
+    unsigned char* reserved = buffer->bytes + buffer->size;
+    buffer->size += size;
+    return reserved;
+}
+
+static void putBytes(JournalBuffer* buffer, const void* bytes, int size){
+    unsigned char* reserved = reserveBytes(buffer, size);
+    if(reserved != NULL){
+        memcpy(reserved, bytes, size);
+    }
+}
+
+static void encodeNumber(unsigned char* bytes, unsigned long long value, int size){
+    for(int i = 0; i < size; i++){
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static unsigned long long decodeNumber(const unsigned char* bytes, int size){
+    unsigned long long value = 0;
+    for(int i = 0; i < size; i++){
+        value |= (unsigned long long)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+static void putNumber(JournalBuffer* buffer, unsigned long long value, int size){
+    unsigned char* reserved = reserveBytes(buffer, size);
+    if(reserved != NULL){
+        encodeNumber(reserved, value, size);
+    }
+}
+
+void journalPutInt(JournalBuffer* buffer, int value){
+    putNumber(buffer, (uint32_t)value, INT_SIZE);
+}
+
+void journalPutLong(JournalBuffer* buffer, unsigned long long value){
+    putNumber(buffer, value, LONG_SIZE);
+}
+
+/* a string is its length and its characters, followed by its '\0' so readers can point into the bytes */
+void journalPutString(JournalBuffer* buffer, const char* value){
+    int length = (int)strlen(value);
+    journalPutInt(buffer, length);
+    putBytes(buffer, value, length + 1);
+}
+
+/* returns the next size bytes of the reader and skips them, NULL if there are not that many */
+static const unsigned char* takeBytes(JournalReader* reader, int size){
+    if(reader->failed || size < 0 || size > reader->size - reader->position){
+        reader->failed = true;
+        return NULL;
+    }
+    const unsigned char* bytes = reader->bytes + reader->position;
+    reader->position += size;
+    return bytes;
+}
+
+int journalGetInt(JournalReader* reader){
+    const unsigned char* bytes = takeBytes(reader, INT_SIZE);
+    return bytes == NULL ? 0 : (int)(int32_t)(uint32_t)decodeNumber(bytes, INT_SIZE);
+}
+
+unsigned long long journalGetLong(JournalReader* reader){
+    const unsigned char* bytes = takeBytes(reader, LONG_SIZE);
+    return bytes == NULL ? 0 : decodeNumber(bytes, LONG_SIZE);
+}
+
+const char* journalGetString(JournalReader* reader){
+    int length = journalGetInt(reader);
+    const unsigned char* bytes = takeBytes(reader, length < 0 || length == INT_MAX ? -1 : length + 1);
+    if(bytes == NULL || bytes[length] != '\0'){
+        reader->failed = true;
+        return NULL;
+    }
+    return (const char*)bytes;
+}
+
+/*=========================================================================*/
+/* files */
+
+/* writes all the bytes, going on after partial writes and interruptions. returns how many were written,
+   which is less than size only if a write failed */
+static int writeAll(int fd, const unsigned char* bytes, int size){
+    int total = 0;
+    while(total < size){
+        ssize_t written = write(fd, bytes + total, size - total);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            break;
+        }
+        total += (int)written;
+    }
+    return total;
+}
+
+/* reads the whole file into buffer. exists is set to false if there is no file at path */
+static bool readFile(const char* path, JournalBuffer* buffer, bool* exists){
+    *exists = false;
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        return errno == ENOENT;
+    }
+    *exists = true;
+    bool success = true;
+    while(success){
+        unsigned char* chunk = reserveBytes(buffer, READ_CHUNK_SIZE);
+        if(chunk == NULL){
+            success = false;
+            break;
+        }
+        ssize_t result = read(fd, chunk, READ_CHUNK_SIZE);
+        buffer->size -= READ_CHUNK_SIZE - (result > 0 ? (int)result : 0);
+        if(result == 0){
+            break;
+        }
+        if(result < 0 && errno != EINTR){
+            success = false;
+        }
+    }
+    close(fd);
+    return success;
+}
+
+/* fsyncs the directory holding path, so a file renamed into it stays there after a crash */
+static bool syncDirectoryOf(const char* path){
+    const char* slash = strrchr(path, '/');
+    char* directory = NULL;
+    if(slash == NULL){
+        directory = malloc(sizeof("."));
+        if(directory != NULL){
+            strcpy(directory, ".");
+        }
+    } else {
+        int length = slash == path ? 1 : (int)(slash - path);
+        directory = malloc(length + 1);
+        if(directory != NULL){
+            memcpy(directory, path, length);
+            directory[length] = '\0';
+        }
+    }
+    if(directory == NULL){
+        return false;
+    }
+    int fd = open(directory, O_RDONLY);
+    free(directory);
+    if(fd < 0){
+        return false;
+    }
+    bool success = fsync(fd) == 0;
+    close(fd);
+    return success;
+}
+
+/*=========================================================================*/
+/* logs */
+
+Journal journalOpen(const char* path, unsigned long long last_lsn, bool sync_each_record, int batch_size){
+    if(path == NULL || batch_size < 1){
+        return NULL;
+    }
+    Journal journal = malloc(sizeof(*journal));
+    if(journal == NULL){
+        return NULL;
+    }
+    journal->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if(journal->fd < 0){
+        free(journal);
+        return NULL;
+    }
+    journal->last_lsn = last_lsn;
+    journal->sync_each_record = sync_each_record;
+    journal->batch_size = batch_size;
+    journalBufferInit(&journal->pending);
+    journal->pending_records = 0;
+    journal->pending_written = 0;
+    return journal;
+}
+
+bool journalClose(Journal journal){
+    if(journal == NULL){
+        return true;
+    }
+    bool committed = journalCommit(journal);
+    close(journal->fd);
+    journalBufferFree(&journal->pending);
+    free(journal);
+    return committed;
+}
+
+bool journalAppend(Journal journal, const JournalBuffer* record){
+    if(journal == NULL || record == NULL || record->failed){
+        return false;
+    }
+    int frame_start = journal->pending.size;
+    unsigned long long lsn = journal->last_lsn + 1;
+    journalPutInt(&journal->pending, record->size);
+    journalPutLong(&journal->pending, lsn);
+    putBytes(&journal->pending, record->bytes, record->size);
+    if(journal->pending.failed){
+        journal->pending.failed = false;
+        journal->pending.size = frame_start;
+        return false;
+    }
+    const unsigned char* checked = journal->pending.bytes + frame_start + INT_SIZE;
+    journalPutInt(&journal->pending, (int)checksumOf(checked, LONG_SIZE + record->size));
+    if(journal->pending.failed){
+        journal->pending.failed = false;
+        journal->pending.size = frame_start;
+        return false;
+    }
+    journal->last_lsn = lsn;
+    journal->pending_records++;
+    if(journal->sync_each_record || journal->pending_records >= journal->batch_size){
+        return journalCommit(journal);
+    }
+    return true;
+}
+
+bool journalCommit(Journal journal){
+    if(journal == NULL){
+        return false;
+    }
+    if(journal->pending.size == 0){
+        return true;
+    }
+    /* the bytes a failed write got into the file stay there, so the next attempt goes on after them
+       instead of writing the whole batch again behind a torn copy of its start */
+    int unwritten = journal->pending.size - journal->pending_written;
+    journal->pending_written += writeAll(journal->fd, journal->pending.bytes + journal->pending_written, unwritten);
+    if(journal->pending_written < journal->pending.size || fsync(journal->fd) != 0){
+        return false;
+    }
+    journal->pending.size = 0;
+    journal->pending_records = 0;
+    journal->pending_written = 0;
+    return true;
+}
+
+bool journalReset(Journal journal){
+    if(!journalCommit(journal)){
+        return false;
+    }
+    return ftruncate(journal->fd, 0) == 0 && fsync(journal->fd) == 0;
+}
+
+unsigned long long journalLastLSN(Journal journal){
+    return journal == NULL ? 0 : journal->last_lsn;
+}
+
+/* returns the size of the valid frame at position, 0 if it is torn, incomplete or corrupt */
+static int validFrameSize(const JournalBuffer* log, int position){
+    if(log->size - position < FRAME_OVERHEAD){
+        return 0;
+    }
+    unsigned long long payload_size = decodeNumber(log->bytes + position, INT_SIZE);
+    if(payload_size > (unsigned long long)(log->size - position - FRAME_OVERHEAD)){
+        return 0;
+    }
+    int checked_size = LONG_SIZE + (int)payload_size;
+    const unsigned char* checked = log->bytes + position + INT_SIZE;
+    if(decodeNumber(checked + checked_size, INT_SIZE) != checksumOf(checked, checked_size)){
+        return 0;
+    }
+    return FRAME_OVERHEAD + (int)payload_size;
+}
+
+bool journalReplay(const char* path, unsigned long long after_lsn, JournalReplayFunction replay,
+                   void* context, unsigned long long* last_lsn){
+    if(path == NULL || replay == NULL || last_lsn == NULL){
+        return false;
+    }
+    *last_lsn = after_lsn;
+    JournalBuffer log;
+    journalBufferInit(&log);
+    bool exists;
+    if(!readFile(path, &log, &exists)){
+        journalBufferFree(&log);
+        return false;
+    }
+    bool success = true;
+    int position = 0;
+    int frame_size;
+    while(success && (frame_size = validFrameSize(&log, position)) > 0){
+        unsigned long long lsn = decodeNumber(log.bytes + position + INT_SIZE, LONG_SIZE);
+        if(lsn > after_lsn){
+            JournalReader record = {log.bytes + position + FRAME_HEADER_SIZE, frame_size - FRAME_OVERHEAD,
+                                    0, false};
+            success = replay(&record, context);
+        }
+        if(lsn > *last_lsn){
+            *last_lsn = lsn;
+        }
+        position += frame_size;
+    }
+    if(success && position < log.size){
+        success = truncate(path, position) == 0;
+    }
+    journalBufferFree(&log);
+    return success;
+}
+
+/*=========================================================================*/
+/* snapshots */
+
+bool journalWriteSnapshot(const char* path, const JournalBuffer* content){
+    if(path == NULL || content == NULL || content->failed){
+        return false;
+    }
+    JournalBuffer file;
+    journalBufferInit(&file);
+    putBytes(&file, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    journalPutInt(&file, SNAPSHOT_VERSION);
+    journalPutLong(&file, (unsigned long long)content->size);
+    putBytes(&file, content->bytes, content->size);
+    if(!file.failed){
+        journalPutInt(&file, (int)checksumOf(file.bytes, file.size));
+    }
+    char* temporary_path = malloc(strlen(path) + sizeof(TEMPORARY_SUFFIX));
+    if(file.failed || temporary_path == NULL){
+        free(temporary_path);
+        journalBufferFree(&file);
+        return false;
+    }
+    strcpy(temporary_path, path);
+    strcat(temporary_path, TEMPORARY_SUFFIX);
+
+    bool success = false;
+    int fd = open(temporary_path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if(fd >= 0){
+        success = writeAll(fd, file.bytes, file.size) == file.size && fsync(fd) == 0;
+        success = close(fd) == 0 && success;
+        success = success && rename(temporary_path, path) == 0 && syncDirectoryOf(path);
+        if(!success){
+            unlink(temporary_path);
+        }
+    }
+    free(temporary_path);
+    journalBufferFree(&file);
+    return success;
+}
+
+bool journalReadSnapshot(const char* path, JournalBuffer* content, bool* exists){
+    if(path == NULL || content == NULL || exists == NULL){
+        return false;
+    }
+    JournalBuffer file;
+    journalBufferInit(&file);
+    if(!readFile(path, &file, exists) || !*exists || file.size < (int)SNAPSHOT_HEADER_SIZE + INT_SIZE){
+        journalBufferFree(&file);
+        return false;
+    }
+    int checked_size = file.size - INT_SIZE;
+    JournalReader header = {file.bytes, checked_size, sizeof(SNAPSHOT_MAGIC), false};
+    int version = journalGetInt(&header);
+    unsigned long long content_size = journalGetLong(&header);
+    bool valid = memcmp(file.bytes, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 &&
+                 version == SNAPSHOT_VERSION &&
+                 content_size == (unsigned long long)(checked_size - (int)SNAPSHOT_HEADER_SIZE) &&
+                 decodeNumber(file.bytes + checked_size, INT_SIZE) == checksumOf(file.bytes, checked_size);
+    if(valid){
+        putBytes(content, file.bytes + SNAPSHOT_HEADER_SIZE, (int)content_size);
+        valid = !content->failed;
+    }
+    journalBufferFree(&file);
+    return valid;
+}
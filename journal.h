@@ -0,0 +1,136 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdbool.h>
+
+/**
+* Journal
+*
+* Makes in-memory state durable with an append-only write-ahead log of changes plus snapshot files.
+* Each appended record gets the next log sequence number (LSN) and is framed with its size and a
+* CRC-32, so a record torn by a crash is detected on replay and dropped together with what follows it.
+* Records are group committed: they wait in memory and are written and fsync'ed together, after every
+* record or after every batch of records, as chosen when the journal is opened.
+* A snapshot is written to a temporary file that then replaces the old snapshot, so a crash leaves
+* either the old snapshot or the new one. The owner keeps the LSN of the last change a snapshot holds
+* inside it, and replays only the records that come after it.
+*
+* Records and snapshots are encoded in a JournalBuffer and decoded with a JournalReader. Numbers are
+* stored little endian, so the files can be moved between machines.
+*
+* The following functions are available:
+*   journalBufferInit      - Prepares an empty buffer
+*   journalBufferFree      - Frees the memory of a buffer
+*   journalPutInt          - Appends an int to a buffer
+*   journalPutLong         - Appends an unsigned long long to a buffer
+*   journalPutString       - Appends a string to a buffer
+*   journalGetInt          - Reads an int from a reader
+*   journalGetLong         - Reads an unsigned long long from a reader
+*   journalGetString       - Reads a string from a reader
+*   journalOpen            - Opens a log for appending records
+*   journalClose           - Commits the pending records of a log and closes it
+*   journalAppend          - Appends a record to a log
+*   journalCommit          - Writes and fsyncs the pending records of a log
+*   journalReset           - Empties a log, once a snapshot holds all its records
+*   journalLastLSN         - Returns the LSN of the last record appended to a log
+*   journalReplay          - Passes the records of a log file to a function, in order
+*   journalWriteSnapshot   - Replaces a snapshot file with the content of a buffer
+*   journalReadSnapshot    - Reads a snapshot file into a buffer
+*/
+
+/** A growable byte buffer records and snapshots are encoded into. failed is set if an allocation failed */
+typedef struct JournalBuffer_t {
+    unsigned char* bytes;
+    int size;
+    int capacity;
+    bool failed;
+} JournalBuffer;
+
+/** Reads back what was encoded in a buffer. failed is set once a read goes past the end */
+typedef struct JournalReader_t {
+    const unsigned char* bytes;
+    int size;
+    int position;
+    bool failed;
+} JournalReader;
+
+typedef struct Journal_t *Journal;
+
+/**
+* Type of function journalReplay passes every record to, with the context given to it.
+* Should return false to stop the replay.
+*/
+typedef bool(*JournalReplayFunction)(JournalReader*, void*);
+
+
+/* this function prepares an empty buffer */
+void journalBufferInit(JournalBuffer* buffer);
+
+
+/* this function frees the memory of a buffer and leaves it empty */
+void journalBufferFree(JournalBuffer* buffer);
+
+
+/* these functions append a value to a buffer, setting its failed flag if an allocation failed */
+void journalPutInt(JournalBuffer* buffer, int value);
+void journalPutLong(JournalBuffer* buffer, unsigned long long value);
+void journalPutString(JournalBuffer* buffer, const char* value);
+
+
+/* these functions read the next value from a reader, setting its failed flag if it is not there.
+   journalGetString returns a pointer into the reader's bytes, NULL on failure */
+int journalGetInt(JournalReader* reader);
+unsigned long long journalGetLong(JournalReader* reader);
+const char* journalGetString(JournalReader* reader);
+
+
+/* this function opens the log file at path for appending, creating it if needed. the next record gets
+   the LSN after last_lsn. with sync_each_record every record is committed as it is appended, otherwise
+   records are committed batch_size at a time. returns NULL if batch_size is not positive, or the file
+   could not be opened or an allocation failed */
+Journal journalOpen(const char* path, unsigned long long last_lsn, bool sync_each_record, int batch_size);
+
+
+/* this function commits the pending records and closes the log. returns false if committing failed */
+bool journalClose(Journal journal);
+
+
+/* this function appends the content of record to the log as its next record, committing it if the
+   journal's policy says so. returns false if an allocation failed or committing failed */
+bool journalAppend(Journal journal, const JournalBuffer* record);
+
+
+/* this function writes the pending records to the log file and fsyncs it. returns false on failure,
+   in which case the records stay pending */
+bool journalCommit(Journal journal);
+
+
+/* this function commits the pending records and then empties the log file. called after a snapshot
+   that holds every record of the log was written. LSNs go on from where they were */
+bool journalReset(Journal journal);
+
+
+/* this function returns the LSN of the last record appended to the log, committed or not */
+unsigned long long journalLastLSN(Journal journal);
+
+
+/* this function passes every record of the log file at path with an LSN after after_lsn to replay,
+   in the order they were appended. a missing file holds no records. the log ends at the first record
+   that is incomplete or does not match its checksum, and the file is cut there, so new records do not
+   follow a torn one. last_lsn receives the larger of after_lsn and the LSN of the last valid record.
+   returns false if replay stopped the replay, or the file could not be read or cut */
+bool journalReplay(const char* path, unsigned long long after_lsn, JournalReplayFunction replay,
+                   void* context, unsigned long long* last_lsn);
+
+
+/* this function atomically replaces the snapshot file at path with the content of the buffer,
+   fsyncing it before it replaces the old one. returns false on failure, leaving the old snapshot */
+bool journalWriteSnapshot(const char* path, const JournalBuffer* content);
+
+
+/* this function reads the snapshot file at path into content, which should be empty.
+   exists is set to whether there is a file at path. returns false if there is none, it could not be
+   read, or it is of another version or does not match its checksum */
+bool journalReadSnapshot(const char* path, JournalBuffer* content, bool* exists);
+
+#endif //JOURNAL_H
@@ -0,0 +1,102 @@
+#include "member.h"
+#include <stdlib.h>
+
+struct member_t{
+    int member_id;
+    const char* member_name;  /* interned, so copies of a member share it */
+    int events_num;
+};
+
+/* creates a member that takes over a reference to the interned name */
+static Member memberCreateWith(int member_id, const char* interned_name, int events_num){
+    Member member = malloc(sizeof(*member));
+    if(member == NULL){
+        stringRelease(interned_name);
+        return NULL;
+    }
+    member->member_id = member_id;
+    member->member_name = interned_name;
+    member->events_num = events_num;
+    return member;
+}
+
+
+Member memberCreate(int member_id, char* member_name, StringTable names){
+    if(member_name == NULL){
+        return NULL;
+    }
+    const char* interned_name = stringIntern(names, member_name);
+    if(interned_name == NULL){
+        return NULL;
+    }
+    return memberCreateWith(member_id, interned_name, 0);
+}
+
+
+Member memberCopy(Member member){
+    if(member == NULL){
+        return NULL;
+    }
+    return memberCreateWith(member->member_id, stringRetain(member->member_name), member->events_num);
+}
+
+
+void memberDestroy(Member member){
+    if(member == NULL){
+        return;
+    }
+    stringRelease(member->member_name);
+    free(member);
+}
+
+
+bool memberEqual(Member member1, Member member2){
+    return member1->member_id == member2->member_id;
+}
+
+
+MemberPriority memberCopyPriority(MemberPriority member_priority){
+    if(member_priority == NULL){
+        return NULL;
+    }
+    MemberPriority priority_copy = malloc(sizeof(*priority_copy));
+    if(priority_copy == NULL){
+        return NULL;
+    }
+    *priority_copy = *member_priority;
+    return priority_copy;
+}
+
+
+void memberDestroyPriority(MemberPriority member_priority){
+    free(member_priority);
+}
+
+
+int memberComparePriorities(MemberPriority member_priority1, MemberPriority member_priority2){
+    //ids are not negative, so the difference cannot overflow:
+    return *member_priority2 - *member_priority1;
+}
+
+
+int memberGetID(Member member){
+    return member == NULL ? -1 : member->member_id;
+}
+
+
+char* memberGetName(Member member){
+    return member == NULL ? NULL : (char*)member->member_name;
+}
+
+
+int memberGetEventsNum(Member member){
+    return member == NULL ? 0 : member->events_num;
+}
+
+
+void memberChangeEventsNum(Member member, int events_num){
+    if(member == NULL){
+        return;
+    }
+    member->events_num = events_num;
+}
@@ -0,0 +1,63 @@
+#ifndef MEMBER_H
+#define MEMBER_H
+
+#include <stdbool.h>
+#include "string_table.h"
+
+
+
+typedef struct member_t *Member;
+
+/** The priority of a member in the members queue of an event: its id, so members are kept by id */
+typedef int* MemberPriority;
+
+
+/* this function creates a new member with no events, its name interned in names,
+   if NULL was sent - the function returns NULL */
+Member memberCreate(int member_id, char* member_name, StringTable names);
+
+
+/* this function creates a new member containing the arguments of a specific member. the copy
+    shares the interned name of the member */
+Member memberCopy(Member member);
+
+
+/* this function de-allocate the member & the member's arguments */
+void memberDestroy(Member member);
+
+
+/* this function checks if the elements (members) are the same */
+bool memberEqual(Member member1, Member member2);
+
+
+/* this function copies the priority */
+MemberPriority memberCopyPriority(MemberPriority member_priority);
+
+
+/* this function de-allocates the member's priority */
+void memberDestroyPriority(MemberPriority member_priority);
+
+
+/* this function compare 2 priorities, the lower id comes first
+    if the first one is lower - returns a positive number
+    if the priorities are equal - returns 0
+    if the first one is higher - returns a negative number */
+int memberComparePriorities(MemberPriority member_priority1, MemberPriority member_priority2);
+
+
+/* this function returns the member's id, -1 if NULL was sent */
+int memberGetID(Member member);
+
+
+/* this function returns the member's name, NULL if NULL was sent */
+char* memberGetName(Member member);
+
+
+/* this function returns the number of events the member is linked to, 0 if NULL was sent */
+int memberGetEventsNum(Member member);
+
+
+/* this function sets the number of events the member is linked to */
+void memberChangeEventsNum(Member member, int events_num);
+
+#endif //MEMBER_H
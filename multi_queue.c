@@ -0,0 +1,268 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include "multi_queue.h"
+#include "priority_queue.h"
+
+#define CACHE_LINE_SIZE 64
+#define POP_ATTEMPTS_PER_QUEUE 2
+#define LOCK_ATTEMPTS_PER_QUEUE 2
+#define POP_BACKOFF_ROUNDS 3
+
+/* every internal queue gets its own cache-line-aligned allocation, so threads working on
+   different queues never write to the same cache line. size is the size of queue, written under
+   the lock and read without it, so other threads can skip the queue or sum the sizes */
+typedef struct sub_queue_t {
+    pthread_mutex_t lock;
+    PriorityQueue queue;
+    int size;
+} *SubQueue;
+
+struct MultiQueue_t {
+    SubQueue* queues;
+    int queue_count;
+    ComparePQElementPriorities compare_priorities;
+};
+
+/* each thread keeps its random state in the value of this key, so picking a queue touches no shared data */
+static pthread_key_t random_key;
+static pthread_once_t random_key_once = PTHREAD_ONCE_INIT;
+static bool random_key_created = false;
+
+static void createRandomKey(void){
+    random_key_created = pthread_key_create(&random_key, NULL) == 0;
+}
+
+/*=========================================================================*/
+
+/* xorshift32, seeded from the address of the thread's stack the first time a thread calls it */
+static int randomQueueIndex(MultiQueue queue){
+    unsigned int state = (unsigned int)(uintptr_t)pthread_getspecific(random_key);
+    if(state == 0){
+        state = (unsigned int)((uintptr_t)&state >> 4) | 1;
+    }
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    pthread_setspecific(random_key, (void*)(uintptr_t)state);
+    return (int)(state % (unsigned int)queue->queue_count);
+}
+
+/* locks a random internal queue, trying other ones while they are busy, and blocks only if
+   every try failed */
+static SubQueue lockRandomQueue(MultiQueue queue){
+    int attempts = LOCK_ATTEMPTS_PER_QUEUE * queue->queue_count;
+    for(int attempt = 0; attempt < attempts; attempt++){
+        SubQueue sub_queue = queue->queues[randomQueueIndex(queue)];
+        if(pthread_mutex_trylock(&sub_queue->lock) == 0){
+            return sub_queue;
+        }
+    }
+    SubQueue sub_queue = queue->queues[randomQueueIndex(queue)];
+    pthread_mutex_lock(&sub_queue->lock);
+    return sub_queue;
+}
+
+static void destroySubQueue(SubQueue sub_queue){
+    if(sub_queue == NULL){
+        return;
+    }
+    pqDestroy(sub_queue->queue);
+    pthread_mutex_destroy(&sub_queue->lock);
+    free(sub_queue);
+}
+
+static SubQueue createSubQueue(CopyPQElement copy_element,
+                               FreePQElement free_element,
+                               EqualPQElements equal_elements,
+                               CopyPQElementPriority copy_priority,
+                               FreePQElementPriority free_priority,
+                               ComparePQElementPriorities compare_priorities){
+    void* memory = NULL;
+    if(posix_memalign(&memory, CACHE_LINE_SIZE, sizeof(struct sub_queue_t)) != 0){
+        return NULL;
+    }
+    SubQueue sub_queue = memory;
+    sub_queue->queue = pqCreate(copy_element, free_element, equal_elements,
+                                copy_priority, free_priority, compare_priorities);
+    if(sub_queue->queue == NULL){
+        free(sub_queue);
+        return NULL;
+    }
+    if(pthread_mutex_init(&sub_queue->lock, NULL) != 0){
+        pqDestroy(sub_queue->queue);
+        free(sub_queue);
+        return NULL;
+    }
+    sub_queue->size = 0;
+    return sub_queue;
+}
+
+MultiQueue mqCreate(int queue_count,
+                    CopyPQElement copy_element,
+                    FreePQElement free_element,
+                    EqualPQElements equal_elements,
+                    CopyPQElementPriority copy_priority,
+                    FreePQElementPriority free_priority,
+                    ComparePQElementPriorities compare_priorities){
+    if(queue_count < 1 || copy_element == NULL || free_element == NULL || equal_elements == NULL ||
+       copy_priority == NULL || free_priority == NULL || compare_priorities == NULL){
+        return NULL;
+    }
+    pthread_once(&random_key_once, createRandomKey);
+    if(!random_key_created){
+        return NULL;
+    }
+    MultiQueue queue = malloc(sizeof(*queue));
+    if(queue == NULL){
+        return NULL;
+    }
+    queue->queues = calloc(queue_count, sizeof(*queue->queues));
+    if(queue->queues == NULL){
+        free(queue);
+        return NULL;
+    }
+    queue->queue_count = queue_count;
+    queue->compare_priorities = compare_priorities;
+    for(int i = 0; i < queue_count; i++){
+        queue->queues[i] = createSubQueue(copy_element, free_element, equal_elements,
+                                          copy_priority, free_priority, compare_priorities);
+        if(queue->queues[i] == NULL){
+            mqDestroy(queue);
+            return NULL;
+        }
+    }
+    return queue;
+}
+
+
+void mqDestroy(MultiQueue queue){
+    if(queue == NULL){
+        return;
+    }
+    for(int i = 0; i < queue->queue_count; i++){
+        destroySubQueue(queue->queues[i]);
+    }
+    free(queue->queues);
+    free(queue);
+}
+
+
+/* called with the lock of sub_queue held, after its queue changed */
+static void updateSize(SubQueue sub_queue){
+    __atomic_store_n(&sub_queue->size, pqGetSize(sub_queue->queue), __ATOMIC_RELAXED);
+}
+
+/* the size of sub_queue when it was last changed, read without its lock */
+static int sizeOf(SubQueue sub_queue){
+    return __atomic_load_n(&sub_queue->size, __ATOMIC_RELAXED);
+}
+
+int mqGetSize(MultiQueue queue){
+    if(queue == NULL){
+        return -1;
+    }
+    int size = 0;
+    for(int i = 0; i < queue->queue_count; i++){
+        size += sizeOf(queue->queues[i]);
+    }
+    return size;
+}
+
+
+PriorityQueueResult mqInsert(MultiQueue queue, PQElement element, PQElementPriority priority){
+    if(queue == NULL || element == NULL || priority == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    SubQueue sub_queue = lockRandomQueue(queue);
+    PriorityQueueResult result = pqInsert(sub_queue->queue, element, priority);
+    updateSize(sub_queue);
+    pthread_mutex_unlock(&sub_queue->lock);
+    return result;
+}
+
+
+/* returns whichever of the two locked internal queues has the better first element, NULL if both are empty */
+static SubQueue betterQueue(MultiQueue queue, SubQueue first, SubQueue second){
+    PQElementPriority first_priority = pqGetFirstPriority(first->queue);
+    PQElementPriority second_priority = pqGetFirstPriority(second->queue);
+    if(first_priority == NULL || second_priority == NULL){
+        return first_priority != NULL ? first : (second_priority != NULL ? second : NULL);
+    }
+    return queue->compare_priorities(first_priority, second_priority) >= 0 ? first : second;
+}
+
+static PriorityQueueResult popFrom(SubQueue sub_queue, PQElement* element, PQElementPriority* priority){
+    PriorityQueueResult result = pqPopTake(sub_queue->queue, element, priority);
+    updateSize(sub_queue);
+    return result;
+}
+
+/* the two-choice pop: both queues are only tried, so two threads can never wait for each other.
+   queues that look empty are not even tried */
+static bool tryPopBetterOfTwo(MultiQueue queue, PQElement* element, PQElementPriority* priority){
+    int first_index = randomQueueIndex(queue);
+    int second_index = randomQueueIndex(queue);
+    if(queue->queue_count > 1 && second_index == first_index){
+        second_index = (first_index + 1) % queue->queue_count;
+    }
+    SubQueue first = queue->queues[first_index];
+    SubQueue second = queue->queues[second_index];
+    if(sizeOf(first) == 0 && sizeOf(second) == 0){
+        return false;
+    }
+    if(pthread_mutex_trylock(&first->lock) != 0){
+        return false;
+    }
+    if(second != first && pthread_mutex_trylock(&second->lock) != 0){
+        pthread_mutex_unlock(&first->lock);
+        return false;
+    }
+    SubQueue better = betterQueue(queue, first, second);
+    bool popped = better != NULL && popFrom(better, element, priority) == PQ_SUCCESS;
+    if(second != first){
+        pthread_mutex_unlock(&second->lock);
+    }
+    pthread_mutex_unlock(&first->lock);
+    return popped;
+}
+
+PriorityQueueResult mqPopTake(MultiQueue queue, PQElement* element, PQElementPriority* priority){
+    if(queue == NULL || element == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    /* after every round of random tries that kept hitting busy or empty queues, the thread yields
+       a growing number of times to let the threads holding the locks finish */
+    int attempts = POP_ATTEMPTS_PER_QUEUE * queue->queue_count;
+    for(int round = 0; round < POP_BACKOFF_ROUNDS; round++){
+        if(mqGetSize(queue) == 0){
+            return PQ_ELEMENT_DOES_NOT_EXISTS;
+        }
+        for(int attempt = 0; attempt < attempts; attempt++){
+            if(tryPopBetterOfTwo(queue, element, priority)){
+                return PQ_SUCCESS;
+            }
+        }
+        for(int yield = 0; yield < 1 << round; yield++){
+            sched_yield();
+        }
+    }
+    /* backing off did not help either: lock all of them and pop the best first element.
+       they are locked in order, and the other functions hold at most one lock while waiting, so this
+       never deadlocks */
+    SubQueue best = NULL;
+    for(int i = 0; i < queue->queue_count; i++){
+        SubQueue sub_queue = queue->queues[i];
+        pthread_mutex_lock(&sub_queue->lock);
+        best = betterQueue(queue, best == NULL ? sub_queue : best, sub_queue);
+    }
+    PriorityQueueResult result = best == NULL ? PQ_ELEMENT_DOES_NOT_EXISTS : popFrom(best, element, priority);
+    for(int i = 0; i < queue->queue_count; i++){
+        pthread_mutex_unlock(&queue->queues[i]->lock);
+    }
+    return result;
+}
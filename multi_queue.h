@@ -0,0 +1,69 @@
+#ifndef MULTI_QUEUE_H
+#define MULTI_QUEUE_H
+
+#include <stdbool.h>
+#include "priority_queue.h"
+
+/**
+* Relaxed Multi Queue
+*
+* A priority queue for many threads that gives up strict order to avoid a single point of contention.
+* It keeps several regular priority queues, each behind its own lock. An insertion goes to a random
+* internal queue, and a removal looks at the first elements of two random internal queues and takes
+* the better one. Locks are only tried, never waited for, so a thread that finds a queue busy just
+* picks another one, and throughput grows with the number of threads.
+*
+* Rank error: a removal does not always take the element of highest priority. With q internal queues,
+* the removed element's expected rank among the queued elements is O(q), and O(q log q) with high
+* probability, independently of the number of elements. Elements of equal priority that were inserted
+* into different internal queues may be removed in any order.
+*
+* The following functions are available:
+*   mqCreate            - Creates a new empty multi queue
+*   mqDestroy           - Deletes an existing multi queue and frees all resources
+*   mqGetSize           - Returns the number of elements in a multi queue
+*   mqInsert            - Inserts a copy of an element with a given priority
+*   mqPopTake           - Removes one of the highest priority elements and hands it to the caller
+*/
+
+typedef struct MultiQueue_t *MultiQueue;
+
+
+/* this function creates a new empty multi queue of queue_count internal queues, which should be a small
+   multiple, 2 to 4, of the number of threads using it. the functions are the ones of pqCreate.
+   returns NULL if queue_count is smaller than 1, a function is NULL or an allocation failed */
+MultiQueue mqCreate(int queue_count,
+                    CopyPQElement copy_element,
+                    FreePQElement free_element,
+                    EqualPQElements equal_elements,
+                    CopyPQElementPriority copy_priority,
+                    FreePQElementPriority free_priority,
+                    ComparePQElementPriorities compare_priorities);
+
+
+/* this function de-allocates the multi queue and every element in it. it must not be used by other
+   threads while it is destroyed */
+void mqDestroy(MultiQueue queue);
+
+
+/* this function returns the number of elements in the multi queue, -1 if NULL was sent. it adds up
+   the sizes of the internal queues, so while other threads change the queue, the result is approximate:
+   it may miss changes made while it was counting, and may already be outdated when it is returned */
+int mqGetSize(MultiQueue queue);
+
+
+/* this function inserts copies of element and priority into one of the internal queues.
+   may be called by any number of threads at once */
+PriorityQueueResult mqInsert(MultiQueue queue, PQElement element, PQElementPriority priority);
+
+
+/* this function removes one of the highest priority elements, within the rank error described above,
+   and hands it and its priority to the caller, like pqPopTake. if its random tries keep finding queues
+   busy or empty, it backs off and tries again a few times, and then locks every internal queue and
+   removes the highest priority element of all.
+   priority may be NULL, in which case the priority is freed. returns PQ_ELEMENT_DOES_NOT_EXISTS if
+   every internal queue was empty.
+   may be called by any number of threads at once */
+PriorityQueueResult mqPopTake(MultiQueue queue, PQElement* element, PQElementPriority* priority);
+
+#endif //MULTI_QUEUE_H
@@ -0,0 +1,351 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include "pq_executor.h"
+#include "priority_queue.h"
+
+#define CACHE_LINE_SIZE 64
+
+typedef struct task_t {
+    PQTask function;
+    void* argument;
+} *Task;
+
+/* each worker gets its own cache-line-aligned allocation, so workers locking their own queues
+   do not write to each other's cache lines */
+typedef struct worker_t {
+    pthread_mutex_t lock;
+    PriorityQueue tasks;
+    pthread_t thread;
+    unsigned int random_state;
+    int index;
+    struct PQExecutor_t* executor;
+} *Worker;
+
+struct PQExecutor_t {
+    Worker* workers;
+    int worker_count;
+    int started_count;
+    unsigned int next_worker;
+    ComparePQElementPriorities compare_priorities;
+
+    /* queued counts the tasks in the workers' queues, unfinished also the running ones, and sleeping the
+       workers waiting for work_available. all change atomically. a task may be taken just before it is
+       counted, so queued can briefly be negative. a worker counts itself as sleeping before it checks
+       queued, and a submitter counts its task before it checks sleeping, so when neither sees the other
+       the submitter signals under lock and the worker is woken */
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;
+    pthread_cond_t all_done;
+    int queued;
+    int unfinished;
+    int sleeping;
+    bool stopping;
+};
+
+/* holds the worker the current thread is, if any */
+static pthread_key_t worker_key;
+static pthread_once_t worker_key_once = PTHREAD_ONCE_INIT;
+static bool worker_key_created = false;
+
+static void createWorkerKey(void){
+    worker_key_created = pthread_key_create(&worker_key, NULL) == 0;
+}
+
+/*=========================================================================*/
+/* wrapper functions for the tasks' priority queues: a task is copied once when it is submitted,
+   and handed out of its queue with pqPopTake */
+
+static PQElement taskCopy(PQElement task){
+    Task copy = malloc(sizeof(*copy));
+    if(copy != NULL){
+        *copy = *(Task)task;
+    }
+    return copy;
+}
+
+static void taskDestroy(PQElement task){
+    free(task);
+}
+
+static bool taskEqual(PQElement first, PQElement second){
+    return first == second;
+}
+
+/*=========================================================================*/
+
+static int randomWorkerIndex(Worker worker){
+    unsigned int state = worker->random_state;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    worker->random_state = state;
+    return (int)(state % (unsigned int)worker->executor->worker_count);
+}
+
+/* pops the first task of a locked worker's queue, NULL if it is empty */
+static Task popTask(PQExecutor executor, Worker worker){
+    PQElement task = NULL;
+    if(pqPopTake(worker->tasks, &task, NULL) != PQ_SUCCESS){
+        return NULL;
+    }
+    __atomic_sub_fetch(&executor->queued, 1, __ATOMIC_ACQ_REL);
+    return task;
+}
+
+/* takes the better of the first tasks of the worker's own queue and a random other queue, whose lock is
+   only tried. if that finds nothing, every other queue is tried in turn */
+static Task takeTask(Worker worker){
+    PQExecutor executor = worker->executor;
+    int victim_index = randomWorkerIndex(worker);
+    Worker victim = executor->workers[victim_index];
+    pthread_mutex_lock(&worker->lock);
+    Task task = NULL;
+    if(victim != worker && pthread_mutex_trylock(&victim->lock) == 0){
+        PQElementPriority own = pqGetFirstPriority(worker->tasks);
+        PQElementPriority other = pqGetFirstPriority(victim->tasks);
+        bool steal = other != NULL && (own == NULL || executor->compare_priorities(other, own) > 0);
+        task = popTask(executor, steal ? victim : worker);
+        pthread_mutex_unlock(&victim->lock);
+    }else{
+        task = popTask(executor, worker);
+    }
+    pthread_mutex_unlock(&worker->lock);
+
+    for(int i = 1; task == NULL && i < executor->worker_count; i++){
+        victim = executor->workers[(worker->index + i) % executor->worker_count];
+        if(pthread_mutex_trylock(&victim->lock) == 0){
+            task = popTask(executor, victim);
+            pthread_mutex_unlock(&victim->lock);
+        }
+    }
+    return task;
+}
+
+static void finishTask(PQExecutor executor){
+    if(__atomic_sub_fetch(&executor->unfinished, 1, __ATOMIC_ACQ_REL) == 0){
+        pthread_mutex_lock(&executor->lock);
+        pthread_cond_broadcast(&executor->all_done);
+        pthread_mutex_unlock(&executor->lock);
+    }
+}
+
+static bool isStopping(PQExecutor executor){
+    return __atomic_load_n(&executor->stopping, __ATOMIC_ACQUIRE);
+}
+
+/* sleeps until there is a queued task or the executor stops. returns false if the worker should exit */
+static bool waitForWork(PQExecutor executor){
+    pthread_mutex_lock(&executor->lock);
+    __atomic_add_fetch(&executor->sleeping, 1, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(&executor->queued, __ATOMIC_SEQ_CST) <= 0 && !isStopping(executor)){
+        pthread_cond_wait(&executor->work_available, &executor->lock);
+    }
+    __atomic_sub_fetch(&executor->sleeping, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&executor->lock);
+    return !isStopping(executor);
+}
+
+static void* workerRun(void* argument){
+    Worker worker = argument;
+    PQExecutor executor = worker->executor;
+    pthread_setspecific(worker_key, worker);
+    while(!isStopping(executor)){
+        Task task = takeTask(worker);
+        if(task != NULL){
+            task->function(task->argument);
+            free(task);
+            finishTask(executor);
+            continue;
+        }
+        if(__atomic_load_n(&executor->queued, __ATOMIC_ACQUIRE) > 0){
+            /* a task is queued but its queue was busy */
+            sched_yield();
+            continue;
+        }
+        if(!waitForWork(executor)){
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*=========================================================================*/
+
+static void destroyWorker(Worker worker){
+    if(worker == NULL){
+        return;
+    }
+    pqDestroy(worker->tasks);
+    pthread_mutex_destroy(&worker->lock);
+    free(worker);
+}
+
+static Worker createWorker(PQExecutor executor, int index,
+                           CopyPQElementPriority copy_priority,
+                           FreePQElementPriority free_priority,
+                           ComparePQElementPriorities compare_priorities){
+    void* memory = NULL;
+    if(posix_memalign(&memory, CACHE_LINE_SIZE, sizeof(struct worker_t)) != 0){
+        return NULL;
+    }
+    Worker worker = memory;
+    worker->tasks = pqCreate(taskCopy, taskDestroy, taskEqual, copy_priority, free_priority, compare_priorities);
+    if(worker->tasks == NULL){
+        free(worker);
+        return NULL;
+    }
+    if(pthread_mutex_init(&worker->lock, NULL) != 0){
+        pqDestroy(worker->tasks);
+        free(worker);
+        return NULL;
+    }
+    worker->executor = executor;
+    worker->index = index;
+    worker->random_state = 2654435761u * (unsigned int)(index + 1);
+    return worker;
+}
+
+/* stops and joins the started workers, then frees everything. pending tasks are discarded */
+static void destroyExecutor(PQExecutor executor){
+    pthread_mutex_lock(&executor->lock);
+    __atomic_store_n(&executor->stopping, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&executor->work_available);
+    pthread_mutex_unlock(&executor->lock);
+    for(int i = 0; i < executor->started_count; i++){
+        pthread_join(executor->workers[i]->thread, NULL);
+    }
+    for(int i = 0; i < executor->worker_count; i++){
+        destroyWorker(executor->workers[i]);
+    }
+    pthread_cond_destroy(&executor->all_done);
+    pthread_cond_destroy(&executor->work_available);
+    pthread_mutex_destroy(&executor->lock);
+    free(executor->workers);
+    free(executor);
+}
+
+static bool initSynchronization(PQExecutor executor){
+    if(pthread_mutex_init(&executor->lock, NULL) != 0){
+        return false;
+    }
+    if(pthread_cond_init(&executor->work_available, NULL) != 0){
+        pthread_mutex_destroy(&executor->lock);
+        return false;
+    }
+    if(pthread_cond_init(&executor->all_done, NULL) != 0){
+        pthread_cond_destroy(&executor->work_available);
+        pthread_mutex_destroy(&executor->lock);
+        return false;
+    }
+    return true;
+}
+
+PQExecutor pqExecutorCreate(int threads,
+                            CopyPQElementPriority copy_priority,
+                            FreePQElementPriority free_priority,
+                            ComparePQElementPriorities compare_priorities){
+    if(threads < 1 || copy_priority == NULL || free_priority == NULL || compare_priorities == NULL){
+        return NULL;
+    }
+    pthread_once(&worker_key_once, createWorkerKey);
+    if(!worker_key_created){
+        return NULL;
+    }
+    PQExecutor executor = malloc(sizeof(*executor));
+    if(executor == NULL){
+        return NULL;
+    }
+    executor->workers = calloc(threads, sizeof(*executor->workers));
+    if(executor->workers == NULL || !initSynchronization(executor)){
+        free(executor->workers);
+        free(executor);
+        return NULL;
+    }
+    executor->worker_count = threads;
+    executor->started_count = 0;
+    executor->next_worker = 0;
+    executor->compare_priorities = compare_priorities;
+    executor->queued = 0;
+    executor->unfinished = 0;
+    executor->sleeping = 0;
+    executor->stopping = false;
+    for(int i = 0; i < threads; i++){
+        executor->workers[i] = createWorker(executor, i, copy_priority, free_priority, compare_priorities);
+        if(executor->workers[i] == NULL){
+            destroyExecutor(executor);
+            return NULL;
+        }
+    }
+    for(int i = 0; i < threads; i++){
+        if(pthread_create(&executor->workers[i]->thread, NULL, workerRun, executor->workers[i]) != 0){
+            destroyExecutor(executor);
+            return NULL;
+        }
+        executor->started_count++;
+    }
+    return executor;
+}
+
+
+PQExecutorResult pqExecutorSubmit(PQExecutor executor, PQTask task, void* argument, PQElementPriority priority){
+    if(executor == NULL || task == NULL || priority == NULL){
+        return PQ_EXECUTOR_NULL_ARGUMENT;
+    }
+    if(isStopping(executor)){
+        return PQ_EXECUTOR_SHUT_DOWN;
+    }
+    Worker worker = pthread_getspecific(worker_key);
+    if(worker == NULL || worker->executor != executor){
+        unsigned int next = __atomic_fetch_add(&executor->next_worker, 1, __ATOMIC_RELAXED);
+        worker = executor->workers[next % (unsigned int)executor->worker_count];
+    }
+
+    /* counted as unfinished first, so a worker finishing it at once never sees the count drop to 0 early */
+    __atomic_add_fetch(&executor->unfinished, 1, __ATOMIC_ACQ_REL);
+    struct task_t new_task = {task, argument};
+    pthread_mutex_lock(&worker->lock);
+    PriorityQueueResult result = pqInsert(worker->tasks, &new_task, priority);
+    pthread_mutex_unlock(&worker->lock);
+    if(result != PQ_SUCCESS){
+        finishTask(executor);
+        return PQ_EXECUTOR_OUT_OF_MEMORY;
+    }
+
+    /* the executor's lock is only taken to wake a sleeping worker, so submitting while every worker is busy
+       never contends for it */
+    __atomic_add_fetch(&executor->queued, 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&executor->sleeping, __ATOMIC_SEQ_CST) > 0){
+        pthread_mutex_lock(&executor->lock);
+        pthread_cond_signal(&executor->work_available);
+        pthread_mutex_unlock(&executor->lock);
+    }
+    return PQ_EXECUTOR_SUCCESS;
+}
+
+
+void pqExecutorWait(PQExecutor executor){
+    if(executor == NULL){
+        return;
+    }
+    pthread_mutex_lock(&executor->lock);
+    while(__atomic_load_n(&executor->unfinished, __ATOMIC_ACQUIRE) > 0){
+        pthread_cond_wait(&executor->all_done, &executor->lock);
+    }
+    pthread_mutex_unlock(&executor->lock);
+}
+
+
+void pqExecutorDestroy(PQExecutor executor, bool run_pending){
+    if(executor == NULL){
+        return;
+    }
+    if(run_pending){
+        pqExecutorWait(executor);
+    }
+    destroyExecutor(executor);
+}
@@ -0,0 +1,64 @@
+#ifndef PQ_EXECUTOR_H
+#define PQ_EXECUTOR_H
+
+#include <stdbool.h>
+#include "priority_queue.h"
+
+/**
+* Priority Executor
+*
+* A pool of worker threads that runs submitted tasks, higher priority first. Priorities are
+* PQElementPriority values handled by the functions given at creation, like in a priority queue.
+*
+* Every worker has its own priority queue of tasks. A task submitted from one of the executor's
+* workers goes to that worker's queue, other tasks are spread over the workers in turn. Before each
+* task a worker compares the first task of its own queue with the first task of another, random worker's
+* queue and runs the better one, and a worker whose queue is empty steals from the others, so a high
+* priority task does not stay behind a busy worker. Idle workers sleep until a task is submitted.
+*
+* The following functions are available:
+*   pqExecutorCreate    - Creates an executor and starts its workers
+*   pqExecutorSubmit    - Submits a task with a priority
+*   pqExecutorWait      - Waits until every submitted task has run
+*   pqExecutorDestroy   - Stops the workers, running or discarding the tasks that did not run yet
+*/
+
+typedef struct PQExecutor_t *PQExecutor;
+
+/** Type of the tasks an executor runs, called with the argument given when the task was submitted */
+typedef void(*PQTask)(void*);
+
+/** Type used for returning error codes from executor functions */
+typedef enum PQExecutorResult_t {
+    PQ_EXECUTOR_SUCCESS,
+    PQ_EXECUTOR_OUT_OF_MEMORY,
+    PQ_EXECUTOR_NULL_ARGUMENT,
+    PQ_EXECUTOR_SHUT_DOWN
+} PQExecutorResult;
+
+
+/* this function creates an executor with the given number of workers and starts them.
+   returns NULL if threads is smaller than 1, a function is NULL, or an allocation or thread creation failed */
+PQExecutor pqExecutorCreate(int threads,
+                            CopyPQElementPriority copy_priority,
+                            FreePQElementPriority free_priority,
+                            ComparePQElementPriorities compare_priorities);
+
+
+/* this function submits task to run with argument, at the given priority, which is copied.
+   may be called by any thread, including from running tasks.
+   returns PQ_EXECUTOR_SHUT_DOWN once pqExecutorDestroy was called */
+PQExecutorResult pqExecutorSubmit(PQExecutor executor, PQTask task, void* argument, PQElementPriority priority);
+
+
+/* this function blocks until every task submitted so far, and every task they submitted, has run.
+   must not be called from a task */
+void pqExecutorWait(PQExecutor executor);
+
+
+/* this function stops the workers and de-allocates the executor. if run_pending is true it first waits
+   like pqExecutorWait, so every task runs, otherwise the tasks that did not start yet are discarded
+   without running. tasks that are running are always finished. must not be called from a task */
+void pqExecutorDestroy(PQExecutor executor, bool run_pending);
+
+#endif //PQ_EXECUTOR_H
@@ -1,22 +1,115 @@
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <time.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <errno.h>
 #include "priority_queue.h"
+#include "checksum.h"
 
+#define INITIAL_CAPACITY 8
+#define EXPAND_FACTOR 2
+#define NO_ITERATOR -1
+#define NANOSECONDS_IN_SECOND 1000000000ULL
+#define INITIAL_INDEX_BUCKETS 16
+#define NOT_FOUND -1
+#define HANDLE_ID_BITS 32
+#define HANDLE_ID_MASK 0xFFFFFFFFULL
+#define FIRST_GENERATION 1
+#define CACHE_LINE_SIZE 64
+#define NODES_PER_SLAB 64
+#define MIN_BATCH_PER_THREAD 4096
+#define COMBINING_SLOTS 64
+#define COMBINING_PASSES 4
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BUFFER_SIZE 65536
 
 
-
+/* the queue is an array-backed binary heap of nodes. ties between equal priorities are broken by
+   insertion_order, so an element inserted later always comes after the ones already queued */
 typedef struct node {
     PQElement element;
     PQElementPriority priority;
-    struct node* next_node;
+    unsigned long long insertion_order;
+    int heap_index;
+
+    /* the node's position in worst_heap, used only by bounded queues */
+    int worst_index;
+
+    /* the node's position in the pool, and a counter that changes whenever the node is recycled.
+       together they make the node's handle, so stale handles are detected */
+    int id;
+    unsigned int generation;
+
+    /* used only by indexed queues: the element's hash and the next node in its index bucket.
+       next_in_bucket also links the pool's free list while the node is not queued */
+    unsigned int hash;
+    struct node* next_in_bucket;
 }*Node;
 
+typedef struct combiner* Combiner;
+
 struct PriorityQueue_t {
-    Node first_node;
-    Node iterator;
+    Node* heap;
+    int size;
+    int capacity;
+    unsigned long long next_insertion_order;
+
+    /* bounded queues only: at most bound nodes, and a second heap of the same nodes ordered the other way,
+       so the node that comes last in the queue is always at worst_heap[0]. bound is 0 otherwise */
+    int bound;
+    Node* worst_heap;
+    int worst_size;
+
+    /* the heap nodes sorted by priority, built on demand for iteration. every queue builds its own, also
+       from a frozen content it shares, so iterating never writes to the shared content. it always has
+       room for the whole heap of the content, so building it never allocates */
+    Node* order;
+    int order_capacity;
+    bool order_valid;
+    int iterator;
+
+    /* NULL unless statistics were enabled with pqEnableStats */
+    PQStats* stats;
+
+    /* element -> nodes hash index, NULL unless the queue was created with pqCreateIndexed.
+       bucket_count is always a power of two */
+    Node* index_buckets;
+    int index_bucket_count;
+
+    /* node pool: nodes live in cache-line-aligned slabs of NODES_PER_SLAB and are recycled
+       through a free list. a slab released by pqShrinkToFit leaves a NULL hole so ids stay stable */
+    Node* slabs;
+    int slab_count;
+    int slabs_capacity;
+    Node first_free_node;
+    int free_node_count;
+    unsigned int retired_generation;
+
+    /* the most threads pqInsertBatch may copy elements with, see pqSetBatchThreads */
+    int batch_threads;
+
+    /* copy-on-write: pqCopy of a queue with copy_on_write set moves its content into a frozen queue
+       that the original and the copy then share, and both read from it until their first change.
+       share_count is used only by frozen queues, and counts the queues sharing them */
+    bool copy_on_write;
+    struct PriorityQueue_t* shared;
+    int share_count;
+
+    /* counts the changes to the queue, so cursors opened before a change can tell */
+    unsigned long long modification_count;
+
+    /* NULL unless the queue was created with pqCreateConcurrent */
+    Combiner combiner;
 
     PQElement(*CopyPQElement)(PQElement);
     PQElementPriority(*CopyPQElementPriority)(PQElementPriority);
@@ -24,362 +117,2696 @@ struct PriorityQueue_t {
     void(*FreePQElementPriority)(PQElementPriority);
     bool(*EqualPQElements)(PQElement, PQElement);
     int(*ComparePQElementPriorities)(PQElementPriority, PQElementPriority);
+    unsigned int(*HashPQElement)(PQElement);
 };
 
+/* gives the queue an empty content. the callbacks must already be set */
+static bool initContent(PriorityQueue queue){
+    queue->heap = malloc(sizeof(*queue->heap) * INITIAL_CAPACITY);
+    if (queue->heap == NULL) {
+        return false;
+    }
+    queue->slabs = NULL;
+    queue->slab_count = 0;
+    queue->slabs_capacity = 0;
+    queue->first_free_node = NULL;
+    queue->free_node_count = 0;
+    queue->retired_generation = 0;
+
+    queue->size = 0;
+    queue->capacity = INITIAL_CAPACITY;
+    queue->next_insertion_order = 0;
+
+    queue->index_buckets = NULL;
+    queue->index_bucket_count = 0;
+    if(queue->HashPQElement != NULL){
+        queue->index_buckets = calloc(INITIAL_INDEX_BUCKETS, sizeof(*queue->index_buckets));
+        if(queue->index_buckets == NULL){
+            free(queue->heap);
+            return false;
+        }
+        queue->index_bucket_count = INITIAL_INDEX_BUCKETS;
+    }
+
+    queue->worst_heap = NULL;
+    queue->worst_size = 0;
+    if(queue->bound > 0){
+        queue->worst_heap = malloc(sizeof(*queue->worst_heap) * queue->bound);
+        if(queue->worst_heap == NULL){
+            free(queue->index_buckets);
+            free(queue->heap);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* makes sure the iteration order of queue can hold capacity nodes */
+static bool reserveOrder(PriorityQueue queue, int capacity){
+    if(capacity <= queue->order_capacity){
+        return true;
+    }
+    Node* order = realloc(queue->order, sizeof(*order) * capacity);
+    if(order == NULL){
+        return false;
+    }
+    queue->order = order;
+    queue->order_capacity = capacity;
+    return true;
+}
+
+static PriorityQueue createQueue(CopyPQElement copy_element,
+                                 FreePQElement free_element,
+                                 EqualPQElements equal_elements,
+                                 HashPQElement hash_element,
+                                 CopyPQElementPriority copy_priority,
+                                 FreePQElementPriority free_priority,
+                                 ComparePQElementPriorities compare_priorities){
+    PriorityQueue queue = malloc(sizeof(*queue));
+    if (!queue) {
+        return NULL;
+    }
+    queue->CopyPQElement = copy_element;
+    queue->CopyPQElementPriority = copy_priority;
+    queue->FreePQElement = free_element;
+    queue->FreePQElementPriority = free_priority;
+    queue->EqualPQElements = equal_elements;
+    queue->ComparePQElementPriorities = compare_priorities;
+    queue->HashPQElement = hash_element;
+    queue->bound = 0;
+    queue->order = NULL;
+    queue->order_capacity = 0;
+    queue->order_valid = false;
+    if(!reserveOrder(queue, INITIAL_CAPACITY)){
+        free(queue);
+        return NULL;
+    }
+    if(!initContent(queue)){
+        free(queue->order);
+        free(queue);
+        return NULL;
+    }
+    queue->iterator = NO_ITERATOR;
+    queue->stats = NULL;
+    queue->batch_threads = 1;
+    queue->copy_on_write = false;
+    queue->shared = NULL;
+    queue->share_count = 0;
+    queue->modification_count = 0;
+    queue->combiner = NULL;
+    return queue;
+}
+
 PriorityQueue pqCreate(CopyPQElement copy_element,
                        FreePQElement free_element,
                        EqualPQElements equal_elements,
                        CopyPQElementPriority copy_priority,
                        FreePQElementPriority free_priority,
                        ComparePQElementPriorities compare_priorities){
+    return createQueue(copy_element, free_element, equal_elements, NULL,
+                       copy_priority, free_priority, compare_priorities);
+}
 
-                           PriorityQueue queue;
-                           queue = malloc(sizeof(*queue));
-                            if (!queue) {
-                                return NULL;
-                            }
-
-                            queue->first_node = NULL;
-                            queue->iterator = NULL;
-
-                            queue->CopyPQElement = copy_element;
-                            queue->CopyPQElementPriority = copy_priority;
-                            queue->FreePQElement = free_element;
-                            queue->FreePQElementPriority = free_priority;
-                            queue->EqualPQElements = equal_elements;
-                            queue->ComparePQElementPriorities = compare_priorities;
-                            return queue;
-                       }
-
-// new func - satatic - delete node
-static Node deleteNode(Node to_delete, FreePQElement free_element, FreePQElementPriority free_priority){
-    if(to_delete == NULL){
+PriorityQueue pqCreateIndexed(CopyPQElement copy_element,
+                              FreePQElement free_element,
+                              EqualPQElements equal_elements,
+                              HashPQElement hash_element,
+                              CopyPQElementPriority copy_priority,
+                              FreePQElementPriority free_priority,
+                              ComparePQElementPriorities compare_priorities){
+    if(hash_element == NULL){
         return NULL;
     }
-    Node next = to_delete->next_node;
-    free_element(to_delete->element);
-    free_priority(to_delete->priority);
-    free(to_delete);
-    return next;
+    return createQueue(copy_element, free_element, equal_elements, hash_element,
+                       copy_priority, free_priority, compare_priorities);
 }
 
-static void destroyLinkedList(Node node, FreePQElement free_element, FreePQElementPriority free_priority){
-    while (node){
-       node = deleteNode(node, free_element, free_priority);
+/* gives an empty queue a bound, allocating its worst heap */
+static bool setBound(PriorityQueue queue, int bound){
+    queue->worst_heap = malloc(sizeof(*queue->worst_heap) * bound);
+    if(queue->worst_heap == NULL){
+        return false;
     }
+    queue->bound = bound;
+    queue->worst_size = 0;
+    return true;
 }
 
-void pqDestroy(PriorityQueue queue){
+PriorityQueue pqCreateBounded(int capacity,
+                              CopyPQElement copy_element,
+                              FreePQElement free_element,
+                              EqualPQElements equal_elements,
+                              CopyPQElementPriority copy_priority,
+                              FreePQElementPriority free_priority,
+                              ComparePQElementPriorities compare_priorities){
+    if(capacity < 1){
+        return NULL;
+    }
+    PriorityQueue queue = createQueue(copy_element, free_element, equal_elements, NULL,
+                                      copy_priority, free_priority, compare_priorities);
     if(queue == NULL){
-        return;
+        return NULL;
     }
-    destroyLinkedList(queue->first_node, queue->FreePQElement, queue->FreePQElementPriority);
-    free(queue);
-    return;
+    if(!setBound(queue, capacity)){
+        pqDestroy(queue);
+        return NULL;
+    }
+    return queue;
 }
 
-static Node nodeCreate(PQElement element, PQElementPriority priority){
-    Node node = malloc(sizeof(*node));
-    if (node == NULL){
-        return NULL;
+/*=========================================================================*/
+/* flat combining: every call on a concurrent queue is published as a pending call in one of the
+   combiner's slots. whichever thread gets the lock becomes the combiner and runs all the published
+   calls one after the other, by calling the same public functions, while the other threads wait for
+   their own call to be marked done. a thread that finds every slot taken runs its call under the lock */
+
+typedef enum call_kind {
+    CALL_COPY,
+    CALL_GET_SIZE,
+    CALL_CONTAINS,
+    CALL_INSERT,
+    CALL_INSERT_TAKE,
+    CALL_INSERT_BATCH,
+    CALL_MELD,
+    CALL_REMOVE,
+    CALL_POP_TAKE,
+    CALL_POP_BATCH,
+    CALL_DRAIN_WHILE,
+    CALL_REMOVE_ELEMENT,
+    CALL_CHANGE_PRIORITY,
+    CALL_CHANGE_PRIORITY_BY_HANDLE,
+    CALL_REMOVE_BY_HANDLE,
+    CALL_GET_BY_HANDLE,
+    CALL_GET_FIRST,
+    CALL_GET_FIRST_PRIORITY,
+    CALL_GET_NEXT,
+    CALL_CURSOR_OPEN,
+    CALL_CURSOR_NEXT,
+    CALL_CLEAR,
+    CALL_ENABLE_STATS,
+    CALL_GET_STATS,
+    CALL_RESET_STATS,
+    CALL_SHRINK_TO_FIT,
+    CALL_SAVE
+} CallKind;
+
+/* the arguments and result of one public call. only the fields its kind uses are set */
+typedef struct pending_call {
+    CallKind kind;
+    PriorityQueue queue;
+    PriorityQueue source;
+    PQElement element;
+    PQElementPriority priority;
+    PQElementPriority new_priority;
+    PQElement* elements;
+    PQElementPriority* priorities;
+    int count;
+    PQHandle handle;
+    PQHandle* handle_out;
+    PQDrainPredicate predicate;
+    void* context;
+    PQStats* stats;
+    PQCursor cursor;
+    bool flag;
+    SerializePQElement serialize_element;
+    SerializePQElementPriority serialize_priority;
+
+    PriorityQueueResult result;
+    int count_result;
+    bool flag_result;
+    PQElement element_result;
+    PriorityQueue queue_result;
+    PQCursor cursor_result;
+    int done;
+} PendingCall;
+
+/* each slot on its own cache line, so threads publishing calls do not slow each other down */
+typedef struct combining_slot {
+    PendingCall* call;
+    char padding[CACHE_LINE_SIZE - sizeof(PendingCall*)];
+} CombiningSlot;
+
+struct combiner {
+    CombiningSlot slots[COMBINING_SLOTS];
+    pthread_mutex_t lock;
+};
+
+/* holds, for each thread, the queue it is currently combining for */
+static pthread_key_t combining_key;
+static pthread_once_t combining_key_once = PTHREAD_ONCE_INIT;
+static bool combining_key_created = false;
+
+static void createCombiningKey(void){
+    combining_key_created = pthread_key_create(&combining_key, NULL) == 0;
+}
+
+/* whether a call on queue has to go through its combiner. calls made by the combiner itself,
+   including from user callbacks, run directly */
+static bool isCombined(PriorityQueue queue){
+    return queue != NULL && queue->combiner != NULL && pthread_getspecific(combining_key) != queue;
+}
+
+static void executeCall(PendingCall* call){
+    PriorityQueue queue = call->queue;
+    switch(call->kind){
+    case CALL_COPY:
+        call->queue_result = pqCopy(queue);
+        break;
+    case CALL_GET_SIZE:
+        call->count_result = pqGetSize(queue);
+        break;
+    case CALL_CONTAINS:
+        call->flag_result = pqContains(queue, call->element);
+        break;
+    case CALL_INSERT:
+        call->result = pqInsertWithHandle(queue, call->element, call->priority, call->handle_out);
+        break;
+    case CALL_INSERT_TAKE:
+        call->result = pqInsertTake(queue, call->element, call->priority);
+        break;
+    case CALL_INSERT_BATCH:
+        call->result = pqInsertBatch(queue, call->elements, call->priorities, call->count);
+        break;
+    case CALL_MELD:
+        call->result = pqMeld(queue, call->source);
+        break;
+    case CALL_REMOVE:
+        call->result = pqRemove(queue);
+        break;
+    case CALL_POP_TAKE:
+        call->result = pqPopTake(queue, call->elements, call->priorities);
+        break;
+    case CALL_POP_BATCH:
+        call->count_result = pqPopBatch(queue, call->count, call->elements, call->priorities);
+        break;
+    case CALL_DRAIN_WHILE:
+        call->count_result = pqDrainWhile(queue, call->predicate, call->context,
+                                          call->elements, call->priorities, call->count);
+        break;
+    case CALL_REMOVE_ELEMENT:
+        call->result = pqRemoveElement(queue, call->element);
+        break;
+    case CALL_CHANGE_PRIORITY:
+        call->result = pqChangePriority(queue, call->element, call->priority, call->new_priority);
+        break;
+    case CALL_CHANGE_PRIORITY_BY_HANDLE:
+        call->result = pqChangePriorityByHandle(queue, call->handle, call->new_priority);
+        break;
+    case CALL_REMOVE_BY_HANDLE:
+        call->result = pqRemoveByHandle(queue, call->handle);
+        break;
+    case CALL_GET_BY_HANDLE:
+        call->element_result = pqGetByHandle(queue, call->handle);
+        break;
+    case CALL_GET_FIRST:
+        call->element_result = pqGetFirst(queue);
+        break;
+    case CALL_GET_FIRST_PRIORITY:
+        call->element_result = pqGetFirstPriority(queue);
+        break;
+    case CALL_GET_NEXT:
+        call->element_result = pqGetNext(queue);
+        break;
+    case CALL_CURSOR_OPEN:
+        call->cursor_result = pqCursorOpen(queue);
+        break;
+    case CALL_CURSOR_NEXT:
+        call->element_result = pqCursorNext(call->cursor);
+        break;
+    case CALL_CLEAR:
+        call->result = pqClear(queue);
+        break;
+    case CALL_ENABLE_STATS:
+        call->result = pqEnableStats(queue, call->flag);
+        break;
+    case CALL_GET_STATS:
+        call->result = pqGetStats(queue, call->stats);
+        break;
+    case CALL_RESET_STATS:
+        call->result = pqResetStats(queue);
+        break;
+    case CALL_SHRINK_TO_FIT:
+        call->result = pqShrinkToFit(queue);
+        break;
+    case CALL_SAVE:
+        call->result = pqSave(queue, call->count, call->serialize_element, call->serialize_priority);
+        break;
     }
-    node->element = element;
-    node->priority = priority;
-    node->next_node = NULL;
-    return node;
 }
 
+/* runs every published call, for a few passes so calls published meanwhile are picked up too.
+   must be called with the combiner's lock held */
+static void combinePendingCalls(PriorityQueue queue){
+    Combiner combiner = queue->combiner;
+    /* a callback may use another concurrent queue, so the queue combined before is restored after */
+    void* previous = pthread_getspecific(combining_key);
+    pthread_setspecific(combining_key, queue);
+    for(int pass = 0; pass < COMBINING_PASSES; pass++){
+        bool found = false;
+        for(int i = 0; i < COMBINING_SLOTS; i++){
+            PendingCall* call = __atomic_load_n(&combiner->slots[i].call, __ATOMIC_ACQUIRE);
+            if(call == NULL){
+                continue;
+            }
+            executeCall(call);
+            /* the slot is freed before the call is marked done: once done, the caller may reuse it */
+            __atomic_store_n(&combiner->slots[i].call, NULL, __ATOMIC_RELEASE);
+            __atomic_store_n(&call->done, 1, __ATOMIC_RELEASE);
+            found = true;
+        }
+        if(!found){
+            break;
+        }
+    }
+    pthread_setspecific(combining_key, previous);
+}
 
-static Node nodeCopy (Node node, CopyPQElement copy_element, CopyPQElementPriority copy_priority,
-                            FreePQElement free_element, FreePQElementPriority free_priority){
-    assert(node);
-    PQElement element = copy_element(node->element);
-    if(!element){
+/* publishes call in a free slot, starting from one picked by the call's address so threads
+   tend to use different slots. returns false if every slot is taken */
+static bool publishCall(Combiner combiner, PendingCall* call){
+    int first = (int)(((uintptr_t)call / CACHE_LINE_SIZE) % COMBINING_SLOTS);
+    for(int i = 0; i < COMBINING_SLOTS; i++){
+        PendingCall* expected = NULL;
+        CombiningSlot* slot = &combiner->slots[(first + i) % COMBINING_SLOTS];
+        if(__atomic_compare_exchange_n(&slot->call, &expected, call, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+            return true;
+        }
+    }
+    return false;
+}
+
+/* runs call on queue through the combiner and returns when it is done */
+static void combine(PriorityQueue queue, PendingCall* call){
+    Combiner combiner = queue->combiner;
+    call->queue = queue;
+    call->done = 0;
+    if(!publishCall(combiner, call)){
+        pthread_mutex_lock(&combiner->lock);
+        void* previous = pthread_getspecific(combining_key);
+        pthread_setspecific(combining_key, queue);
+        executeCall(call);
+        pthread_setspecific(combining_key, previous);
+        combinePendingCalls(queue);
+        pthread_mutex_unlock(&combiner->lock);
+        return;
+    }
+    while(!__atomic_load_n(&call->done, __ATOMIC_ACQUIRE)){
+        if(pthread_mutex_trylock(&combiner->lock) == 0){
+            combinePendingCalls(queue);
+            pthread_mutex_unlock(&combiner->lock);
+        }else{
+            sched_yield();
+        }
+    }
+}
+
+PriorityQueue pqCreateConcurrent(CopyPQElement copy_element,
+                                 FreePQElement free_element,
+                                 EqualPQElements equal_elements,
+                                 CopyPQElementPriority copy_priority,
+                                 FreePQElementPriority free_priority,
+                                 ComparePQElementPriorities compare_priorities){
+    pthread_once(&combining_key_once, createCombiningKey);
+    if(!combining_key_created){
         return NULL;
     }
-    PQElement priority = copy_priority(node->priority);
-    if(!priority){
-        free_element(element);
+    PriorityQueue queue = createQueue(copy_element, free_element, equal_elements, NULL,
+                                      copy_priority, free_priority, compare_priorities);
+    if(queue == NULL){
         return NULL;
     }
-    Node node_copy = nodeCreate(element, priority);
-    if (node_copy == NULL){
-        free_element(element);
-        free_priority(priority);
+    void* memory = NULL;
+    if(posix_memalign(&memory, CACHE_LINE_SIZE, sizeof(struct combiner)) != 0){
+        pqDestroy(queue);
         return NULL;
     }
-    return node_copy;
-}
-
-static Node copyLinkedList(Node first_node, CopyPQElement copy_element, CopyPQElementPriority copy_priority,
-                                FreePQElement free_element, FreePQElementPriority free_priority){
-    assert (first_node);
-    Node first_copy = nodeCopy(first_node, copy_element, copy_priority, free_element, free_priority);
-    if(!first_copy){
+    Combiner combiner = memory;
+    if(pthread_mutex_init(&combiner->lock, NULL) != 0){
+        free(combiner);
+        pqDestroy(queue);
         return NULL;
     }
-    Node current_copy = first_copy;
-    Node current_node = first_node;
-    while(current_node->next_node){
+    for(int i = 0; i < COMBINING_SLOTS; i++){
+        combiner->slots[i].call = NULL;
+    }
+    queue->combiner = combiner;
+    return queue;
+}
 
-        current_copy->next_node = nodeCopy(current_node->next_node, copy_element, copy_priority,
-                                                    free_element, free_priority);
-        if(!current_copy->next_node){
-            destroyLinkedList(first_copy, free_element, free_priority);
-            return NULL;
-        }
-        current_copy = current_copy->next_node;
-        current_node = current_node->next_node;
+/* every change of the heap invalidates both the iterator and the cached iteration order */
+static void invalidateIteration(PriorityQueue queue){
+    queue->iterator = NO_ITERATOR;
+    queue->order_valid = false;
+}
+
+/*=========================================================================*/
+/* statistics: every user callback goes through these helpers so it can be counted */
+
+static unsigned long long statsClock(PriorityQueue queue){
+    if(queue->stats == NULL){
+        return 0;
     }
-    return first_copy;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * NANOSECONDS_IN_SECOND + (unsigned long long)now.tv_nsec;
 }
 
+/* adds the time passed since start to the histogram of operation. bucket b counts calls that
+   took between 2^b and 2^(b+1) nanoseconds */
+static void statsRecordLatency(PriorityQueue queue, PQOperation operation, unsigned long long start){
+    if(queue->stats == NULL){
+        return;
+    }
+    unsigned long long elapsed = statsClock(queue) - start;
+    int bucket = 0;
+    while(elapsed > 1 && bucket < PQ_STATS_HISTOGRAM_BUCKETS - 1){
+        elapsed >>= 1;
+        bucket++;
+    }
+    queue->stats->latency[operation][bucket]++;
+}
 
-PriorityQueue pqCopy(PriorityQueue queue){
-    if(queue == NULL){
-        return NULL;
+static void statsAddSteps(PriorityQueue queue, unsigned long long steps){
+    if(queue->stats != NULL){
+        queue->stats->steps += steps;
     }
-    queue->iterator = NULL;
-    PriorityQueue queue_copy =
-        pqCreate(queue->CopyPQElement, queue->FreePQElement, queue->EqualPQElements,
-            queue->CopyPQElementPriority, queue->FreePQElementPriority, queue->ComparePQElementPriorities);
+}
 
-    if (queue_copy == NULL){
-        return NULL;
+static int comparePriorities(PriorityQueue queue, PQElementPriority first, PQElementPriority second){
+    if(queue->stats != NULL){
+        queue->stats->comparisons++;
     }
-    if(queue->first_node == NULL){
-        return queue_copy;
-    }    
-    queue_copy->first_node = copyLinkedList(queue->first_node, queue->CopyPQElement, queue->CopyPQElementPriority,
-                                queue->FreePQElement, queue->FreePQElementPriority);
-    
-    if (queue_copy->first_node == NULL){
-        pqDestroy(queue_copy);
-        return NULL;
+    return queue->ComparePQElementPriorities(first, second);
+}
+
+static bool equalElements(PriorityQueue queue, PQElement first, PQElement second){
+    if(queue->stats != NULL){
+        queue->stats->equality_checks++;
     }
-    return queue_copy;
+    return queue->EqualPQElements(first, second);
 }
 
-int pqGetSize(PriorityQueue queue){
-    int counter = 0;
-    if(queue == NULL){
-        return -1;
+static PQElement copyElement(PriorityQueue queue, PQElement element){
+    if(queue->stats != NULL){
+        queue->stats->element_copies++;
     }
-    Node current = queue->first_node;
-    while (current != NULL){
-        counter++;
-        current = current->next_node;
+    return queue->CopyPQElement(element);
+}
+
+static PQElementPriority copyPriority(PriorityQueue queue, PQElementPriority priority){
+    if(queue->stats != NULL){
+        queue->stats->priority_copies++;
     }
-    return counter;
+    return queue->CopyPQElementPriority(priority);
 }
-bool pqContains(PriorityQueue queue, PQElement element){
-    if(queue == NULL || element == NULL){
-        return false;
+
+static void freeElement(PriorityQueue queue, PQElement element){
+    if(queue->stats != NULL){
+        queue->stats->element_frees++;
     }
-    Node current = queue->first_node;
-    while (current){
-        if(queue->EqualPQElements(current->element, element)){
-            return true;
-        }
-        current = current->next_node;
+    queue->FreePQElement(element);
+}
+
+static void freePriority(PriorityQueue queue, PQElementPriority priority){
+    if(queue->stats != NULL){
+        queue->stats->priority_frees++;
     }
-    return false;
+    queue->FreePQElementPriority(priority);
 }
 
+/*=========================================================================*/
+/* element index of queues created with pqCreateIndexed */
 
-/* this function deletes a node from the pq but not from the memory
-    this function returns the node that has been deleted from the pq list*/
-static Node RemoveAndConnect (Node parent){
-    assert(parent);
-    Node r_value = parent->next_node;
-    parent->next_node = r_value->next_node;
-    return r_value;    
+static bool isIndexed(PriorityQueue queue){
+    return queue->index_buckets != NULL;
 }
 
+static Node* indexBucketOf(PriorityQueue queue, unsigned int hash){
+    return &queue->index_buckets[hash & (unsigned int)(queue->index_bucket_count - 1)];
+}
 
-PriorityQueueResult pqInsert(PriorityQueue queue, PQElement element, PQElementPriority priority){
-     if(queue == NULL){
-        return PQ_NULL_ARGUMENT;
+/* moves every indexed node into a new array of new_count buckets. a failed allocation only leaves
+   the buckets longer or emptier than they should be, so it is not reported */
+static void indexRehash(PriorityQueue queue, int new_count){
+    Node* new_buckets = calloc(new_count, sizeof(*new_buckets));
+    if(new_buckets == NULL){
+        return;
     }
-    queue->iterator = NULL;
-    if(element == NULL || priority == NULL){
-        return PQ_NULL_ARGUMENT;
+    Node* old_buckets = queue->index_buckets;
+    int old_count = queue->index_bucket_count;
+    queue->index_buckets = new_buckets;
+    queue->index_bucket_count = new_count;
+    for(int i = 0; i < old_count; i++){
+        Node current = old_buckets[i];
+        while(current != NULL){
+            Node next = current->next_in_bucket;
+            Node* bucket = indexBucketOf(queue, current->hash);
+            current->next_in_bucket = *bucket;
+            *bucket = current;
+            current = next;
+        }
     }
-    PQElementPriority priority_copy = queue->CopyPQElementPriority(priority);
-    if(priority_copy == NULL){
-        return PQ_OUT_OF_MEMORY;
+    free(old_buckets);
+}
+
+/* doubles the bucket count once the load factor passes 1 */
+static void indexGrowIfNeeded(PriorityQueue queue){
+    if(queue->size > queue->index_bucket_count){
+        indexRehash(queue, queue->index_bucket_count * EXPAND_FACTOR);
     }
-    PQElement element_copy = queue->CopyPQElement(element);
-    if(element_copy == NULL){
-        queue->FreePQElementPriority(priority_copy);
-        return PQ_OUT_OF_MEMORY;
-    }    
-    Node new_node = nodeCreate(element_copy, priority_copy);
-    if(new_node == NULL){
-        queue->FreePQElementPriority(priority_copy);
-        queue->FreePQElement(element_copy);
-        return PQ_OUT_OF_MEMORY;
-    }  
+}
 
-    if (queue->first_node == NULL){
-        queue->first_node = new_node;
-        return PQ_SUCCESS;
+static void indexAdd(PriorityQueue queue, Node node){
+    if(!isIndexed(queue)){
+        return;
     }
+    Node* bucket = indexBucketOf(queue, node->hash);
+    node->next_in_bucket = *bucket;
+    *bucket = node;
+    indexGrowIfNeeded(queue);
+}
 
-    if(queue->ComparePQElementPriorities(priority_copy, queue->first_node->priority) > 0){
-        new_node->next_node = queue->first_node;
-        queue->first_node = new_node;
-        return PQ_SUCCESS;
+static void indexRemove(PriorityQueue queue, Node node){
+    if(!isIndexed(queue)){
+        return;
+    }
+    Node* link = indexBucketOf(queue, node->hash);
+    while(*link != node){
+        assert(*link != NULL);
+        link = &(*link)->next_in_bucket;
     }
+    *link = node->next_in_bucket;
+    node->next_in_bucket = NULL;
+}
 
-    Node parent = queue->first_node;
-   
-    while (parent->next_node && 
-           queue->ComparePQElementPriorities(priority_copy, parent->next_node->priority) <= 0){
-        parent = parent->next_node;
+static void indexClear(PriorityQueue queue){
+    if(!isIndexed(queue)){
+        return;
     }
-    new_node->next_node = parent->next_node;
-    parent->next_node = new_node;
-    return PQ_SUCCESS;
+    memset(queue->index_buckets, 0, sizeof(*queue->index_buckets) * queue->index_bucket_count);
 }
 
+/*=========================================================================*/
+/* node pool */
 
-PriorityQueueResult pqRemove(PriorityQueue queue){
-    if (!queue){
-        return PQ_NULL_ARGUMENT;
-    }
-    queue->iterator = NULL;
-    if (!queue->first_node){
-        return PQ_SUCCESS;
+static Node poolNodeAt(PriorityQueue queue, int id){
+    int slab = id / NODES_PER_SLAB;
+    if(id < 0 || slab >= queue->slab_count || queue->slabs[slab] == NULL){
+        return NULL;
     }
-    queue->first_node = deleteNode(queue->first_node, queue->FreePQElement, queue->FreePQElementPriority);
-    return PQ_SUCCESS;
+    return &queue->slabs[slab][id % NODES_PER_SLAB];
 }
 
+static void poolPushFree(PriorityQueue queue, Node node){
+    node->next_in_bucket = queue->first_free_node;
+    queue->first_free_node = node;
+    queue->free_node_count++;
+}
 
+/* relinks every node that is not queued, lowest id first */
+static void poolRebuildFreeList(PriorityQueue queue){
+    queue->first_free_node = NULL;
+    queue->free_node_count = 0;
+    for(int slab = queue->slab_count - 1; slab >= 0; slab--){
+        if(queue->slabs[slab] == NULL){
+            continue;
+        }
+        for(int i = NODES_PER_SLAB - 1; i >= 0; i--){
+            if(queue->slabs[slab][i].heap_index == NOT_FOUND){
+                poolPushFree(queue, &queue->slabs[slab][i]);
+            }
+        }
+    }
+}
 
-PriorityQueueResult pqRemoveElement(PriorityQueue queue, PQElement element){
-    if(queue == NULL){
-        return PQ_NULL_ARGUMENT;
-    }    
-    queue->iterator = NULL;
-    if(element == NULL){
-        return PQ_NULL_ARGUMENT;
+/* allocates a slab into the first hole of the slab array, or at its end. nodes of a new slab start
+   above every generation a released slab reached, so old handles into that slab stay stale */
+static PriorityQueueResult poolAllocateSlab(PriorityQueue queue, int slab){
+    void* memory = NULL;
+    if(posix_memalign(&memory, CACHE_LINE_SIZE, sizeof(struct node) * NODES_PER_SLAB) != 0){
+        return PQ_OUT_OF_MEMORY;
     }
-    if(!pqContains(queue, element)){
-        return PQ_ELEMENT_DOES_NOT_EXISTS;
-    }    
-    
-    if(queue->EqualPQElements(queue->first_node->element,element)){
-        queue->first_node = deleteNode(queue->first_node, queue->FreePQElement, queue->FreePQElementPriority);
+    queue->slabs[slab] = memory;
+    for(int i = 0; i < NODES_PER_SLAB; i++){
+        Node node = &queue->slabs[slab][i];
+        node->id = slab * NODES_PER_SLAB + i;
+        node->generation = queue->retired_generation + FIRST_GENERATION;
+        node->heap_index = NOT_FOUND;
+        node->element = NULL;
+        node->priority = NULL;
+        node->next_in_bucket = NULL;
+    }
+    return PQ_SUCCESS;
+}
+
+static PriorityQueueResult poolGrowSlabArray(PriorityQueue queue, int slab_count){
+    if(slab_count <= queue->slabs_capacity){
         return PQ_SUCCESS;
     }
-    
-    Node parent = queue->first_node;
-    assert(parent);
-    while ((parent->next_node != NULL) && (!queue->EqualPQElements(parent->next_node->element, element))){
-        parent = parent->next_node;
+    int new_capacity = queue->slabs_capacity == 0 ? 1 : queue->slabs_capacity;
+    while(new_capacity < slab_count){
+        new_capacity *= EXPAND_FACTOR;
     }
-    parent->next_node = deleteNode(parent->next_node, queue->FreePQElement, queue->FreePQElementPriority);
-    return PQ_SUCCESS;   
+    Node* new_slabs = realloc(queue->slabs, sizeof(*new_slabs) * new_capacity);
+    if(new_slabs == NULL){
+        return PQ_OUT_OF_MEMORY;
+    }
+    queue->slabs = new_slabs;
+    queue->slabs_capacity = new_capacity;
+    return PQ_SUCCESS;
 }
 
-
-
-// redo!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-PriorityQueueResult pqChangePriority(PriorityQueue queue, PQElement element,
-                                     PQElementPriority old_priority, PQElementPriority new_priority){
-    if (!queue){
-        return PQ_NULL_ARGUMENT;
+/* allocates a slab into the first hole of the slab array, or at its end, and frees all its nodes */
+static PriorityQueueResult poolAddSlab(PriorityQueue queue){
+    int slab = 0;
+    while(slab < queue->slab_count && queue->slabs[slab] != NULL){
+        slab++;
     }
-    queue->iterator = NULL;
-    if (!element || !old_priority || !new_priority){
-        return PQ_NULL_ARGUMENT;
+    if(slab == queue->slab_count){
+        if(poolGrowSlabArray(queue, slab + 1) != PQ_SUCCESS){
+            return PQ_OUT_OF_MEMORY;
+        }
+        queue->slabs[slab] = NULL;
+        queue->slab_count++;
     }
-    if (queue->first_node==NULL){
-        return PQ_ELEMENT_DOES_NOT_EXISTS;
+    if(poolAllocateSlab(queue, slab) != PQ_SUCCESS){
+        return PQ_OUT_OF_MEMORY;
     }
-    if(pqGetSize(queue)==1){
-        //malloc
-        //matybe save old priority
-        queue->FreePQElementPriority(queue->first_node->priority);
-        queue->first_node->priority = queue->CopyPQElementPriority(new_priority);
-        if(queue->first_node->priority == NULL){
-            
+    for(int i = NODES_PER_SLAB - 1; i >= 0; i--){
+        poolPushFree(queue, &queue->slabs[slab][i]);
+    }
+    return PQ_SUCCESS;
+}
+
+/* makes sure the free list holds at least count nodes */
+static PriorityQueueResult ensureNodesAvailable(PriorityQueue queue, int count){
+    while(queue->free_node_count < count){
+        if(poolAddSlab(queue) != PQ_SUCCESS){
             return PQ_OUT_OF_MEMORY;
         }
-        
-        return PQ_SUCCESS;
     }
-    PriorityQueueResult result;
-    if (queue->EqualPQElements(queue->first_node->element, element) &&
-        queue->ComparePQElementPriorities(queue->first_node->priority, old_priority) == 0){
-            Node tmp = queue->first_node;
-            queue->first_node = queue->first_node->next_node;
-            result = pqInsert(queue, tmp->element, new_priority);
-            if(result != PQ_SUCCESS){
-                queue->first_node = tmp;
-                return result;
-            }
-            deleteNode(tmp, queue->FreePQElement, queue->FreePQElementPriority);
-            return PQ_SUCCESS;
+    return PQ_SUCCESS;
+}
+
+static PriorityQueueResult ensureNodeAvailable(PriorityQueue queue){
+    return ensureNodesAvailable(queue, 1);
+}
+
+/* gives a slab layout identical to source's, with every node free and keeping its generation */
+static PriorityQueueResult poolCopyLayout(PriorityQueue queue, PriorityQueue source){
+    if(poolGrowSlabArray(queue, source->slab_count) != PQ_SUCCESS){
+        return PQ_OUT_OF_MEMORY;
+    }
+    for(int slab = 0; slab < source->slab_count; slab++){
+        queue->slabs[slab] = NULL;
     }
-    
-    Node parent = queue->first_node;
-    Node to_change;
-    while(parent->next_node) {
-        if (queue->EqualPQElements(parent->next_node->element, element) &&
-            queue->ComparePQElementPriorities(parent->next_node->priority, old_priority) == 0){
-                    to_change = RemoveAndConnect(parent);
-                    result = pqInsert(queue, to_change->element, new_priority);
-                    if(result != PQ_SUCCESS){
-                        parent->next_node = to_change;
-                        return result;
-                    }
-                    deleteNode(to_change, queue->FreePQElement, queue->FreePQElementPriority);
-                    return PQ_SUCCESS;
+    queue->slab_count = source->slab_count;
+    queue->retired_generation = source->retired_generation;
+    for(int slab = 0; slab < source->slab_count; slab++){
+        if(source->slabs[slab] == NULL){
+            continue;
+        }
+        if(poolAllocateSlab(queue, slab) != PQ_SUCCESS){
+            return PQ_OUT_OF_MEMORY;
+        }
+        for(int i = 0; i < NODES_PER_SLAB; i++){
+            queue->slabs[slab][i].generation = source->slabs[slab][i].generation;
         }
-        parent = parent->next_node;
     }
-    return PQ_ELEMENT_DOES_NOT_EXISTS;
+    return PQ_SUCCESS;
 }
 
+/* frees every slab without queued nodes, and returns the number of slabs freed */
+static int poolReleaseEmptySlabs(PriorityQueue queue){
+    int released = 0;
+    for(int slab = 0; slab < queue->slab_count; slab++){
+        if(queue->slabs[slab] == NULL){
+            continue;
+        }
+        unsigned int max_generation = 0;
+        bool empty = true;
+        for(int i = 0; i < NODES_PER_SLAB && empty; i++){
+            Node node = &queue->slabs[slab][i];
+            empty = node->heap_index == NOT_FOUND;
+            max_generation = node->generation > max_generation ? node->generation : max_generation;
+        }
+        if(!empty){
+            continue;
+        }
+        if(max_generation > queue->retired_generation){
+            queue->retired_generation = max_generation;
+        }
+        free(queue->slabs[slab]);
+        queue->slabs[slab] = NULL;
+        released++;
+    }
+    while(queue->slab_count > 0 && queue->slabs[queue->slab_count - 1] == NULL){
+        queue->slab_count--;
+    }
+    poolRebuildFreeList(queue);
+    return released;
+}
 
-PQElement pqGetFirst(PriorityQueue queue){
-    if(queue == NULL){
-        return NULL;
+static void poolDestroy(PriorityQueue queue){
+    for(int slab = 0; slab < queue->slab_count; slab++){
+        free(queue->slabs[slab]);
     }
-    if(queue->first_node == NULL){
-        return NULL;
+    free(queue->slabs);
+}
+
+/* must be preceded by a successful ensureNodeAvailable */
+static Node nodeCreate(PriorityQueue queue, PQElement element, PQElementPriority priority,
+                       unsigned long long insertion_order){
+    Node node = queue->first_free_node;
+    assert(node != NULL);
+    queue->first_free_node = node->next_in_bucket;
+    queue->free_node_count--;
+    node->element = element;
+    node->priority = priority;
+    node->insertion_order = insertion_order;
+    node->heap_index = NOT_FOUND;
+    node->hash = 0;
+    node->next_in_bucket = NULL;
+    return node;
+}
+
+static void releaseNode(PriorityQueue queue, Node node){
+    node->heap_index = NOT_FOUND;
+    node->element = NULL;
+    node->priority = NULL;
+    node->generation++;
+    if(node->generation == 0){
+        node->generation = FIRST_GENERATION;
     }
-    queue->iterator = queue->first_node;    
-    return queue->iterator->element;
+    poolPushFree(queue, node);
 }
 
+static PQHandle handleOf(Node node){
+    return ((PQHandle)node->generation << HANDLE_ID_BITS) | (PQHandle)node->id;
+}
 
-PQElement pqGetNext(PriorityQueue queue){
-    if(queue == NULL){
+/* returns the queued node the handle refers to, or NULL if the handle is invalid or stale */
+static Node nodeOfHandle(PriorityQueue queue, PQHandle handle){
+    PQHandle id = handle & HANDLE_ID_MASK;
+    if(id >= (PQHandle)queue->slab_count * NODES_PER_SLAB){
         return NULL;
     }
-    if(queue->first_node == NULL){
+    Node node = poolNodeAt(queue, (int)id);
+    if(node == NULL || node->heap_index == NOT_FOUND ||
+            node->generation != (unsigned int)(handle >> HANDLE_ID_BITS)){
         return NULL;
     }
-    if(queue->iterator == NULL){
-        return NULL;
+    return node;
+}
+
+/*=========================================================================*/
+
+static void deleteNode(PriorityQueue queue, Node to_delete){
+    if(to_delete == NULL){
+        return;
     }
-    queue->iterator = queue->iterator->next_node;
-    if(queue->iterator == NULL){
-        return NULL;
+    freeElement(queue, to_delete->element);
+    freePriority(queue, to_delete->priority);
+    releaseNode(queue, to_delete);
+}
+
+static void destroyHeapNodes(PriorityQueue queue){
+    for(int i = 0; i < queue->size; i++){
+        deleteNode(queue, queue->heap[i]);
     }
-    return queue->iterator->element;
+    queue->size = 0;
+    queue->worst_size = 0;
 }
 
-PriorityQueueResult pqClear(PriorityQueue queue){
+/* stops sharing a frozen content, and destroys it if no other queue shares it */
+static void dropShare(PriorityQueue queue){
+    PriorityQueue shared = queue->shared;
+    queue->shared = NULL;
+    shared->share_count--;
+    if(shared->share_count == 0){
+        pqDestroy(shared);
+    }
+}
+
+void pqDestroy(PriorityQueue queue){
     if(queue == NULL){
-        return PQ_NULL_ARGUMENT;
+        return;
     }
-    queue->iterator = NULL;
-    destroyLinkedList(queue->first_node, queue->FreePQElement, queue->FreePQElementPriority);
-    queue->first_node = NULL;
-    return PQ_SUCCESS;
-}
\ No newline at end of file
+    if(queue->combiner != NULL){
+        pthread_mutex_destroy(&queue->combiner->lock);
+        free(queue->combiner);
+        queue->combiner = NULL;
+    }
+    if(queue->shared != NULL){
+        dropShare(queue);
+        free(queue->order);
+        free(queue->stats);
+        free(queue);
+        return;
+    }
+    destroyHeapNodes(queue);
+    free(queue->heap);
+    free(queue->worst_heap);
+    free(queue->order);
+    free(queue->stats);
+    free(queue->index_buckets);
+    poolDestroy(queue);
+    free(queue);
+    return;
+}
+
+/* copies the element and priority of source into the free node target, which keeps its own id */
+static bool nodeCopyInto(PriorityQueue queue, Node source, Node target){
+    assert(source && target);
+    PQElement element = copyElement(queue, source->element);
+    if(!element){
+        return false;
+    }
+    PQElement priority = copyPriority(queue, source->priority);
+    if(!priority){
+        freeElement(queue, element);
+        return false;
+    }
+    target->element = element;
+    target->priority = priority;
+    target->insertion_order = source->insertion_order;
+    target->hash = source->hash;
+    target->next_in_bucket = NULL;
+    return true;
+}
+
+/* returns true if first should be closer to the top of the queue than second */
+static bool nodeComesBefore(PriorityQueue queue, Node first, Node second){
+    int compare = comparePriorities(queue, first->priority, second->priority);
+    if(compare != 0){
+        return compare > 0;
+    }
+    return first->insertion_order < second->insertion_order;
+}
+
+/* swaps two nodes of array. nodes only track their position when array is the queue's heap,
+   the iteration order is sorted with the same helpers and must leave positions alone */
+static void swapNodes(PriorityQueue queue, Node* array, int first, int second){
+    Node tmp = array[first];
+    array[first] = array[second];
+    array[second] = tmp;
+    if(array == queue->heap){
+        array[first]->heap_index = first;
+        array[second]->heap_index = second;
+    }
+}
+
+static void placeNode(PriorityQueue queue, int index, Node node){
+    queue->heap[index] = node;
+    node->heap_index = index;
+}
+
+static void siftUp(PriorityQueue queue, int index){
+    while(index > 0){
+        int parent = (index - 1) / 2;
+        if(!nodeComesBefore(queue, queue->heap[index], queue->heap[parent])){
+            return;
+        }
+        swapNodes(queue, queue->heap, index, parent);
+        statsAddSteps(queue, 1);
+        index = parent;
+    }
+}
+
+/* sifts down inside any heap-ordered array, so it serves both the queue and the iteration order */
+static void siftDown(PriorityQueue queue, Node* array, int size, int index){
+    while(true){
+        int first_child = 2 * index + 1;
+        if(first_child >= size){
+            return;
+        }
+        int best = first_child;
+        if(first_child + 1 < size && nodeComesBefore(queue, array[first_child + 1], array[first_child])){
+            best = first_child + 1;
+        }
+        if(!nodeComesBefore(queue, array[best], array[index])){
+            return;
+        }
+        swapNodes(queue, array, index, best);
+        statsAddSteps(queue, 1);
+        index = best;
+    }
+}
+
+/* restores the heap order after the node at index has changed or was replaced */
+static void fixHeapPosition(PriorityQueue queue, int index){
+    siftUp(queue, index);
+    siftDown(queue, queue->heap, queue->size, index);
+}
+
+/*=========================================================================*/
+/* the worst heap of bounded queues. all of these do nothing for other queues */
+
+static bool isBounded(PriorityQueue queue){
+    return queue->bound > 0;
+}
+
+static void worstPlace(PriorityQueue queue, int index, Node node){
+    queue->worst_heap[index] = node;
+    node->worst_index = index;
+}
+
+static void worstSiftUp(PriorityQueue queue, int index){
+    Node node = queue->worst_heap[index];
+    while(index > 0){
+        int parent = (index - 1) / 2;
+        if(!nodeComesBefore(queue, queue->worst_heap[parent], node)){
+            break;
+        }
+        worstPlace(queue, index, queue->worst_heap[parent]);
+        index = parent;
+    }
+    worstPlace(queue, index, node);
+}
+
+static void worstSiftDown(PriorityQueue queue, int index){
+    Node node = queue->worst_heap[index];
+    while(true){
+        int worst = 2 * index + 1;
+        if(worst >= queue->worst_size){
+            break;
+        }
+        if(worst + 1 < queue->worst_size &&
+           nodeComesBefore(queue, queue->worst_heap[worst], queue->worst_heap[worst + 1])){
+            worst++;
+        }
+        if(!nodeComesBefore(queue, node, queue->worst_heap[worst])){
+            break;
+        }
+        worstPlace(queue, index, queue->worst_heap[worst]);
+        index = worst;
+    }
+    worstPlace(queue, index, node);
+}
+
+static void worstAdd(PriorityQueue queue, Node node){
+    if(!isBounded(queue)){
+        return;
+    }
+    worstPlace(queue, queue->worst_size, node);
+    queue->worst_size++;
+    worstSiftUp(queue, node->worst_index);
+}
+
+static void worstFix(PriorityQueue queue, Node node){
+    if(!isBounded(queue)){
+        return;
+    }
+    worstSiftUp(queue, node->worst_index);
+    worstSiftDown(queue, node->worst_index);
+}
+
+static void worstRemove(PriorityQueue queue, Node node){
+    if(!isBounded(queue)){
+        return;
+    }
+    int index = node->worst_index;
+    queue->worst_size--;
+    if(index != queue->worst_size){
+        worstPlace(queue, index, queue->worst_heap[queue->worst_size]);
+        worstFix(queue, queue->worst_heap[index]);
+    }
+}
+
+static bool isFull(PriorityQueue queue){
+    return isBounded(queue) && queue->size == queue->bound;
+}
+
+/* makes sure the heap array can hold at least needed nodes. a bounded queue never needs more than bound.
+   the iteration order grows first, so it has room for the heap even if growing the heap then fails */
+static PriorityQueueResult ensureCapacity(PriorityQueue queue, int needed){
+    if(needed <= queue->capacity){
+        return PQ_SUCCESS;
+    }
+    int new_capacity = queue->capacity;
+    while(new_capacity < needed){
+        new_capacity *= EXPAND_FACTOR;
+    }
+    if(isBounded(queue) && new_capacity > queue->bound){
+        new_capacity = queue->bound > needed ? queue->bound : needed;
+    }
+    if(!reserveOrder(queue, new_capacity)){
+        return PQ_OUT_OF_MEMORY;
+    }
+    Node* new_heap = realloc(queue->heap, sizeof(*new_heap) * new_capacity);
+    if(new_heap == NULL){
+        return PQ_OUT_OF_MEMORY;
+    }
+    queue->heap = new_heap;
+    queue->capacity = new_capacity;
+    return PQ_SUCCESS;
+}
+
+/* removes the node at index from the heap but not from the memory, and returns it */
+static Node detachNode(PriorityQueue queue, int index){
+    assert(index >= 0 && index < queue->size);
+    Node detached = queue->heap[index];
+    queue->size--;
+    if(index != queue->size){
+        placeNode(queue, index, queue->heap[queue->size]);
+        fixHeapPosition(queue, index);
+    }
+    indexRemove(queue, detached);
+    worstRemove(queue, detached);
+    detached->heap_index = NOT_FOUND;
+    return detached;
+}
+
+
+/* copies the content of queue, element by element, into a new queue with the same callbacks */
+static PriorityQueue copyQueue(PriorityQueue queue){
+    PriorityQueue queue_copy =
+        createQueue(queue->CopyPQElement, queue->FreePQElement, queue->EqualPQElements, queue->HashPQElement,
+            queue->CopyPQElementPriority, queue->FreePQElementPriority, queue->ComparePQElementPriorities);
+
+    if (queue_copy == NULL){
+        return NULL;
+    }
+    Node* heap_copy = reserveOrder(queue_copy, queue->capacity) ?
+        realloc(queue_copy->heap, sizeof(*heap_copy) * queue->capacity) : NULL;
+    if(heap_copy == NULL){
+        pqDestroy(queue_copy);
+        return NULL;
+    }
+    queue_copy->heap = heap_copy;
+    queue_copy->capacity = queue->capacity;
+    if(isBounded(queue) && !setBound(queue_copy, queue->bound)){
+        pqDestroy(queue_copy);
+        return NULL;
+    }
+    if(poolCopyLayout(queue_copy, queue) != PQ_SUCCESS){
+        pqDestroy(queue_copy);
+        return NULL;
+    }
+    /* copying the heap position by position and every node into the same pool id keeps the exact same
+       order, insertion order included, and lets handles of the queue refer to the same elements in the copy */
+    for(int i = 0; i < queue->size; i++){
+        Node node_copy = poolNodeAt(queue_copy, queue->heap[i]->id);
+        if(!nodeCopyInto(queue, queue->heap[i], node_copy)){
+            pqDestroy(queue_copy);
+            return NULL;
+        }
+        placeNode(queue_copy, i, node_copy);
+        queue_copy->size++;
+        indexAdd(queue_copy, node_copy);
+    }
+    for(int i = 0; i < queue->worst_size; i++){
+        worstPlace(queue_copy, i, poolNodeAt(queue_copy, queue->worst_heap[i]->id));
+    }
+    queue_copy->worst_size = queue->worst_size;
+    poolRebuildFreeList(queue_copy);
+    queue_copy->next_insertion_order = queue->next_insertion_order;
+    statsAddSteps(queue, queue->size);
+    return queue_copy;
+}
+
+/*=========================================================================*/
+/* copy-on-write */
+
+/* the queue that holds the content of queue: the frozen queue it shares, or itself */
+static PriorityQueue contentOf(PriorityQueue queue){
+    return queue->shared != NULL ? queue->shared : queue;
+}
+
+/* moves the content of source into target, overwriting target's content without freeing it */
+static void moveContent(PriorityQueue target, PriorityQueue source){
+    target->heap = source->heap;
+    target->size = source->size;
+    target->capacity = source->capacity;
+    target->next_insertion_order = source->next_insertion_order;
+    target->index_buckets = source->index_buckets;
+    target->index_bucket_count = source->index_bucket_count;
+    target->worst_heap = source->worst_heap;
+    target->worst_size = source->worst_size;
+    target->slabs = source->slabs;
+    target->slab_count = source->slab_count;
+    target->slabs_capacity = source->slabs_capacity;
+    target->first_free_node = source->first_free_node;
+    target->free_node_count = source->free_node_count;
+    target->retired_generation = source->retired_generation;
+}
+
+static void clearContent(PriorityQueue queue){
+    queue->heap = NULL;
+    queue->size = 0;
+    queue->capacity = 0;
+    queue->index_buckets = NULL;
+    queue->index_bucket_count = 0;
+    queue->worst_heap = NULL;
+    queue->worst_size = 0;
+    queue->slabs = NULL;
+    queue->slab_count = 0;
+    queue->slabs_capacity = 0;
+    queue->first_free_node = NULL;
+    queue->free_node_count = 0;
+}
+
+/* returns the frozen content queue shares, first moving its own content into one if needed.
+   the frozen queue keeps the callbacks, and has no statistics of its own */
+static PriorityQueue shareContent(PriorityQueue queue){
+    if(queue->shared != NULL){
+        return queue->shared;
+    }
+    PriorityQueue shared = malloc(sizeof(*shared));
+    if(shared == NULL){
+        return NULL;
+    }
+    *shared = *queue;
+    shared->order = NULL;
+    shared->order_capacity = 0;
+    shared->order_valid = false;
+    shared->stats = NULL;
+    shared->combiner = NULL;
+    shared->iterator = NO_ITERATOR;
+    shared->share_count = 1;
+    clearContent(queue);
+    queue->shared = shared;
+    return shared;
+}
+
+/* gives queue a private content it can change. the last queue sharing a frozen content takes it
+   over in O(1), any other copies it. returns false if an allocation failed */
+static bool unshareContent(PriorityQueue queue){
+    PriorityQueue shared = queue->shared;
+    if(shared == NULL){
+        return true;
+    }
+    if(shared->share_count == 1){
+        moveContent(queue, shared);
+        free(shared);
+    }else{
+        PriorityQueue private_copy = copyQueue(shared);
+        if(private_copy == NULL){
+            return false;
+        }
+        moveContent(queue, private_copy);
+        free(private_copy->order);
+        free(private_copy);
+        shared->share_count--;
+    }
+    queue->shared = NULL;
+    return true;
+}
+
+/* every change to a queue starts here: a queue sharing its content gets a private one, and the
+   iterator becomes undefined. returns false if the content could not be made private */
+static bool beginWrite(PriorityQueue queue){
+    if(!unshareContent(queue)){
+        return false;
+    }
+    invalidateIteration(queue);
+    queue->modification_count++;
+    return true;
+}
+
+PriorityQueue pqCopy(PriorityQueue queue){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_COPY};
+        combine(queue, &call);
+        return call.queue_result;
+    }
+    if(queue == NULL){
+        return NULL;
+    }
+    queue->iterator = NO_ITERATOR;
+    unsigned long long start = statsClock(queue);
+    PriorityQueue queue_copy = NULL;
+    if(queue->copy_on_write){
+        queue_copy = malloc(sizeof(*queue_copy));
+        PriorityQueue shared = queue_copy == NULL ? NULL : shareContent(queue);
+        if(shared == NULL){
+            free(queue_copy);
+            return NULL;
+        }
+        *queue_copy = *queue;
+        queue_copy->order = NULL;
+        queue_copy->order_capacity = 0;
+        queue_copy->order_valid = false;
+        queue_copy->stats = NULL;
+        queue_copy->combiner = NULL;
+        if(!reserveOrder(queue_copy, shared->capacity)){
+            free(queue_copy);
+            return NULL;
+        }
+        shared->share_count++;
+    }else{
+        queue_copy = copyQueue(contentOf(queue));
+        if(queue_copy == NULL){
+            return NULL;
+        }
+    }
+    queue_copy->batch_threads = queue->batch_threads;
+    queue_copy->copy_on_write = queue->copy_on_write;
+    statsRecordLatency(queue, PQ_OPERATION_COPY, start);
+    return queue_copy;
+}
+
+PriorityQueueResult pqSetCopyOnWrite(PriorityQueue queue, bool enable){
+    if(queue == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    queue->copy_on_write = enable;
+    return PQ_SUCCESS;
+}
+
+int pqGetSize(PriorityQueue queue){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_GET_SIZE};
+        combine(queue, &call);
+        return call.count_result;
+    }
+    if(queue == NULL){
+        return -1;
+    }
+    return contentOf(queue)->size;
+}
+
+bool pqContains(PriorityQueue queue, PQElement element){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_CONTAINS, .element = element};
+        combine(queue, &call);
+        return call.flag_result;
+    }
+    if(queue == NULL || element == NULL){
+        return false;
+    }
+    unsigned long long start = statsClock(queue);
+    PriorityQueue content = contentOf(queue);
+    bool found = false;
+    if(isIndexed(content)){
+        unsigned int hash = content->HashPQElement(element);
+        Node current = *indexBucketOf(content, hash);
+        while(current != NULL && !found){
+            found = current->hash == hash && equalElements(content, current->element, element);
+            current = current->next_in_bucket;
+            statsAddSteps(queue, 1);
+        }
+    }else{
+        int i = 0;
+        while(i < content->size && !found){
+            found = equalElements(content, content->heap[i]->element, element);
+            i++;
+        }
+        statsAddSteps(queue, i);
+    }
+    statsRecordLatency(queue, PQ_OPERATION_CONTAINS, start);
+    return found;
+}
+
+
+static PriorityQueueResult ensureRoomForNode(PriorityQueue queue){
+    if(ensureCapacity(queue, queue->size + 1) != PQ_SUCCESS || ensureNodeAvailable(queue) != PQ_SUCCESS){
+        return PQ_OUT_OF_MEMORY;
+    }
+    return PQ_SUCCESS;
+}
+
+/* adds a node holding element and priority, which the queue now owns.
+   must be preceded by a successful ensureRoomForNode */
+static void linkNewNode(PriorityQueue queue, PQElement element, PQElementPriority priority, PQHandle* handle){
+    Node new_node = nodeCreate(queue, element, priority, queue->next_insertion_order);
+    queue->next_insertion_order++;
+    if(isIndexed(queue)){
+        new_node->hash = queue->HashPQElement(new_node->element);
+    }
+    placeNode(queue, queue->size, new_node);
+    queue->size++;
+    indexAdd(queue, new_node);
+    worstAdd(queue, new_node);
+    siftUp(queue, queue->size - 1);
+    if(handle != NULL){
+        *handle = handleOf(new_node);
+    }
+}
+
+/* whether a full bounded queue keeps a node with priority and insertion order: it must come before the
+   current worst node. a new insert with an equal priority does not, since it comes later */
+static bool outranksWorst(PriorityQueue queue, PQElementPriority priority, unsigned long long insertion_order){
+    Node worst = contentOf(queue)->worst_heap[0];
+    int compared = comparePriorities(queue, priority, worst->priority);
+    return compared > 0 || (compared == 0 && insertion_order < worst->insertion_order);
+}
+
+/* whether a full bounded queue rejects a new insert with priority. it only reads the content, so a
+   rejected insert leaves a copy-on-write queue sharing it */
+static bool rejectsInsert(PriorityQueue queue, PQElementPriority priority){
+    return isFull(contentOf(queue)) && !outranksWorst(queue, priority, queue->next_insertion_order);
+}
+
+/* removes the node that comes last in a full bounded queue, making room for one more */
+static void evictWorst(PriorityQueue queue){
+    deleteNode(queue, detachNode(queue, queue->worst_heap[0]->heap_index));
+    if(queue->stats != NULL){
+        queue->stats->removes++;
+    }
+}
+
+/* a full bounded queue makes room by evicting, and rejects priorities that would not be kept */
+static PriorityQueueResult insertNode(PriorityQueue queue, PQElement element, PQElementPriority priority,
+                                      PQHandle* handle){
+    bool evict = isFull(queue);
+    if(evict && !outranksWorst(queue, priority, queue->next_insertion_order)){
+        if(handle != NULL){
+            *handle = PQ_INVALID_HANDLE;
+        }
+        return PQ_SUCCESS;
+    }
+    if(!evict && ensureRoomForNode(queue) != PQ_SUCCESS){
+        return PQ_OUT_OF_MEMORY;
+    }
+    PQElementPriority priority_copy = copyPriority(queue, priority);
+    if(priority_copy == NULL){
+        return PQ_OUT_OF_MEMORY;
+    }
+    PQElement element_copy = copyElement(queue, element);
+    if(element_copy == NULL){
+        freePriority(queue, priority_copy);
+        return PQ_OUT_OF_MEMORY;
+    }
+    if(evict){
+        evictWorst(queue);
+    }
+    linkNewNode(queue, element_copy, priority_copy, handle);
+    return PQ_SUCCESS;
+}
+
+PriorityQueueResult pqInsertWithHandle(PriorityQueue queue, PQElement element, PQElementPriority priority,
+                                       PQHandle* handle){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_INSERT, .element = element, .priority = priority,
+                            .handle_out = handle};
+        combine(queue, &call);
+        return call.result;
+    }
+    if(queue == NULL || element == NULL || priority == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    unsigned long long start = statsClock(queue);
+    PriorityQueueResult result = PQ_SUCCESS;
+    if(rejectsInsert(queue, priority)){
+        if(handle != NULL){
+            *handle = PQ_INVALID_HANDLE;
+        }
+    } else if(!beginWrite(queue)){
+        result = PQ_OUT_OF_MEMORY;
+    } else {
+        result = insertNode(queue, element, priority, handle);
+    }
+    if(result == PQ_SUCCESS && queue->stats != NULL){
+        queue->stats->inserts++;
+    }
+    statsRecordLatency(queue, PQ_OPERATION_INSERT, start);
+    return result;
+}
+
+PriorityQueueResult pqInsert(PriorityQueue queue, PQElement element, PQElementPriority priority){
+    return pqInsertWithHandle(queue, element, priority, NULL);
+}
+
+PriorityQueueResult pqInsertTake(PriorityQueue queue, PQElement element, PQElementPriority priority){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_INSERT_TAKE, .element = element, .priority = priority};
+        combine(queue, &call);
+        return call.result;
+    }
+    if(queue == NULL || element == NULL || priority == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    unsigned long long start = statsClock(queue);
+    PriorityQueueResult result = PQ_SUCCESS;
+    if(rejectsInsert(queue, priority)){
+        freeElement(queue, element);
+        freePriority(queue, priority);
+    } else if(!beginWrite(queue)){
+        result = PQ_OUT_OF_MEMORY;
+    } else {
+        if(isFull(queue)){
+            evictWorst(queue);
+        } else {
+            result = ensureRoomForNode(queue);
+        }
+        if(result == PQ_SUCCESS){
+            linkNewNode(queue, element, priority, NULL);
+            if(queue->stats != NULL){
+                queue->stats->inserts++;
+            }
+        }
+    }
+    statsRecordLatency(queue, PQ_OPERATION_INSERT, start);
+    return result;
+}
+
+
+/*=========================================================================*/
+/* batch insertion */
+
+/* one thread's share of a batch: copies of elements[begin, end) and priorities[begin, end) */
+typedef struct batch_copy {
+    PriorityQueue queue;
+    PQElement* elements;
+    PQElementPriority* priorities;
+    PQElement* element_copies;
+    PQElementPriority* priority_copies;
+    int begin;
+    int end;
+    bool failed;
+} BatchCopy;
+
+static void batchFreeCopies(PriorityQueue queue, PQElement* element_copies, PQElementPriority* priority_copies,
+                            int begin, int end){
+    for(int i = begin; i < end; i++){
+        queue->FreePQElement(element_copies[i]);
+        queue->FreePQElementPriority(priority_copies[i]);
+    }
+}
+
+/* runs on worker threads, so it calls the copy functions directly and leaves the statistics to
+   the caller. if a copy fails, the range's copies made so far are freed */
+static void* batchCopyRange(void* argument){
+    BatchCopy* batch = argument;
+    PriorityQueue queue = batch->queue;
+    batch->failed = false;
+    for(int i = batch->begin; i < batch->end; i++){
+        batch->priority_copies[i] = queue->CopyPQElementPriority(batch->priorities[i]);
+        if(batch->priority_copies[i] == NULL){
+            batchFreeCopies(queue, batch->element_copies, batch->priority_copies, batch->begin, i);
+            batch->failed = true;
+            return NULL;
+        }
+        batch->element_copies[i] = queue->CopyPQElement(batch->elements[i]);
+        if(batch->element_copies[i] == NULL){
+            queue->FreePQElementPriority(batch->priority_copies[i]);
+            batchFreeCopies(queue, batch->element_copies, batch->priority_copies, batch->begin, i);
+            batch->failed = true;
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+/* copies the whole batch, splitting it between up to batch_threads threads. a range whose thread
+   could not be started is copied by the calling thread. on failure nothing stays allocated */
+static bool batchCopyAll(PriorityQueue queue, PQElement* elements, PQElementPriority* priorities,
+                         PQElement* element_copies, PQElementPriority* priority_copies, int count){
+    int threads = count / MIN_BATCH_PER_THREAD;
+    threads = threads > queue->batch_threads ? queue->batch_threads : threads;
+    threads = threads < 1 ? 1 : threads;
+    BatchCopy* ranges = malloc(sizeof(*ranges) * threads);
+    pthread_t* workers = malloc(sizeof(*workers) * threads);
+    bool* started = malloc(sizeof(*started) * threads);
+    if(ranges == NULL || workers == NULL || started == NULL){
+        free(ranges);
+        free(workers);
+        free(started);
+        return false;
+    }
+    for(int t = 0; t < threads; t++){
+        ranges[t].queue = queue;
+        ranges[t].elements = elements;
+        ranges[t].priorities = priorities;
+        ranges[t].element_copies = element_copies;
+        ranges[t].priority_copies = priority_copies;
+        ranges[t].begin = (int)((long long)count * t / threads);
+        ranges[t].end = (int)((long long)count * (t + 1) / threads);
+        started[t] = t > 0 && pthread_create(&workers[t], NULL, batchCopyRange, &ranges[t]) == 0;
+    }
+    for(int t = 0; t < threads; t++){
+        if(!started[t]){
+            batchCopyRange(&ranges[t]);
+        }
+    }
+    bool failed = false;
+    for(int t = 0; t < threads; t++){
+        if(started[t]){
+            pthread_join(workers[t], NULL);
+        }
+        failed = failed || ranges[t].failed;
+    }
+    if(failed){
+        for(int t = 0; t < threads; t++){
+            if(!ranges[t].failed){
+                batchFreeCopies(queue, element_copies, priority_copies, ranges[t].begin, ranges[t].end);
+            }
+        }
+    }
+    free(ranges);
+    free(workers);
+    free(started);
+    return !failed;
+}
+
+/* restores the heap after nodes were placed past old_size. when they are at least as many as the nodes
+   before them, one bottom-up heapify in O(n) is cheaper than sifting each of them up */
+static void heapifyAppended(PriorityQueue queue, int old_size){
+    if(queue->size - old_size >= old_size){
+        for(int i = queue->size / 2 - 1; i >= 0; i--){
+            siftDown(queue, queue->heap, queue->size, i);
+        }
+    } else {
+        for(int i = old_size; i < queue->size; i++){
+            siftUp(queue, i);
+        }
+    }
+}
+
+/* links the copies as new nodes in array order, then restores the heap */
+static void batchLink(PriorityQueue queue, PQElement* element_copies, PQElementPriority* priority_copies,
+                      int count){
+    int old_size = queue->size;
+    for(int i = 0; i < count; i++){
+        Node new_node = nodeCreate(queue, element_copies[i], priority_copies[i], queue->next_insertion_order);
+        queue->next_insertion_order++;
+        if(isIndexed(queue)){
+            new_node->hash = queue->HashPQElement(new_node->element);
+        }
+        placeNode(queue, queue->size, new_node);
+        queue->size++;
+        indexAdd(queue, new_node);
+        worstAdd(queue, new_node);
+    }
+    heapifyAppended(queue, old_size);
+}
+
+/* a bounded queue takes the batch one element at a time, as each may evict an earlier one */
+static PriorityQueueResult insertBatchBounded(PriorityQueue queue, PQElement* elements,
+                                              PQElementPriority* priorities, int count){
+    unsigned long long start = statsClock(queue);
+    PriorityQueueResult result = PQ_SUCCESS;
+    for(int i = 0; i < count && result == PQ_SUCCESS; i++){
+        result = insertNode(queue, elements[i], priorities[i], NULL);
+        if(result == PQ_SUCCESS && queue->stats != NULL){
+            queue->stats->inserts++;
+        }
+    }
+    statsRecordLatency(queue, PQ_OPERATION_INSERT, start);
+    return result;
+}
+
+PriorityQueueResult pqInsertBatch(PriorityQueue queue, PQElement* elements, PQElementPriority* priorities,
+                                  int count){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_INSERT_BATCH, .elements = elements, .priorities = priorities,
+                            .count = count};
+        combine(queue, &call);
+        return call.result;
+    }
+    if(queue == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    if(count < 0 || (count > 0 && (elements == NULL || priorities == NULL))){
+        return count < 0 ? PQ_ERROR : PQ_NULL_ARGUMENT;
+    }
+    for(int i = 0; i < count; i++){
+        if(elements[i] == NULL || priorities[i] == NULL){
+            return PQ_NULL_ARGUMENT;
+        }
+    }
+    if(count == 0){
+        return PQ_SUCCESS;
+    }
+    if(!beginWrite(queue)){
+        return PQ_OUT_OF_MEMORY;
+    }
+    if(isBounded(queue)){
+        return insertBatchBounded(queue, elements, priorities, count);
+    }
+    if(count > INT_MAX / EXPAND_FACTOR - queue->size){
+        return PQ_OUT_OF_MEMORY;
+    }
+    unsigned long long start = statsClock(queue);
+    if(ensureCapacity(queue, queue->size + count) != PQ_SUCCESS ||
+       ensureNodesAvailable(queue, count) != PQ_SUCCESS){
+        statsRecordLatency(queue, PQ_OPERATION_INSERT, start);
+        return PQ_OUT_OF_MEMORY;
+    }
+    PQElement* element_copies = malloc(sizeof(*element_copies) * count);
+    PQElementPriority* priority_copies = malloc(sizeof(*priority_copies) * count);
+    bool copied = element_copies != NULL && priority_copies != NULL &&
+                  batchCopyAll(queue, elements, priorities, element_copies, priority_copies, count);
+    if(copied){
+        batchLink(queue, element_copies, priority_copies, count);
+        if(queue->stats != NULL){
+            queue->stats->inserts += count;
+            queue->stats->element_copies += count;
+            queue->stats->priority_copies += count;
+        }
+    }
+    free(element_copies);
+    free(priority_copies);
+    statsRecordLatency(queue, PQ_OPERATION_INSERT, start);
+    return copied ? PQ_SUCCESS : PQ_OUT_OF_MEMORY;
+}
+
+PriorityQueue pqCreateFromArray(CopyPQElement copy_element,
+                                FreePQElement free_element,
+                                EqualPQElements equal_elements,
+                                CopyPQElementPriority copy_priority,
+                                FreePQElementPriority free_priority,
+                                ComparePQElementPriorities compare_priorities,
+                                PQElement* elements,
+                                PQElementPriority* priorities,
+                                int count){
+    PriorityQueue queue = pqCreate(copy_element, free_element, equal_elements,
+                                   copy_priority, free_priority, compare_priorities);
+    if(queue == NULL){
+        return NULL;
+    }
+    if(pqInsertBatch(queue, elements, priorities, count) != PQ_SUCCESS){
+        pqDestroy(queue);
+        return NULL;
+    }
+    return queue;
+}
+
+PriorityQueueResult pqSetBatchThreads(PriorityQueue queue, int threads){
+    if(queue == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    if(threads < 1){
+        return PQ_ERROR;
+    }
+    queue->batch_threads = threads;
+    return PQ_SUCCESS;
+}
+
+
+static bool sameCallbacks(PriorityQueue first, PriorityQueue second){
+    return first->CopyPQElement == second->CopyPQElement &&
+           first->CopyPQElementPriority == second->CopyPQElementPriority &&
+           first->FreePQElement == second->FreePQElement &&
+           first->FreePQElementPriority == second->FreePQElementPriority &&
+           first->EqualPQElements == second->EqualPQElements &&
+           first->ComparePQElementPriorities == second->ComparePQElementPriorities &&
+           first->HashPQElement == second->HashPQElement;
+}
+
+PriorityQueueResult pqMeld(PriorityQueue destination, PriorityQueue source){
+    if(isCombined(destination)){
+        PendingCall call = {.kind = CALL_MELD, .source = source};
+        combine(destination, &call);
+        return call.result;
+    }
+    if(destination == NULL || source == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    if(destination == source || !sameCallbacks(destination, source)){
+        return PQ_ERROR;
+    }
+    if(contentOf(source)->size == 0){
+        return PQ_SUCCESS;
+    }
+    if(!beginWrite(destination) || !beginWrite(source)){
+        return PQ_OUT_OF_MEMORY;
+    }
+    if(!isBounded(destination) && source->size > INT_MAX / EXPAND_FACTOR - destination->size){
+        return PQ_OUT_OF_MEMORY;
+    }
+    unsigned long long start = statsClock(destination);
+    /* a bounded destination never holds more than bound nodes, so it only needs room for that many */
+    int incoming = isBounded(destination) ? destination->bound - destination->size : source->size;
+    if(ensureCapacity(destination, destination->size + incoming) != PQ_SUCCESS ||
+       ensureNodesAvailable(destination, incoming) != PQ_SUCCESS){
+        statsRecordLatency(destination, PQ_OPERATION_INSERT, start);
+        return PQ_OUT_OF_MEMORY;
+    }
+
+    /* source's elements keep their relative insertion order and all come after destination's */
+    int old_size = destination->size;
+    int kept = 0;
+    unsigned long long order_offset = destination->next_insertion_order;
+    for(int i = 0; i < source->size; i++){
+        Node moved = source->heap[i];
+        unsigned long long insertion_order = order_offset + moved->insertion_order;
+        if(isFull(destination)){
+            if(!outranksWorst(destination, moved->priority, insertion_order)){
+                deleteNode(source, moved);
+                continue;
+            }
+            evictWorst(destination);
+        }
+        kept++;
+        Node new_node = nodeCreate(destination, moved->element, moved->priority, insertion_order);
+        new_node->hash = moved->hash;
+        placeNode(destination, destination->size, new_node);
+        destination->size++;
+        indexAdd(destination, new_node);
+        worstAdd(destination, new_node);
+        if(isBounded(destination)){
+            siftUp(destination, destination->size - 1);
+        }
+        releaseNode(source, moved);
+    }
+    destination->next_insertion_order += source->next_insertion_order;
+    if(!isBounded(destination)){
+        heapifyAppended(destination, old_size);
+    }
+
+    if(destination->stats != NULL){
+        destination->stats->inserts += kept;
+    }
+    if(source->stats != NULL){
+        source->stats->removes += source->size;
+    }
+    source->size = 0;
+    source->worst_size = 0;
+    indexClear(source);
+    statsRecordLatency(destination, PQ_OPERATION_INSERT, start);
+    return PQ_SUCCESS;
+}
+
+PriorityQueueResult pqRemove(PriorityQueue queue){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_REMOVE};
+        combine(queue, &call);
+        return call.result;
+    }
+    if (!queue){
+        return PQ_NULL_ARGUMENT;
+    }
+    if (contentOf(queue)->size == 0){
+        return PQ_SUCCESS;
+    }
+    if(!beginWrite(queue)){
+        return PQ_OUT_OF_MEMORY;
+    }
+    unsigned long long start = statsClock(queue);
+    deleteNode(queue, detachNode(queue, 0));
+    if(queue->stats != NULL){
+        queue->stats->removes++;
+    }
+    statsRecordLatency(queue, PQ_OPERATION_REMOVE, start);
+    return PQ_SUCCESS;
+}
+
+
+static bool nodeMatches(PriorityQueue queue, Node node, PQElement element, PQElementPriority priority){
+    if(!equalElements(queue, node->element, element)){
+        return false;
+    }
+    return priority == NULL || comparePriorities(queue, node->priority, priority) == 0;
+}
+
+/* hands the element and priority of a detached node to the caller, freeing the priority if the caller
+   does not want it, and recycles the node */
+static void takeNode(PriorityQueue queue, Node node, PQElement* element, PQElementPriority* priority){
+    *element = node->element;
+    if(priority != NULL){
+        *priority = node->priority;
+    }else{
+        freePriority(queue, node->priority);
+    }
+    releaseNode(queue, node);
+}
+
+PriorityQueueResult pqPopTake(PriorityQueue queue, PQElement* element, PQElementPriority* priority){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_POP_TAKE, .elements = element, .priorities = priority};
+        combine(queue, &call);
+        return call.result;
+    }
+    if(queue == NULL || element == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    if(contentOf(queue)->size == 0){
+        return PQ_ELEMENT_DOES_NOT_EXISTS;
+    }
+    if(!beginWrite(queue)){
+        return PQ_OUT_OF_MEMORY;
+    }
+    unsigned long long start = statsClock(queue);
+    takeNode(queue, detachNode(queue, 0), element, priority);
+    if(queue->stats != NULL){
+        queue->stats->removes++;
+    }
+    statsRecordLatency(queue, PQ_OPERATION_REMOVE, start);
+    return PQ_SUCCESS;
+}
+
+/* pops up to limit elements into elements and priorities while predicate accepts the first one, or
+   unconditionally if predicate is NULL. the queue is only written once something is popped.
+   returns the number popped, -1 if the content could not be made private.
+   the whole drain is a single sample in the statistics */
+static int drainPrefix(PriorityQueue queue, int limit, PQDrainPredicate predicate, void* context,
+                       PQElement* elements, PQElementPriority* priorities){
+    unsigned long long start = statsClock(queue);
+    int popped = 0;
+    while(popped < limit && contentOf(queue)->size > 0){
+        Node first = contentOf(queue)->heap[0];
+        if(predicate != NULL && !predicate(first->element, first->priority, context)){
+            break;
+        }
+        if(popped == 0 && !beginWrite(queue)){
+            statsRecordLatency(queue, PQ_OPERATION_REMOVE, start);
+            return -1;
+        }
+        takeNode(queue, detachNode(queue, 0), &elements[popped],
+                 priorities == NULL ? NULL : &priorities[popped]);
+        popped++;
+    }
+    if(queue->stats != NULL){
+        queue->stats->removes += popped;
+    }
+    statsRecordLatency(queue, PQ_OPERATION_REMOVE, start);
+    return popped;
+}
+
+int pqPopBatch(PriorityQueue queue, int k, PQElement* elements, PQElementPriority* priorities){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_POP_BATCH, .count = k, .elements = elements, .priorities = priorities};
+        combine(queue, &call);
+        return call.count_result;
+    }
+    if(queue == NULL || k < 0 || (k > 0 && elements == NULL)){
+        return -1;
+    }
+    return drainPrefix(queue, k, NULL, NULL, elements, priorities);
+}
+
+int pqDrainWhile(PriorityQueue queue, PQDrainPredicate predicate, void* context,
+                 PQElement* elements, PQElementPriority* priorities, int capacity){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_DRAIN_WHILE, .predicate = predicate, .context = context,
+                            .elements = elements, .priorities = priorities, .count = capacity};
+        combine(queue, &call);
+        return call.count_result;
+    }
+    if(queue == NULL || predicate == NULL || capacity < 0 || (capacity > 0 && elements == NULL)){
+        return -1;
+    }
+    return drainPrefix(queue, capacity, predicate, context, elements, priorities);
+}
+
+
+/* returns the index of the first node in queue order whose element equals element, and whose priority
+   equals priority if one is given. returns NOT_FOUND if there is no such node.
+   an indexed queue only looks at the nodes in the element's bucket */
+static int findFirstMatch(PriorityQueue queue, PQElement element, PQElementPriority priority){
+    Node found = NULL;
+    if(isIndexed(queue)){
+        unsigned int hash = queue->HashPQElement(element);
+        for(Node current = *indexBucketOf(queue, hash); current != NULL; current = current->next_in_bucket){
+            statsAddSteps(queue, 1);
+            if(current->hash == hash && nodeMatches(queue, current, element, priority) &&
+                    (found == NULL || nodeComesBefore(queue, current, found))){
+                found = current;
+            }
+        }
+    }else{
+        for(int i = 0; i < queue->size; i++){
+            Node current = queue->heap[i];
+            if(nodeMatches(queue, current, element, priority) &&
+                    (found == NULL || nodeComesBefore(queue, current, found))){
+                found = current;
+            }
+        }
+        statsAddSteps(queue, queue->size);
+    }
+    return found == NULL ? NOT_FOUND : found->heap_index;
+}
+
+
+PriorityQueueResult pqRemoveElement(PriorityQueue queue, PQElement element){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_REMOVE_ELEMENT, .element = element};
+        combine(queue, &call);
+        return call.result;
+    }
+    if(queue == NULL || element == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    unsigned long long start = statsClock(queue);
+    //a private copy of the content keeps every node at its index:
+    int index = findFirstMatch(contentOf(queue), element, NULL);
+    if(index != NOT_FOUND && !beginWrite(queue)){
+        return PQ_OUT_OF_MEMORY;
+    }
+    if(index != NOT_FOUND){
+        deleteNode(queue, detachNode(queue, index));
+        if(queue->stats != NULL){
+            queue->stats->removes++;
+        }
+    }
+    statsRecordLatency(queue, PQ_OPERATION_REMOVE_ELEMENT, start);
+    return index == NOT_FOUND ? PQ_ELEMENT_DOES_NOT_EXISTS : PQ_SUCCESS;
+}
+
+
+static PriorityQueueResult setNodePriority(PriorityQueue queue, Node to_change, PQElementPriority new_priority){
+    PQElementPriority priority_copy = copyPriority(queue, new_priority);
+    if(priority_copy == NULL){
+        return PQ_OUT_OF_MEMORY;
+    }
+    /* a changed element is considered reinserted, so it goes after the equal priorities already queued */
+    freePriority(queue, to_change->priority);
+    to_change->priority = priority_copy;
+    to_change->insertion_order = queue->next_insertion_order;
+    queue->next_insertion_order++;
+    fixHeapPosition(queue, to_change->heap_index);
+    worstFix(queue, to_change);
+    return PQ_SUCCESS;
+}
+
+/* a private copy of the content keeps every node at its index, so the node is found before the write */
+static PriorityQueueResult changeNodePriority(PriorityQueue queue, PQElement element,
+                                              PQElementPriority old_priority, PQElementPriority new_priority){
+    int index = findFirstMatch(contentOf(queue), element, old_priority);
+    if(index == NOT_FOUND){
+        return PQ_ELEMENT_DOES_NOT_EXISTS;
+    }
+    if(!beginWrite(queue)){
+        return PQ_OUT_OF_MEMORY;
+    }
+    return setNodePriority(queue, queue->heap[index], new_priority);
+}
+
+PriorityQueueResult pqChangePriority(PriorityQueue queue, PQElement element,
+                                     PQElementPriority old_priority, PQElementPriority new_priority){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_CHANGE_PRIORITY, .element = element, .priority = old_priority,
+                            .new_priority = new_priority};
+        combine(queue, &call);
+        return call.result;
+    }
+    if (!queue || !element || !old_priority || !new_priority){
+        return PQ_NULL_ARGUMENT;
+    }
+    unsigned long long start = statsClock(queue);
+    PriorityQueueResult result = changeNodePriority(queue, element, old_priority, new_priority);
+    statsRecordLatency(queue, PQ_OPERATION_CHANGE_PRIORITY, start);
+    return result;
+}
+
+
+PriorityQueueResult pqChangePriorityByHandle(PriorityQueue queue, PQHandle handle, PQElementPriority new_priority){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_CHANGE_PRIORITY_BY_HANDLE, .handle = handle, .new_priority = new_priority};
+        combine(queue, &call);
+        return call.result;
+    }
+    if (!queue || !new_priority){
+        return PQ_NULL_ARGUMENT;
+    }
+    //a private copy of the content keeps every node's handle:
+    if(nodeOfHandle(contentOf(queue), handle) == NULL){
+        return PQ_ITEM_DOES_NOT_EXIST;
+    }
+    if(!beginWrite(queue)){
+        return PQ_OUT_OF_MEMORY;
+    }
+    Node to_change = nodeOfHandle(queue, handle);
+    unsigned long long start = statsClock(queue);
+    PriorityQueueResult result = setNodePriority(queue, to_change, new_priority);
+    statsRecordLatency(queue, PQ_OPERATION_CHANGE_PRIORITY, start);
+    return result;
+}
+
+
+PriorityQueueResult pqRemoveByHandle(PriorityQueue queue, PQHandle handle){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_REMOVE_BY_HANDLE, .handle = handle};
+        combine(queue, &call);
+        return call.result;
+    }
+    if(queue == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    if(nodeOfHandle(contentOf(queue), handle) == NULL){
+        return PQ_ITEM_DOES_NOT_EXIST;
+    }
+    if(!beginWrite(queue)){
+        return PQ_OUT_OF_MEMORY;
+    }
+    Node to_remove = nodeOfHandle(queue, handle);
+    unsigned long long start = statsClock(queue);
+    deleteNode(queue, detachNode(queue, to_remove->heap_index));
+    if(queue->stats != NULL){
+        queue->stats->removes++;
+    }
+    statsRecordLatency(queue, PQ_OPERATION_REMOVE_ELEMENT, start);
+    return PQ_SUCCESS;
+}
+
+
+PQElement pqGetByHandle(PriorityQueue queue, PQHandle handle){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_GET_BY_HANDLE, .handle = handle};
+        combine(queue, &call);
+        return call.element_result;
+    }
+    if(queue == NULL){
+        return NULL;
+    }
+    Node node = nodeOfHandle(contentOf(queue), handle);
+    return node == NULL ? NULL : node->element;
+}
+
+
+/* fills queue->order with the nodes of its content sorted by priority. the heap is copied as is
+   and heap-sorted, which leaves the lowest priority first, so the result is then reversed */
+static void buildIterationOrder(PriorityQueue queue){
+    if(queue->order_valid){
+        return;
+    }
+    PriorityQueue content = contentOf(queue);
+    assert(queue->order_capacity >= content->size);
+    Node* order = queue->order;
+    for(int i = 0; i < content->size; i++){
+        order[i] = content->heap[i];
+    }
+    for(int end = content->size - 1; end > 0; end--){
+        swapNodes(queue, order, 0, end);
+        siftDown(queue, order, end, 0);
+    }
+    for(int low = 0, high = content->size - 1; low < high; low++, high--){
+        swapNodes(queue, order, low, high);
+    }
+    queue->order_valid = true;
+}
+
+
+PQElement pqGetFirst(PriorityQueue queue){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_GET_FIRST};
+        combine(queue, &call);
+        return call.element_result;
+    }
+    if(queue == NULL){
+        return NULL;
+    }
+    PriorityQueue content = contentOf(queue);
+    if(content->size == 0){
+        return NULL;
+    }
+    /* the top of the heap is always the first in order, so the sort is deferred to pqGetNext */
+    queue->iterator = 0;
+    return content->heap[0]->element;
+}
+
+
+PQElementPriority pqGetFirstPriority(PriorityQueue queue){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_GET_FIRST_PRIORITY};
+        combine(queue, &call);
+        return call.element_result;
+    }
+    if(queue == NULL){
+        return NULL;
+    }
+    PriorityQueue content = contentOf(queue);
+    return content->size == 0 ? NULL : content->heap[0]->priority;
+}
+
+
+PQElement pqGetNext(PriorityQueue queue){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_GET_NEXT};
+        combine(queue, &call);
+        return call.element_result;
+    }
+    if(queue == NULL){
+        return NULL;
+    }
+    if(queue->iterator == NO_ITERATOR){
+        return NULL;
+    }
+    PriorityQueue content = contentOf(queue);
+    buildIterationOrder(queue);
+    queue->iterator++;
+    if(queue->iterator >= content->size){
+        queue->iterator = NO_ITERATOR;
+        return NULL;
+    }
+    return queue->order[queue->iterator]->element;
+}
+
+/*=========================================================================*/
+/* cursors */
+
+/* a cursor walks the heap best-first: the frontier is a small heap of the heap indices whose parents
+   were already returned, and the next element is always at its top. the cursor only reads the queue,
+   and calls the compare function directly instead of counting it, so cursors may run concurrently */
+struct PQCursor_t {
+    PriorityQueue queue;
+    PriorityQueue content;
+    unsigned long long modification_count;
+    int* frontier;
+    int frontier_size;
+    int frontier_capacity;
+};
+
+static bool cursorComesBefore(PQCursor cursor, int first, int second){
+    Node first_node = cursor->content->heap[first];
+    Node second_node = cursor->content->heap[second];
+    int compare = cursor->content->ComparePQElementPriorities(first_node->priority, second_node->priority);
+    if(compare != 0){
+        return compare > 0;
+    }
+    return first_node->insertion_order < second_node->insertion_order;
+}
+
+static void cursorSwap(PQCursor cursor, int first, int second){
+    int temp = cursor->frontier[first];
+    cursor->frontier[first] = cursor->frontier[second];
+    cursor->frontier[second] = temp;
+}
+
+static bool cursorPush(PQCursor cursor, int heap_index){
+    if(cursor->frontier_size == cursor->frontier_capacity){
+        int new_capacity = cursor->frontier_capacity * EXPAND_FACTOR;
+        int* new_frontier = realloc(cursor->frontier, sizeof(*new_frontier) * new_capacity);
+        if(new_frontier == NULL){
+            return false;
+        }
+        cursor->frontier = new_frontier;
+        cursor->frontier_capacity = new_capacity;
+    }
+    int index = cursor->frontier_size;
+    cursor->frontier[index] = heap_index;
+    cursor->frontier_size++;
+    while(index > 0 && cursorComesBefore(cursor, cursor->frontier[index], cursor->frontier[(index - 1) / 2])){
+        cursorSwap(cursor, index, (index - 1) / 2);
+        index = (index - 1) / 2;
+    }
+    return true;
+}
+
+static int cursorPop(PQCursor cursor){
+    int first = cursor->frontier[0];
+    cursor->frontier_size--;
+    cursor->frontier[0] = cursor->frontier[cursor->frontier_size];
+    int index = 0;
+    while(true){
+        int best = index;
+        int left = 2 * index + 1;
+        int right = left + 1;
+        if(left < cursor->frontier_size && cursorComesBefore(cursor, cursor->frontier[left], cursor->frontier[best])){
+            best = left;
+        }
+        if(right < cursor->frontier_size && cursorComesBefore(cursor, cursor->frontier[right], cursor->frontier[best])){
+            best = right;
+        }
+        if(best == index){
+            return first;
+        }
+        cursorSwap(cursor, index, best);
+        index = best;
+    }
+}
+
+PQCursor pqCursorOpen(PriorityQueue queue){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_CURSOR_OPEN};
+        combine(queue, &call);
+        return call.cursor_result;
+    }
+    if(queue == NULL){
+        return NULL;
+    }
+    PQCursor cursor = malloc(sizeof(*cursor));
+    if(cursor == NULL){
+        return NULL;
+    }
+    cursor->frontier = malloc(sizeof(*cursor->frontier) * INITIAL_CAPACITY);
+    if(cursor->frontier == NULL){
+        free(cursor);
+        return NULL;
+    }
+    cursor->queue = queue;
+    cursor->content = contentOf(queue);
+    cursor->modification_count = queue->modification_count;
+    cursor->frontier_size = 0;
+    cursor->frontier_capacity = INITIAL_CAPACITY;
+    if(cursor->content->size > 0){
+        cursor->frontier[cursor->frontier_size++] = 0;
+    }
+    return cursor;
+}
+
+PQElement pqCursorNext(PQCursor cursor){
+    if(cursor != NULL && isCombined(cursor->queue)){
+        PendingCall call = {.kind = CALL_CURSOR_NEXT, .cursor = cursor};
+        combine(cursor->queue, &call);
+        return call.element_result;
+    }
+    if(cursor == NULL || cursor->frontier_size == 0){
+        return NULL;
+    }
+    if(cursor->queue->modification_count != cursor->modification_count){
+        cursor->frontier_size = 0;
+        return NULL;
+    }
+    //copying a copy-on-write queue moves its unchanged content into a frozen one:
+    cursor->content = contentOf(cursor->queue);
+    int next = cursorPop(cursor);
+    int size = cursor->content->size;
+    for(int child = 2 * next + 1; child <= 2 * next + 2 && child < size; child++){
+        if(!cursorPush(cursor, child)){
+            cursor->frontier_size = 0;
+            return NULL;
+        }
+    }
+    return cursor->content->heap[next]->element;
+}
+
+void pqCursorClose(PQCursor cursor){
+    if(cursor == NULL){
+        return;
+    }
+    free(cursor->frontier);
+    free(cursor);
+}
+
+PriorityQueueResult pqClear(PriorityQueue queue){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_CLEAR};
+        combine(queue, &call);
+        return call.result;
+    }
+    if(queue == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    unsigned long long start = statsClock(queue);
+    if(queue->stats != NULL){
+        queue->stats->removes += contentOf(queue)->size;
+    }
+    /* a content shared with other queues is left to them rather than copied only to be emptied */
+    if(queue->shared != NULL && queue->shared->share_count > 1){
+        struct PriorityQueue_t empty = *queue;
+        if(!initContent(&empty)){
+            return PQ_OUT_OF_MEMORY;
+        }
+        dropShare(queue);
+        moveContent(queue, &empty);
+    }
+    if(!beginWrite(queue)){
+        return PQ_OUT_OF_MEMORY;
+    }
+    destroyHeapNodes(queue);
+    indexClear(queue);
+    statsRecordLatency(queue, PQ_OPERATION_CLEAR, start);
+    return PQ_SUCCESS;
+}
+
+
+PriorityQueueResult pqEnableStats(PriorityQueue queue, bool enable){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_ENABLE_STATS, .flag = enable};
+        combine(queue, &call);
+        return call.result;
+    }
+    if(queue == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    if(!enable){
+        free(queue->stats);
+        queue->stats = NULL;
+        return PQ_SUCCESS;
+    }
+    if(queue->stats != NULL){
+        return PQ_SUCCESS;
+    }
+    queue->stats = malloc(sizeof(*queue->stats));
+    if(queue->stats == NULL){
+        return PQ_OUT_OF_MEMORY;
+    }
+    memset(queue->stats, 0, sizeof(*queue->stats));
+    return PQ_SUCCESS;
+}
+
+PriorityQueueResult pqGetStats(PriorityQueue queue, PQStats* stats){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_GET_STATS, .stats = stats};
+        combine(queue, &call);
+        return call.result;
+    }
+    if(queue == NULL || stats == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    if(queue->stats == NULL){
+        return PQ_ERROR;
+    }
+    *stats = *queue->stats;
+    stats->size = contentOf(queue)->size;
+    return PQ_SUCCESS;
+}
+
+PriorityQueueResult pqResetStats(PriorityQueue queue){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_RESET_STATS};
+        combine(queue, &call);
+        return call.result;
+    }
+    if(queue == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    if(queue->stats == NULL){
+        return PQ_ERROR;
+    }
+    memset(queue->stats, 0, sizeof(*queue->stats));
+    return PQ_SUCCESS;
+}
+
+
+PriorityQueueResult pqShrinkToFit(PriorityQueue queue){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_SHRINK_TO_FIT};
+        combine(queue, &call);
+        return call.result;
+    }
+    if(queue == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    if(queue->shared != NULL){
+        return PQ_SUCCESS;
+    }
+    poolReleaseEmptySlabs(queue);
+
+    /* failing to shrink an array only means keeping it as it is */
+    int new_capacity = queue->size > INITIAL_CAPACITY ? queue->size : INITIAL_CAPACITY;
+    if(new_capacity < queue->capacity){
+        Node* new_heap = realloc(queue->heap, sizeof(*new_heap) * new_capacity);
+        if(new_heap != NULL){
+            queue->heap = new_heap;
+            queue->capacity = new_capacity;
+        }
+    }
+    if(queue->capacity < queue->order_capacity){
+        Node* new_order = realloc(queue->order, sizeof(*new_order) * queue->capacity);
+        if(new_order != NULL){
+            queue->order = new_order;
+            queue->order_capacity = queue->capacity;
+        }
+    }
+    queue->order_valid = false;
+
+    if(isIndexed(queue)){
+        int bucket_count = INITIAL_INDEX_BUCKETS;
+        while(bucket_count < queue->size){
+            bucket_count *= EXPAND_FACTOR;
+        }
+        if(bucket_count < queue->index_bucket_count){
+            indexRehash(queue, bucket_count);
+        }
+    }
+    return PQ_SUCCESS;
+}
+
+/*=========================================================================*/
+/* snapshots */
+
+/* a snapshot is a header, the elements in priority order and a trailer, with every number little endian:
+       magic "PQSN", u32 version, u64 element count
+       for each element: u32 element size, element bytes, u32 priority size, priority bytes
+       u32 CRC-32 of everything before it
+   since the elements are already sorted, they form a valid heap as they are */
+static const unsigned char SNAPSHOT_MAGIC[] = {'P', 'Q', 'S', 'N'};
+
+/* a buffered reader or writer over a file descriptor, keeping the checksum of the bytes it passed */
+typedef struct snapshot_stream {
+    int fd;
+    unsigned char* buffer;
+    int length;
+    int position;
+    uint32_t checksum;
+    unsigned char* scratch;
+    int scratch_size;
+    bool failed;
+} SnapshotStream;
+
+static bool streamOpen(SnapshotStream* stream, int fd){
+    stream->buffer = malloc(SNAPSHOT_BUFFER_SIZE);
+    if(stream->buffer == NULL){
+        return false;
+    }
+    stream->fd = fd;
+    stream->length = 0;
+    stream->position = 0;
+    stream->checksum = CHECKSUM_EMPTY;
+    stream->scratch = NULL;
+    stream->scratch_size = 0;
+    stream->failed = false;
+    return true;
+}
+
+static void streamClose(SnapshotStream* stream){
+    free(stream->buffer);
+    free(stream->scratch);
+}
+
+static void streamChecksum(SnapshotStream* stream, const unsigned char* bytes, int size){
+    stream->checksum = checksumUpdate(stream->checksum, bytes, size);
+}
+
+/* the checksum of every byte passed so far */
+static uint32_t streamChecksumValue(SnapshotStream* stream){
+    return stream->checksum;
+}
+
+/* makes sure the scratch buffer holds at least size bytes */
+static bool streamReserveScratch(SnapshotStream* stream, int size){
+    if(size <= stream->scratch_size){
+        return true;
+    }
+    unsigned char* scratch = realloc(stream->scratch, size);
+    if(scratch == NULL){
+        return false;
+    }
+    stream->scratch = scratch;
+    stream->scratch_size = size;
+    return true;
+}
+
+static void streamFlush(SnapshotStream* stream){
+    int written = 0;
+    while(!stream->failed && written < stream->length){
+        ssize_t result = write(stream->fd, stream->buffer + written, stream->length - written);
+        if(result < 0 && errno != EINTR){
+            stream->failed = true;
+        } else if(result > 0){
+            written += (int)result;
+        }
+    }
+    stream->length = 0;
+}
+
+static void streamWrite(SnapshotStream* stream, const unsigned char* bytes, int size){
+    streamChecksum(stream, bytes, size);
+    while(size > 0 && !stream->failed){
+        if(stream->length == SNAPSHOT_BUFFER_SIZE){
+            streamFlush(stream);
+        }
+        int chunk = SNAPSHOT_BUFFER_SIZE - stream->length;
+        if(chunk > size){
+            chunk = size;
+        }
+        memcpy(stream->buffer + stream->length, bytes, chunk);
+        stream->length += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
+}
+
+static void streamWriteNumber(SnapshotStream* stream, uint64_t value, int size){
+    unsigned char bytes[sizeof(value)];
+    for(int i = 0; i < size; i++){
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    streamWrite(stream, bytes, size);
+}
+
+/* fills the buffer from the file, failing at its end */
+static void streamFill(SnapshotStream* stream){
+    while(!stream->failed && stream->position == stream->length){
+        ssize_t result = read(stream->fd, stream->buffer, SNAPSHOT_BUFFER_SIZE);
+        if(result == 0 || (result < 0 && errno != EINTR)){
+            stream->failed = true;
+        } else if(result > 0){
+            stream->length = (int)result;
+            stream->position = 0;
+        }
+    }
+}
+
+static void streamRead(SnapshotStream* stream, unsigned char* bytes, int size){
+    unsigned char* start = bytes;
+    int total = size;
+    while(size > 0 && !stream->failed){
+        streamFill(stream);
+        if(stream->failed){
+            return;
+        }
+        int chunk = stream->length - stream->position;
+        if(chunk > size){
+            chunk = size;
+        }
+        memcpy(bytes, stream->buffer + stream->position, chunk);
+        stream->position += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
+    streamChecksum(stream, start, total);
+}
+
+static uint64_t streamReadNumber(SnapshotStream* stream, int size){
+    unsigned char bytes[sizeof(uint64_t)] = {0};
+    streamRead(stream, bytes, size);
+    uint64_t value = 0;
+    for(int i = 0; i < size; i++){
+        value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+/* writes the size and the bytes serialize gives for value. element and priority serializers have the
+   same type, so this serves both */
+static PriorityQueueResult writeSerialized(SnapshotStream* stream, SerializePQElement serialize, void* value){
+    int size = serialize(value, stream->scratch, stream->scratch_size);
+    if(size > stream->scratch_size){
+        if(!streamReserveScratch(stream, size)){
+            return PQ_OUT_OF_MEMORY;
+        }
+        size = serialize(value, stream->scratch, stream->scratch_size);
+    }
+    if(size < 0 || size > stream->scratch_size){
+        return PQ_ERROR;
+    }
+    streamWriteNumber(stream, (uint64_t)size, sizeof(uint32_t));
+    streamWrite(stream, stream->scratch, size);
+    return stream->failed ? PQ_ERROR : PQ_SUCCESS;
+}
+
+/* reads size bytes into the scratch buffer. the buffer at most doubles before the bytes filling it
+   arrive, so a forged size costs no more memory than the file really holds */
+static void streamReadScratch(SnapshotStream* stream, int size){
+    int done = 0;
+    while(done < size && !stream->failed){
+        int chunk = size - done;
+        int limit = done > SNAPSHOT_BUFFER_SIZE ? done : SNAPSHOT_BUFFER_SIZE;
+        if(done + chunk > stream->scratch_size && chunk > limit){
+            chunk = limit;
+        }
+        if(!streamReserveScratch(stream, done + chunk)){
+            stream->failed = true;
+            return;
+        }
+        streamRead(stream, stream->scratch + done, chunk);
+        done += chunk;
+    }
+}
+
+/* reads a size and that many bytes, and returns what deserialize makes of them, NULL on failure */
+static void* readSerialized(SnapshotStream* stream, DeserializePQElement deserialize){
+    uint64_t size = streamReadNumber(stream, sizeof(uint32_t));
+    if(stream->failed || size > INT_MAX){
+        return NULL;
+    }
+    streamReadScratch(stream, (int)size);
+    return stream->failed ? NULL : deserialize(stream->scratch, (int)size);
+}
+
+PriorityQueueResult pqSave(PriorityQueue queue, int fd, SerializePQElement serialize_element,
+                           SerializePQElementPriority serialize_priority){
+    if(isCombined(queue)){
+        PendingCall call = {.kind = CALL_SAVE, .count = fd, .serialize_element = serialize_element,
+                            .serialize_priority = serialize_priority};
+        combine(queue, &call);
+        return call.result;
+    }
+    if(queue == NULL || serialize_element == NULL || serialize_priority == NULL){
+        return PQ_NULL_ARGUMENT;
+    }
+    PriorityQueue content = contentOf(queue);
+    SnapshotStream stream;
+    if(!streamOpen(&stream, fd)){
+        return PQ_OUT_OF_MEMORY;
+    }
+    buildIterationOrder(queue);
+    streamWrite(&stream, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    streamWriteNumber(&stream, SNAPSHOT_VERSION, sizeof(uint32_t));
+    streamWriteNumber(&stream, (uint64_t)content->size, sizeof(uint64_t));
+    PriorityQueueResult result = PQ_SUCCESS;
+    for(int i = 0; i < content->size && result == PQ_SUCCESS; i++){
+        result = writeSerialized(&stream, serialize_element, queue->order[i]->element);
+        if(result == PQ_SUCCESS){
+            result = writeSerialized(&stream, serialize_priority, queue->order[i]->priority);
+        }
+    }
+    if(result == PQ_SUCCESS){
+        streamWriteNumber(&stream, streamChecksumValue(&stream), sizeof(uint32_t));
+        streamFlush(&stream);
+        result = stream.failed ? PQ_ERROR : PQ_SUCCESS;
+    }
+    streamClose(&stream);
+    return result;
+}
+
+/* reads the snapshot's elements into the empty queue, placing them in the heap in the order they come.
+   the count in the header is not trusted before the checksum is: the heap grows as elements arrive */
+static bool loadElements(PriorityQueue queue, SnapshotStream* stream,
+                         DeserializePQElement deserialize_element,
+                         DeserializePQElementPriority deserialize_priority){
+    unsigned char magic[sizeof(SNAPSHOT_MAGIC)];
+    streamRead(stream, magic, sizeof(magic));
+    uint64_t version = streamReadNumber(stream, sizeof(uint32_t));
+    uint64_t count = streamReadNumber(stream, sizeof(uint64_t));
+    if(stream->failed || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 || version != SNAPSHOT_VERSION ||
+       count > INT_MAX / EXPAND_FACTOR){
+        return false;
+    }
+    for(int i = 0; i < (int)count; i++){
+        if(ensureRoomForNode(queue) != PQ_SUCCESS){
+            return false;
+        }
+        PQElement element = readSerialized(stream, deserialize_element);
+        if(element == NULL){
+            return false;
+        }
+        PQElementPriority priority = readSerialized(stream, deserialize_priority);
+        if(priority == NULL){
+            freeElement(queue, element);
+            return false;
+        }
+        placeNode(queue, i, nodeCreate(queue, element, priority, queue->next_insertion_order));
+        queue->next_insertion_order++;
+        queue->size++;
+    }
+    uint32_t checksum = streamChecksumValue(stream);
+    return streamReadNumber(stream, sizeof(uint32_t)) == checksum && !stream->failed;
+}
+
+PriorityQueue pqLoad(int fd,
+                     DeserializePQElement deserialize_element,
+                     DeserializePQElementPriority deserialize_priority,
+                     CopyPQElement copy_element,
+                     FreePQElement free_element,
+                     EqualPQElements equal_elements,
+                     CopyPQElementPriority copy_priority,
+                     FreePQElementPriority free_priority,
+                     ComparePQElementPriorities compare_priorities){
+    if(deserialize_element == NULL || deserialize_priority == NULL){
+        return NULL;
+    }
+    PriorityQueue queue = pqCreate(copy_element, free_element, equal_elements,
+                                   copy_priority, free_priority, compare_priorities);
+    if(queue == NULL){
+        return NULL;
+    }
+    SnapshotStream stream;
+    if(!streamOpen(&stream, fd)){
+        pqDestroy(queue);
+        return NULL;
+    }
+    bool loaded = loadElements(queue, &stream, deserialize_element, deserialize_priority);
+    streamClose(&stream);
+    if(!loaded){
+        pqDestroy(queue);
+        return NULL;
+    }
+    return queue;
+}
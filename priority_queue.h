@@ -10,30 +10,64 @@
 * The priority queue has an internal iterator for external use. For all functions
 * where the state of the iterator after calling that function is not stated,
 * it is undefined. That means that you cannot assume anything about it.
+* The queue is kept as an array-backed binary heap, so pqInsert and pqRemove take O(log n).
+* Its nodes come from a per-queue pool and are recycled rather than freed, see pqShrinkToFit.
+* Iterating in priority order sorts the queue once, on the first pqGetNext after a change. The room
+* for that sort is reserved whenever the heap grows, so iterating never allocates and never fails.
 *
 * The following functions are available:
 *   pqCreate		    - Creates a new empty priority queue
+*   pqCreateIndexed     - Creates a new empty priority queue that finds elements through a hash index
+*   pqCreateFromArray   - Creates a priority queue holding the elements of an array
+*   pqCreateConcurrent  - Creates a new empty priority queue that can be used from several threads at once
+*   pqCreateBounded     - Creates a new empty priority queue that keeps only its highest priority elements
 *   pqDestroy		    - Deletes an existing priority queue and frees all resources
 *   pqCopy		        - Copies an existing priority queue
+*   pqSetCopyOnWrite    - Makes copies of a priority queue share its elements until one of them changes
 *   pqGetSize		    - Returns the size of a given priority queue
 *   pqContains	        - returns whether or not an element exists inside the priority queue.
 *   pqInsert	        - Insert an element with a given priority to the queue.
 *   				        Duplication in the priority queue is allowed.
 *   				        Iterator value is undefined after this operation.
+*   pqInsertWithHandle  - Inserts like pqInsert and returns a handle to the inserted element
+*   pqInsertTake        - Inserts an element and a priority the queue takes ownership of, without copying them
+*   pqInsertBatch       - Inserts the elements of an array at once
+*   pqSetBatchThreads   - Sets how many threads pqInsertBatch may use
+*   pqMeld              - Moves all the elements of one priority queue into another
 *   pqChangePriority  	- Changes priority of an element with specific priority
 *					        Iterator value is undefined after this operation.
+*   pqChangePriorityByHandle - Changes the priority of the element a handle refers to
 *   pqRemove		    - Removes the highest priority element in the queue
 *                           Iterator value is undefined after this operation.
+*   pqPopTake           - Removes the highest priority element and hands it to the caller instead of freeing it
+*   pqPopBatch          - Removes the k highest priority elements and hands them to the caller
+*   pqDrainWhile        - Removes elements from the top while a predicate accepts them and hands them to the caller
+*   pqRemoveByHandle    - Removes the element a handle refers to
+*   pqGetByHandle       - Returns the element a handle refers to
 *   pqGetFirst	        - Sets the internal iterator to the first element in the priority queue and returns it
 *   pqGetNext		    - Advances the internal iterator to the next key and returns it.
+*   pqGetFirstPriority  - Returns the priority of the highest priority element
 *	pqClear		        - Clears the contents of the priority queue. Frees all the elements of
 *	 				        the queue using the free function.
+*   pqShrinkToFit       - Gives back memory the queue kept for elements it no longer holds
+*   pqSave              - Writes a snapshot of the priority queue to a file
+*   pqLoad              - Creates a priority queue from a snapshot written by pqSave
+*   pqEnableStats       - Turns collection of operation statistics on or off
+*   pqGetStats          - Returns the statistics collected since they were enabled or reset
+*   pqResetStats        - Zeroes the collected statistics
+*   pqCursorOpen        - Opens a cursor for iterating over the queue without using its internal iterator
+*   pqCursorNext        - Returns the next element of a cursor
+*   pqCursorClose       - Closes a cursor
 * 	PQ_FOREACH	        - A macro for iterating over the priority queue's elements.
+*   PQ_FOREACH_CURSOR   - A macro for iterating over the priority queue's elements with a cursor.
 */
 
 /** Type for defining the priority queue */
 typedef struct PriorityQueue_t *PriorityQueue;
 
+/** Type for iterating over a priority queue independently of its internal iterator, see pqCursorOpen */
+typedef struct PQCursor_t *PQCursor;
+
 /** Type used for returning error codes from priority queue functions */
 typedef enum PriorityQueueResult_t {
     PQ_SUCCESS,
@@ -44,6 +78,15 @@ typedef enum PriorityQueueResult_t {
     PQ_ERROR
 } PriorityQueueResult;
 
+/**
+* Handle to an element inside a priority queue, returned by pqInsertWithHandle.
+* A handle stays valid until its element is removed from the queue, and refers to the same element
+* in copies made by pqCopy. The value is opaque, except that PQ_INVALID_HANDLE is never returned.
+*/
+typedef unsigned long long PQHandle;
+
+#define PQ_INVALID_HANDLE 0ULL
+
 /** Data element data type for priority queue container */
 typedef void *PQElement;
 
@@ -72,6 +115,14 @@ typedef void(*FreePQElementPriority)(PQElementPriority);
 typedef bool(*EqualPQElements)(PQElement, PQElement);
 
 
+/**
+* Type of function used by an indexed priority queue to hash elements.
+* Elements that are equal by EqualPQElements must have the same hash, and the hash of a queued element
+* must not change while it is in the queue.
+*/
+typedef unsigned int(*HashPQElement)(PQElement);
+
+
 /**
 * Type of function used by the priority queue to compare priorities.
 * This function should return:
@@ -82,6 +133,70 @@ typedef bool(*EqualPQElements)(PQElement, PQElement);
 typedef int(*ComparePQElementPriorities)(PQElementPriority, PQElementPriority);
 
 
+/**
+* Type of function used by pqDrainWhile to decide whether to remove the first element.
+* Receives the element, its priority and the context given to pqDrainWhile, and should return
+* true to remove the element and go on, false to stop.
+*/
+typedef bool(*PQDrainPredicate)(PQElement, PQElementPriority, void*);
+
+
+/**
+* Type of function used by pqSave to turn an element into bytes.
+* Receives the element, a buffer and the buffer's size, and should return the number of bytes the
+* element takes, writing them into the buffer only if they fit. A negative value fails the save.
+*/
+typedef int(*SerializePQElement)(PQElement, unsigned char*, int);
+
+/** Type of function used by pqSave to turn a priority into bytes, like SerializePQElement */
+typedef int(*SerializePQElementPriority)(PQElementPriority, unsigned char*, int);
+
+/**
+* Type of function used by pqLoad to rebuild an element from the bytes its serializer wrote.
+* Receives the bytes and their number, and should return a new element the queue will own,
+* or NULL on failure.
+*/
+typedef PQElement(*DeserializePQElement)(const unsigned char*, int);
+
+/** Type of function used by pqLoad to rebuild a priority, like DeserializePQElement */
+typedef PQElementPriority(*DeserializePQElementPriority)(const unsigned char*, int);
+
+
+/** Number of buckets in each latency histogram of PQStats */
+#define PQ_STATS_HISTOGRAM_BUCKETS 32
+
+/** Operations that have a latency histogram in PQStats */
+typedef enum PQOperation_t {
+    PQ_OPERATION_INSERT,
+    PQ_OPERATION_REMOVE,
+    PQ_OPERATION_REMOVE_ELEMENT,
+    PQ_OPERATION_CHANGE_PRIORITY,
+    PQ_OPERATION_CONTAINS,
+    PQ_OPERATION_COPY,
+    PQ_OPERATION_CLEAR,
+    PQ_OPERATION_COUNT
+} PQOperation;
+
+/**
+* Statistics collected by a priority queue once pqEnableStats was called.
+* steps counts the heap levels an element moved through plus the nodes scanned by searches.
+* latency[operation][b] counts calls to operation that took between 2^b and 2^(b+1) nanoseconds,
+* the last bucket also holds everything slower.
+*/
+typedef struct PQStats_t {
+    int size;
+    unsigned long long inserts;
+    unsigned long long removes;
+    unsigned long long comparisons;
+    unsigned long long equality_checks;
+    unsigned long long element_copies;
+    unsigned long long priority_copies;
+    unsigned long long element_frees;
+    unsigned long long priority_frees;
+    unsigned long long steps;
+    unsigned long long latency[PQ_OPERATION_COUNT][PQ_STATS_HISTOGRAM_BUCKETS];
+} PQStats;
+
 /**
 * pqCreate: Allocates a new empty priority queue.
 *
@@ -108,6 +223,95 @@ PriorityQueue pqCreate(CopyPQElement copy_element,
                        FreePQElementPriority free_priority,
                        ComparePQElementPriorities compare_priorities);
 
+/**
+* pqCreateIndexed: Allocates a new empty priority queue that keeps a hash index from elements to
+* their place in the queue. pqContains, pqRemoveElement and pqChangePriority look elements up in
+* the index in expected O(1) instead of scanning the whole queue. Otherwise behaves like pqCreate.
+*
+* @param hash_element - Function pointer to be used for hashing elements, see HashPQElement.
+* 	The other parameters are the same as in pqCreate.
+* @return
+* 	NULL - if hash_element is NULL or allocations failed.
+* 	A new priority queue in case of success.
+*/
+PriorityQueue pqCreateIndexed(CopyPQElement copy_element,
+                              FreePQElement free_element,
+                              EqualPQElements equal_elements,
+                              HashPQElement hash_element,
+                              CopyPQElementPriority copy_priority,
+                              FreePQElementPriority free_priority,
+                              ComparePQElementPriorities compare_priorities);
+
+/**
+* pqCreateConcurrent: Allocates a new empty priority queue that may be used by several threads at once,
+* through the same functions as any other queue. Calls are applied by flat combining: each thread publishes
+* its call, and the thread that gets the queue's lock applies all the published calls in one go while the
+* others wait for theirs. Every call is applied atomically, in some order consistent with when it was
+* made, so removals always take the element of highest priority at that point.
+* The parameters are the same as in pqCreate. The following are not thread safe even for this queue and must
+* not run while other threads use it: pqDestroy, pqSetBatchThreads, pqSetCopyOnWrite, pqCursorClose, and
+* pqMeld's source. Elements returned by the queue, and its internal iterator, may be changed at any time by
+* other threads, so the caller has to coordinate with them to rely on either.
+* Copies made by pqCopy are regular queues.
+*
+* @return
+* 	NULL - if one of the parameters is NULL or allocations failed.
+* 	A new priority queue in case of success.
+*/
+PriorityQueue pqCreateConcurrent(CopyPQElement copy_element,
+                                 FreePQElement free_element,
+                                 EqualPQElements equal_elements,
+                                 CopyPQElementPriority copy_priority,
+                                 FreePQElementPriority free_priority,
+                                 ComparePQElementPriorities compare_priorities);
+
+/**
+* pqCreateBounded: Allocates a new empty priority queue that holds at most capacity elements, the ones
+* of highest priority offered to it. Once it is full, an insert whose priority is not above the lowest
+* priority in the queue is dropped, and any other insert first removes the element that would come last
+* in the queue. Both ends are kept in O(1), so inserting still takes O(log capacity).
+* A dropped insert still returns PQ_SUCCESS: pqInsertWithHandle then returns PQ_INVALID_HANDLE, and
+* pqInsertTake frees the element and priority it was given. pqInsertBatch and pqMeld into a bounded queue
+* offer their elements one by one, so they may drop some of them, or the queue's own elements.
+* Otherwise behaves like pqCreate, and copies made by pqCopy have the same capacity.
+*
+* @param capacity - The most elements the queue holds, must be positive.
+* 	The other parameters are the same as in pqCreate.
+* @return
+* 	NULL - if capacity is not positive, one of the other parameters is NULL or allocations failed.
+* 	A new priority queue in case of success.
+*/
+PriorityQueue pqCreateBounded(int capacity,
+                              CopyPQElement copy_element,
+                              FreePQElement free_element,
+                              EqualPQElements equal_elements,
+                              CopyPQElementPriority copy_priority,
+                              FreePQElementPriority free_priority,
+                              ComparePQElementPriorities compare_priorities);
+
+/**
+* pqCreateFromArray: Allocates a new priority queue holding copies of elements[i] with priorities[i]
+* for every i below count, as if they were inserted one by one in array order, but built with a single
+* heapify pass in O(count).
+*
+* @param elements - Array of count elements to copy into the queue.
+* @param priorities - Array of the count matching priorities.
+* @param count - Number of elements, may be 0.
+* 	The other parameters are the same as in pqCreate.
+* @return
+* 	NULL - if one of the parameters or array items is NULL, count is negative or allocations failed.
+* 	A new priority queue in case of success.
+*/
+PriorityQueue pqCreateFromArray(CopyPQElement copy_element,
+                                FreePQElement free_element,
+                                EqualPQElements equal_elements,
+                                CopyPQElementPriority copy_priority,
+                                FreePQElementPriority free_priority,
+                                ComparePQElementPriorities compare_priorities,
+                                PQElement* elements,
+                                PQElementPriority* priorities,
+                                int count);
+
 /**
 * pqDestroy: Deallocates an existing priority queue. Clears all elements by using the
 * free functions.
@@ -119,6 +323,8 @@ void pqDestroy(PriorityQueue queue);
 
 /**
 * pqCopy: Creates a copy of target priority queue.
+* If copy on write is enabled for queue, see pqSetCopyOnWrite, this takes O(1) and the copying is deferred
+* to the first change of either queue. Otherwise every element and priority is copied using the copy functions.
 * Iterator values for both priority queues are undefined after this operation.
 *
 * @param queue - Target priority queue.
@@ -129,7 +335,28 @@ void pqDestroy(PriorityQueue queue);
 PriorityQueue pqCopy(PriorityQueue queue);
 
 /**
-* pqGetSize: Returns the number of elements in a priority queue
+* pqSetCopyOnWrite: Enables or disables copy on write for future copies of queue.
+* With copy on write, pqCopy does not copy the elements: the queue and its copy share them and
+* read them from the same place until either is changed. The whole content is shared as one piece, so the
+* first change to a queue that still shares copies all of it, like a regular pqCopy would have: that change
+* takes O(n) and calls the copy functions for every element and priority, however small it is. If it is
+* the last one sharing, it takes the content over in O(1) without copying anything. Copy on write therefore
+* pays off when most copies are only read, or when the original is dropped before the copy is changed.
+* Copies inherit the setting. While elements are shared, the elements returned by pqGetFirst, pqGetNext
+* and pqGetByHandle are the same in all sharing queues, and must not be changed in place.
+* Every function that changes a queue may return PQ_OUT_OF_MEMORY when copying what it shared fails,
+* in which case the queue is left unchanged.
+*
+* @param queue - Target priority queue.
+* @param enable - true to share on copy, false to copy every element.
+* @return
+* 	PQ_NULL_ARGUMENT if a NULL was sent as queue
+* 	PQ_SUCCESS otherwise
+*/
+PriorityQueueResult pqSetCopyOnWrite(PriorityQueue queue, bool enable);
+
+/**
+* pqGetSize: Returns the number of elements in a priority queue. Runs in O(1).
 * @param queue - The priority queue which size is requested
 * @return
 * 	-1 if a NULL pointer was sent.
@@ -168,6 +395,97 @@ bool pqContains(PriorityQueue queue, PQElement element);
 */
 PriorityQueueResult pqInsert(PriorityQueue queue, PQElement element, PQElementPriority priority);
 
+/**
+*   pqInsertWithHandle: add a specified element with a specific priority, like pqInsert,
+*   and return a handle to it for use with the *ByHandle functions.
+*   Iterator's value is undefined after this operation.
+*
+* @param queue - The priority queue for which to add the data element
+* @param element - The element which need to be added.
+* @param priority - The new priority to associate with the given element.
+* @param handle - Where to store the handle of the new element, or PQ_INVALID_HANDLE if a full
+* 	bounded queue dropped it. May be NULL.
+* @return
+* 	PQ_NULL_ARGUMENT if a NULL was sent as queue, element or priority
+* 	PQ_OUT_OF_MEMORY if an allocation failed
+* 	PQ_SUCCESS the paired elements had been inserted successfully
+*/
+PriorityQueueResult pqInsertWithHandle(PriorityQueue queue, PQElement element, PQElementPriority priority,
+                                       PQHandle* handle);
+
+/**
+*   pqInsertTake: add element with priority like pqInsert, but the queue adopts the given pointers
+*   instead of copying them. On success the queue owns both and will free them with the free functions
+*   given at initialization, so the caller must not use or free them afterwards.
+*   On failure nothing is adopted and the caller still owns both. A full bounded queue that drops the
+*   element frees both, see pqCreateBounded.
+*   Iterator's value is undefined after this operation.
+*
+* @param queue - The priority queue for which to add the data element
+* @param element - The element to adopt.
+* @param priority - The priority to adopt.
+* @return
+* 	PQ_NULL_ARGUMENT if a NULL was sent as one of the parameters
+* 	PQ_OUT_OF_MEMORY if an allocation failed
+* 	PQ_SUCCESS the paired elements had been adopted successfully
+*/
+PriorityQueueResult pqInsertTake(PriorityQueue queue, PQElement element, PQElementPriority priority);
+
+/**
+*   pqInsertBatch: add copies of elements[i] with priorities[i] for every i below count, in array order,
+*   so ties keep the array order. All of them are copied before any is queued; a batch at least as large
+*   as the queue is merged with one heapify pass in O(n), a smaller one is sifted in in O(count log n).
+*   The copies are split between up to the number of threads set by pqSetBatchThreads.
+*   Either the whole batch is added or nothing is, except in a bounded queue, see pqCreateBounded.
+*   Iterator's value is undefined after this operation.
+*
+* @param queue - The priority queue for which to add the data elements
+* @param elements - Array of count elements to copy into the queue.
+* @param priorities - Array of the count matching priorities.
+* @param count - Number of elements, may be 0.
+* @return
+* 	PQ_NULL_ARGUMENT if a NULL was sent as one of the parameters or array items
+* 	PQ_ERROR if count is negative
+* 	PQ_OUT_OF_MEMORY if an allocation failed
+* 	PQ_SUCCESS the elements had been inserted successfully
+*/
+PriorityQueueResult pqInsertBatch(PriorityQueue queue, PQElement* elements, PQElementPriority* priorities,
+                                  int count);
+
+/**
+*   pqSetBatchThreads: sets the most threads pqInsertBatch may copy a batch with. Each thread gets
+*   at least a few thousand elements, so small batches are always copied by the calling thread.
+*   With more than one thread, the copy and free functions given at initialization must be safe to
+*   call concurrently. The default is 1.
+*
+* @param queue - The priority queue to configure
+* @param threads - The number of threads, at least 1.
+* @return
+* 	PQ_NULL_ARGUMENT if a NULL was sent as queue
+* 	PQ_ERROR if threads is smaller than 1
+* 	PQ_SUCCESS otherwise
+*/
+PriorityQueueResult pqSetBatchThreads(PriorityQueue queue, int threads);
+
+/**
+*   pqMeld: moves every element of source, with its priority, into destination without copying them,
+*   and leaves source empty. Source's elements come after destination's equal-priority elements and
+*   keep their order among themselves. Costs O(n + m) when source is at least as large as destination,
+*   and O(m log n) otherwise, where n and m are the sizes of destination and source.
+*   Handles into destination stay valid; handles into source become stale.
+*   Both queues must have been created with the same functions. On failure both are left unchanged.
+*   The iterators of both queues are undefined after this operation.
+*
+* @param destination - The priority queue that receives the elements
+* @param source - The priority queue the elements are taken from
+* @return
+* 	PQ_NULL_ARGUMENT if a NULL was sent as one of the parameters
+* 	PQ_ERROR if both are the same queue or they were created with different functions
+* 	PQ_OUT_OF_MEMORY if an allocation failed
+* 	PQ_SUCCESS the elements had been moved successfully
+*/
+PriorityQueueResult pqMeld(PriorityQueue destination, PriorityQueue source);
+
 /**
 *	pqChangePriority: Changes a priority of specific element with a specific priority in the priority queue.
 *           If there are multiple same elements with same priority,
@@ -189,6 +507,22 @@ PriorityQueueResult pqInsert(PriorityQueue queue, PQElement element, PQElementPr
 PriorityQueueResult pqChangePriority(PriorityQueue queue, PQElement element,
                                      PQElementPriority old_priority, PQElementPriority new_priority);
 
+/**
+*	pqChangePriorityByHandle: Changes the priority of the element the handle refers to in O(log n),
+*           without searching for it. The element is considered as reinserted element.
+*			Iterator's value is undefined after this operation
+*
+* @param queue - The priority queue the handle belongs to.
+* @param handle - Handle returned by pqInsertWithHandle.
+* @param new_priority - The new priority of the element.
+* @return
+* 	PQ_NULL_ARGUMENT if a NULL was sent as one of the parameters
+* 	PQ_OUT_OF_MEMORY if copying the priority failed
+* 	PQ_ITEM_DOES_NOT_EXIST if the handle's element is no longer in the queue.
+* 	PQ_SUCCESS the priority had been changed successfully
+*/
+PriorityQueueResult pqChangePriorityByHandle(PriorityQueue queue, PQHandle handle, PQElementPriority new_priority);
+
 /**
 *   pqRemove: Removes the highest priority element from the priority queue.
 *   If there are multiple elements with the same highest priority, the first inserted element should be removed first.
@@ -202,6 +536,60 @@ PriorityQueueResult pqChangePriority(PriorityQueue queue, PQElement element,
 */
 PriorityQueueResult pqRemove(PriorityQueue queue);
 
+/**
+*   pqPopTake: Removes the highest priority element from the priority queue, like pqRemove, but hands the
+*   element and its priority over to the caller instead of freeing them. The caller becomes responsible
+*   for freeing both.
+*   Iterator's value is undefined after this operation.
+*
+* @param queue - The priority queue to remove the element from.
+* @param element - Where to store the removed element.
+* @param priority - Where to store the removed element's priority. If NULL, the priority is freed
+* 	by the queue instead.
+* @return
+* 	PQ_NULL_ARGUMENT if a NULL was sent as queue or element.
+* 	PQ_ELEMENT_DOES_NOT_EXISTS if the queue is empty.
+* 	PQ_SUCCESS the most prioritized element had been handed over successfully.
+*/
+PriorityQueueResult pqPopTake(PriorityQueue queue, PQElement* element, PQElementPriority* priority);
+
+/**
+*   pqPopBatch: removes the k highest priority elements, or all of them if the queue holds fewer, and
+*   hands them to the caller in priority order: elements[0] is the element pqRemove would have removed
+*   first. Ownership is transferred like in pqPopTake. Costs O(k log n).
+*   Iterator's value is undefined after this operation.
+*
+* @param queue - The priority queue to remove from
+* @param k - The most elements to remove.
+* @param elements - An array of at least k items that receives the removed elements.
+* @param priorities - An array of at least k items that receives the removed priorities. May be NULL,
+*   in which case the priorities are freed with the queue's free function.
+* @return
+* 	-1 if queue or elements is NULL, k is negative, or an allocation failed
+* 	Otherwise the number of elements removed.
+*/
+int pqPopBatch(PriorityQueue queue, int k, PQElement* elements, PQElementPriority* priorities);
+
+/**
+*   pqDrainWhile: removes elements from the top of the queue for as long as predicate returns true for the
+*   first one and fewer than capacity were removed, and hands them to the caller in priority order.
+*   Ownership is transferred like in pqPopTake. The predicate must not change the queue.
+*   Iterator's value is undefined after this operation.
+*
+* @param queue - The priority queue to remove from
+* @param predicate - Decides whether the current first element is removed, see PQDrainPredicate.
+* @param context - Passed as is to predicate. May be NULL.
+* @param elements - An array of at least capacity items that receives the removed elements.
+* @param priorities - An array of at least capacity items that receives the removed priorities. May be NULL,
+*   in which case the priorities are freed with the queue's free function.
+* @param capacity - The most elements to remove.
+* @return
+* 	-1 if queue, predicate or elements is NULL, capacity is negative, or an allocation failed
+* 	Otherwise the number of elements removed.
+*/
+int pqDrainWhile(PriorityQueue queue, PQDrainPredicate predicate, void* context,
+                 PQElement* elements, PQElementPriority* priorities, int capacity);
+
 /**
 *   pqRemoveElement: Removes the highest priority element from the priority queue which have its value equal to element.
 *   If there are multiple elements with the same highest priority, the first inserted element should be removed first.
@@ -220,6 +608,31 @@ PriorityQueueResult pqRemove(PriorityQueue queue);
 */
 PriorityQueueResult pqRemoveElement(PriorityQueue queue, PQElement element);
 
+/**
+*   pqRemoveByHandle: Removes the element the handle refers to in O(log n) and deallocates it
+*   using the free functions supplied at initialization.
+*   Iterator's value is undefined after this operation.
+*
+* @param queue - The priority queue the handle belongs to.
+* @param handle - Handle returned by pqInsertWithHandle.
+* @return
+* 	PQ_NULL_ARGUMENT if a NULL was sent to the function.
+* 	PQ_ITEM_DOES_NOT_EXIST if the handle's element is no longer in the queue.
+* 	PQ_SUCCESS the element had been removed successfully.
+*/
+PriorityQueueResult pqRemoveByHandle(PriorityQueue queue, PQHandle handle);
+
+/**
+*   pqGetByHandle: Returns the element the handle refers to in O(1). The iterator is not changed.
+*
+* @param queue - The priority queue the handle belongs to.
+* @param handle - Handle returned by pqInsertWithHandle.
+* @return
+* 	NULL if a NULL was sent or the handle's element is no longer in the queue.
+* 	The element otherwise.
+*/
+PQElement pqGetByHandle(PriorityQueue queue, PQHandle handle);
+
 /**
 *	pqGetFirst: Sets the internal iterator (also called current element) to
 *	the first element in the priority queue. The internal order derived from the priorities, and the tie-breaker between
@@ -234,9 +647,22 @@ PriorityQueueResult pqRemoveElement(PriorityQueue queue, PQElement element);
 */
 PQElement pqGetFirst(PriorityQueue queue);
 
+/**
+*	pqGetFirstPriority: Returns the priority of the highest priority element, the one pqGetFirst returns,
+*	without changing the internal iterator. The priority is still owned by the queue.
+*
+* @param queue - The priority queue to look at.
+* @return
+* 	NULL if a NULL pointer was sent or the priority queue is empty.
+* 	The priority of the first element otherwise.
+*/
+PQElementPriority pqGetFirstPriority(PriorityQueue queue);
+
 /**
 *	pqGetNext: Advances the priority queue iterator to the next element and returns it.
 *
+*   It never allocates, so NULL always means that the iteration is over.
+*
 * @param queue - The priority queue for which to advance the iterator
 * @return
 * 	NULL if reached the end of the priority queue, or the iterator is at an invalid state
@@ -252,10 +678,107 @@ PQElement pqGetNext(PriorityQueue queue);
 * 	Target priority queue to remove all element from.
 * @return
 * 	MAP_NULL_ARGUMENT - if a NULL pointer was sent.
+* 	PQ_OUT_OF_MEMORY - if the queue shares its elements with copies, see pqSetCopyOnWrite, and an
+* 		allocation failed.
 * 	MAP_SUCCESS - Otherwise.
 */
 PriorityQueueResult pqClear(PriorityQueue queue);
 
+/**
+* pqShrinkToFit: Releases the pool memory of nodes that are no longer in use, along with unused
+* capacity of the queue's internal arrays, for example after a spike of insertions was removed.
+* Elements, handles and the iterator are not affected.
+*
+* @param queue - Target priority queue.
+* @return
+* 	PQ_NULL_ARGUMENT - if a NULL pointer was sent.
+* 	PQ_SUCCESS - Otherwise.
+*/
+PriorityQueueResult pqShrinkToFit(PriorityQueue queue);
+
+/**
+* pqSave: Writes a snapshot of the queue to a file descriptor, starting at its current offset.
+* The snapshot is a versioned binary format holding the elements in priority order, each as the bytes
+* its serializer gives, followed by a checksum. Writing is buffered and costs O(n) after the queue is
+* sorted, which is free if it was already sorted for iteration. Handles are not saved.
+*
+* @param queue - Target priority queue.
+* @param fd - An open file descriptor to write to.
+* @param serialize_element - Function turning an element into bytes.
+* @param serialize_priority - Function turning a priority into bytes.
+* @return
+* 	PQ_NULL_ARGUMENT - if a NULL pointer was sent.
+* 	PQ_OUT_OF_MEMORY - if an allocation failed.
+* 	PQ_ERROR - if a serializer failed or writing to fd failed. Part of the snapshot may have been written.
+* 	PQ_SUCCESS - Otherwise.
+*/
+PriorityQueueResult pqSave(PriorityQueue queue, int fd, SerializePQElement serialize_element,
+                           SerializePQElementPriority serialize_priority);
+
+/**
+* pqLoad: Allocates a new priority queue holding the elements of a snapshot written by pqSave, read
+* from a file descriptor at its current offset. Since the snapshot is already in priority order, the
+* elements are placed as they come in O(n), without comparing priorities. For the same reason
+* compare_priorities must order priorities like the function of the queue that was saved.
+* Elements of equal priority keep their order. The file is read in large blocks, so it may be read
+* past the end of the snapshot.
+*
+* @param fd - An open file descriptor to read from.
+* @param deserialize_element - Function rebuilding an element from its bytes.
+* @param deserialize_priority - Function rebuilding a priority from its bytes.
+* 	The other parameters are the same as in pqCreate.
+* @return
+* 	NULL - if one of the parameters is NULL, an allocation or a deserializer failed, reading failed,
+* 		or the snapshot is of another version, truncated or does not match its checksum.
+* 	A new priority queue in case of success.
+*/
+PriorityQueue pqLoad(int fd,
+                     DeserializePQElement deserialize_element,
+                     DeserializePQElementPriority deserialize_priority,
+                     CopyPQElement copy_element,
+                     FreePQElement free_element,
+                     EqualPQElements equal_elements,
+                     CopyPQElementPriority copy_priority,
+                     FreePQElementPriority free_priority,
+                     ComparePQElementPriorities compare_priorities);
+
+/**
+* pqEnableStats: Starts or stops collecting statistics for the priority queue.
+* Collection is off by default and costs nothing while off. Stopping discards what was collected.
+* Copies of the priority queue start with collection off.
+*
+* @param queue - Target priority queue.
+* @param enable - true to start collecting, false to stop.
+* @return
+* 	PQ_NULL_ARGUMENT if a NULL was sent.
+* 	PQ_OUT_OF_MEMORY if an allocation failed.
+* 	PQ_SUCCESS otherwise.
+*/
+PriorityQueueResult pqEnableStats(PriorityQueue queue, bool enable);
+
+/**
+* pqGetStats: Copies the statistics collected by the priority queue into stats.
+*
+* @param queue - Target priority queue.
+* @param stats - Where to store the statistics.
+* @return
+* 	PQ_NULL_ARGUMENT if a NULL was sent as one of the parameters.
+* 	PQ_ERROR if collection is not enabled for the queue.
+* 	PQ_SUCCESS otherwise.
+*/
+PriorityQueueResult pqGetStats(PriorityQueue queue, PQStats* stats);
+
+/**
+* pqResetStats: Zeroes the statistics collected by the priority queue, collection stays on.
+*
+* @param queue - Target priority queue.
+* @return
+* 	PQ_NULL_ARGUMENT if a NULL was sent.
+* 	PQ_ERROR if collection is not enabled for the queue.
+* 	PQ_SUCCESS otherwise.
+*/
+PriorityQueueResult pqResetStats(PriorityQueue queue);
+
 /*!
 * Macro for iterating over a priority queue.
 * Declares a new iterator for the loop.
@@ -265,4 +788,51 @@ PriorityQueueResult pqClear(PriorityQueue queue);
         iterator ;\
         iterator = pqGetNext(queue))
 
+/**
+* pqCursorOpen: Opens a cursor over the elements of the queue, in the same order as pqGetFirst and
+* pqGetNext. Cursors do not use or change the queue's internal iterator, so any number of them may
+* be open at once, nested, or used from different threads while nobody changes the queue.
+* Opening costs O(1) and each step costs O(log k) after k steps.
+* A cursor ends when the queue is changed through any function that may change it.
+*
+* @param queue - The priority queue to iterate over.
+* @return
+* 	NULL if a NULL was sent or a memory allocation failed.
+* 	A new cursor otherwise, to be closed with pqCursorClose.
+*/
+PQCursor pqCursorOpen(PriorityQueue queue);
+
+/**
+* pqCursorNext: Advances the cursor and returns the element it reaches. The first call returns the
+* highest priority element.
+*
+* @param cursor - The cursor to advance.
+* @return
+* 	NULL if a NULL was sent, the cursor reached the end, the queue was changed since the cursor was
+* 	opened, or a memory allocation failed.
+* 	The next element otherwise.
+*/
+PQElement pqCursorNext(PQCursor cursor);
+
+/**
+* pqCursorClose: Deallocates a cursor. The queue is not affected.
+*
+* @param cursor - The cursor to close. If NULL nothing will be done.
+*/
+void pqCursorClose(PQCursor cursor);
+
+/*!
+* Macro for iterating over a priority queue with a cursor, which is opened before the loop and closed
+* after it, including when the loop is left with break. Leaving it with return or goto leaks the cursor.
+* Declares a new iterator and a new cursor for the loop. If the cursor cannot be opened the loop
+* does not run.
+*/
+#define PQ_FOREACH_CURSOR(type, iterator, cursor, queue) \
+    for(PQCursor cursor = pqCursorOpen(queue) ; \
+        cursor ; \
+        pqCursorClose(cursor), cursor = NULL) \
+        for(type iterator = (type) pqCursorNext(cursor) ; \
+            iterator ; \
+            iterator = pqCursorNext(cursor))
+
 #endif /* PRIORITY_QUEUE_H_ */
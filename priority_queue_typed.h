@@ -0,0 +1,386 @@
+#ifndef PRIORITY_QUEUE_TYPED_H
+#define PRIORITY_QUEUE_TYPED_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include "priority_queue.h"
+
+/**
+* Type-Specialized Priority Queue Generator
+*
+* PQ_DEFINE(name, ElemT, PrioT, compare_expression, equal_expression) generates a priority queue type
+* called name that stores elements of type ElemT with priorities of type PrioT by value, together with
+* static inline functions for every operation of the generic priority queue. Comparisons are plain
+* expressions instead of callbacks, so the compiler can inline them into the heap operations.
+*
+*   compare_expression - an int expression of the priorities a and b (both PrioT), with the same
+*                        meaning as ComparePQElementPriorities: positive if a is greater.
+*   equal_expression   - a bool expression of the elements x and y (both ElemT), true if they're equal.
+*
+* Nothing is copied or freed through callbacks: elements and priorities are assigned as values, so
+* pointer types are stored as is and remain owned by the caller.
+*
+* For example, a queue of ints keyed by int, where the lower key comes first:
+*   PQ_DEFINE(IntQueue, int, int, b - a, x == y)
+*
+* The following functions are generated, where name is the given name:
+*   nameCreate          - Creates a new empty priority queue, NULL if an allocation failed
+*   nameDestroy         - Deletes an existing priority queue
+*   nameCopy            - Copies an existing priority queue
+*   nameGetSize         - Returns the size of a given priority queue
+*   nameContains        - returns whether or not an element exists inside the priority queue.
+*   nameInsert          - Inserts an element with a given priority to the queue.
+*   nameChangePriority  - Changes priority of an element with specific priority
+*   nameRemove          - Removes the highest priority element in the queue
+*   namePop             - Removes the highest priority element in the queue and returns it by value
+*   nameRemoveElement   - Removes the highest priority element in the queue equal to element
+*   nameGetFirst        - Sets the internal iterator to the first element in the queue and returns a pointer to it
+*   nameGetNext         - Advances the internal iterator to the next element and returns a pointer to it.
+*   nameClear           - Clears the contents of the priority queue.
+* They behave like the generic functions of the same name, including the insertion order tie-breaker and
+* the iterator being undefined after changes, and return the same PriorityQueueResult codes.
+* Pointers returned by the iteration functions are valid until the queue is changed.
+*/
+
+/*!
+* Macro for iterating over a generated priority queue.
+* Declares a new iterator, a pointer to the current element, for the loop.
+*/
+#define PQ_TYPED_FOREACH(name, type, iterator, queue) \
+    for(type* iterator = name##GetFirst(queue) ; \
+        iterator ;\
+        iterator = name##GetNext(queue))
+
+#define PQ_TYPED_INITIAL_CAPACITY 8
+#define PQ_TYPED_EXPAND_FACTOR 2
+#define PQ_TYPED_NO_ITERATOR -1
+
+#define PQ_DEFINE(name, ElemT, PrioT, compare_expression, equal_expression) \
+\
+typedef struct name##Entry_t { \
+    ElemT element; \
+    PrioT priority; \
+    unsigned long long insertion_order; \
+} name##Entry; \
+\
+typedef struct name##_t { \
+    name##Entry* heap; \
+    int size; \
+    int capacity; \
+    unsigned long long next_insertion_order; \
+    /* heap positions sorted by priority, built on demand for iteration */ \
+    int* order; \
+    bool order_valid; \
+    int iterator; \
+} *name; \
+\
+static inline int name##ComparePriorities(PrioT a, PrioT b){ \
+    return (compare_expression); \
+} \
+\
+static inline bool name##EqualElements(ElemT x, ElemT y){ \
+    return (equal_expression); \
+} \
+\
+static inline bool name##EntryComesBefore(const name##Entry* first, const name##Entry* second){ \
+    int compare = name##ComparePriorities(first->priority, second->priority); \
+    if(compare != 0){ \
+        return compare > 0; \
+    } \
+    return first->insertion_order < second->insertion_order; \
+} \
+\
+static inline name name##Create(void){ \
+    name queue = malloc(sizeof(*queue)); \
+    if(queue == NULL){ \
+        return NULL; \
+    } \
+    queue->heap = malloc(sizeof(*queue->heap) * PQ_TYPED_INITIAL_CAPACITY); \
+    if(queue->heap == NULL){ \
+        free(queue); \
+        return NULL; \
+    } \
+    queue->size = 0; \
+    queue->capacity = PQ_TYPED_INITIAL_CAPACITY; \
+    queue->next_insertion_order = 0; \
+    queue->order = NULL; \
+    queue->order_valid = false; \
+    queue->iterator = PQ_TYPED_NO_ITERATOR; \
+    return queue; \
+} \
+\
+static inline void name##Destroy(name queue){ \
+    if(queue == NULL){ \
+        return; \
+    } \
+    free(queue->heap); \
+    free(queue->order); \
+    free(queue); \
+} \
+\
+static inline void name##InvalidateIteration(name queue){ \
+    queue->iterator = PQ_TYPED_NO_ITERATOR; \
+    queue->order_valid = false; \
+} \
+\
+static inline name name##Copy(name queue){ \
+    if(queue == NULL){ \
+        return NULL; \
+    } \
+    queue->iterator = PQ_TYPED_NO_ITERATOR; \
+    name queue_copy = name##Create(); \
+    if(queue_copy == NULL){ \
+        return NULL; \
+    } \
+    name##Entry* heap_copy = realloc(queue_copy->heap, sizeof(*heap_copy) * queue->capacity); \
+    if(heap_copy == NULL){ \
+        name##Destroy(queue_copy); \
+        return NULL; \
+    } \
+    queue_copy->heap = heap_copy; \
+    queue_copy->capacity = queue->capacity; \
+    for(int i = 0; i < queue->size; i++){ \
+        queue_copy->heap[i] = queue->heap[i]; \
+    } \
+    queue_copy->size = queue->size; \
+    queue_copy->next_insertion_order = queue->next_insertion_order; \
+    return queue_copy; \
+} \
+\
+static inline int name##GetSize(name queue){ \
+    return queue == NULL ? -1 : queue->size; \
+} \
+\
+static inline void name##SiftUp(name queue, int index){ \
+    name##Entry moving = queue->heap[index]; \
+    while(index > 0){ \
+        int parent = (index - 1) / 2; \
+        if(!name##EntryComesBefore(&moving, &queue->heap[parent])){ \
+            break; \
+        } \
+        queue->heap[index] = queue->heap[parent]; \
+        index = parent; \
+    } \
+    queue->heap[index] = moving; \
+} \
+\
+static inline void name##SiftDown(name queue, int index){ \
+    name##Entry moving = queue->heap[index]; \
+    while(true){ \
+        int best = 2 * index + 1; \
+        if(best >= queue->size){ \
+            break; \
+        } \
+        if(best + 1 < queue->size && name##EntryComesBefore(&queue->heap[best + 1], &queue->heap[best])){ \
+            best++; \
+        } \
+        if(!name##EntryComesBefore(&queue->heap[best], &moving)){ \
+            break; \
+        } \
+        queue->heap[index] = queue->heap[best]; \
+        index = best; \
+    } \
+    queue->heap[index] = moving; \
+} \
+\
+static inline void name##RemoveAt(name queue, int index){ \
+    queue->size--; \
+    if(index != queue->size){ \
+        queue->heap[index] = queue->heap[queue->size]; \
+        name##SiftUp(queue, index); \
+        name##SiftDown(queue, index); \
+    } \
+} \
+\
+/* returns the position of the first entry in queue order whose element equals element, and whose \
+   priority equals *priority if one is given, or -1 */ \
+static inline int name##FindFirstMatch(name queue, ElemT element, const PrioT* priority){ \
+    int found = -1; \
+    for(int i = 0; i < queue->size; i++){ \
+        if(!name##EqualElements(queue->heap[i].element, element)){ \
+            continue; \
+        } \
+        if(priority != NULL && name##ComparePriorities(queue->heap[i].priority, *priority) != 0){ \
+            continue; \
+        } \
+        if(found == -1 || name##EntryComesBefore(&queue->heap[i], &queue->heap[found])){ \
+            found = i; \
+        } \
+    } \
+    return found; \
+} \
+\
+static inline bool name##Contains(name queue, ElemT element){ \
+    if(queue == NULL){ \
+        return false; \
+    } \
+    for(int i = 0; i < queue->size; i++){ \
+        if(name##EqualElements(queue->heap[i].element, element)){ \
+            return true; \
+        } \
+    } \
+    return false; \
+} \
+\
+static inline PriorityQueueResult name##Insert(name queue, ElemT element, PrioT priority){ \
+    if(queue == NULL){ \
+        return PQ_NULL_ARGUMENT; \
+    } \
+    name##InvalidateIteration(queue); \
+    if(queue->size == queue->capacity){ \
+        int new_capacity = queue->capacity * PQ_TYPED_EXPAND_FACTOR; \
+        name##Entry* new_heap = realloc(queue->heap, sizeof(*new_heap) * new_capacity); \
+        if(new_heap == NULL){ \
+            return PQ_OUT_OF_MEMORY; \
+        } \
+        queue->heap = new_heap; \
+        queue->capacity = new_capacity; \
+    } \
+    queue->heap[queue->size].element = element; \
+    queue->heap[queue->size].priority = priority; \
+    queue->heap[queue->size].insertion_order = queue->next_insertion_order; \
+    queue->next_insertion_order++; \
+    queue->size++; \
+    name##SiftUp(queue, queue->size - 1); \
+    return PQ_SUCCESS; \
+} \
+\
+static inline PriorityQueueResult name##ChangePriority(name queue, ElemT element, \
+                                                       PrioT old_priority, PrioT new_priority){ \
+    if(queue == NULL){ \
+        return PQ_NULL_ARGUMENT; \
+    } \
+    name##InvalidateIteration(queue); \
+    int index = name##FindFirstMatch(queue, element, &old_priority); \
+    if(index == -1){ \
+        return PQ_ELEMENT_DOES_NOT_EXISTS; \
+    } \
+    queue->heap[index].priority = new_priority; \
+    queue->heap[index].insertion_order = queue->next_insertion_order; \
+    queue->next_insertion_order++; \
+    name##SiftUp(queue, index); \
+    name##SiftDown(queue, index); \
+    return PQ_SUCCESS; \
+} \
+\
+static inline PriorityQueueResult name##Remove(name queue){ \
+    if(queue == NULL){ \
+        return PQ_NULL_ARGUMENT; \
+    } \
+    name##InvalidateIteration(queue); \
+    if(queue->size > 0){ \
+        name##RemoveAt(queue, 0); \
+    } \
+    return PQ_SUCCESS; \
+} \
+\
+static inline PriorityQueueResult name##Pop(name queue, ElemT* element, PrioT* priority){ \
+    if(queue == NULL || element == NULL){ \
+        return PQ_NULL_ARGUMENT; \
+    } \
+    name##InvalidateIteration(queue); \
+    if(queue->size == 0){ \
+        return PQ_ELEMENT_DOES_NOT_EXISTS; \
+    } \
+    *element = queue->heap[0].element; \
+    if(priority != NULL){ \
+        *priority = queue->heap[0].priority; \
+    } \
+    name##RemoveAt(queue, 0); \
+    return PQ_SUCCESS; \
+} \
+\
+static inline PriorityQueueResult name##RemoveElement(name queue, ElemT element){ \
+    if(queue == NULL){ \
+        return PQ_NULL_ARGUMENT; \
+    } \
+    name##InvalidateIteration(queue); \
+    int index = name##FindFirstMatch(queue, element, NULL); \
+    if(index == -1){ \
+        return PQ_ELEMENT_DOES_NOT_EXISTS; \
+    } \
+    name##RemoveAt(queue, index); \
+    return PQ_SUCCESS; \
+} \
+\
+/* sorts the heap positions with a merge sort, keeping the priority order for iteration */ \
+static inline bool name##BuildIterationOrder(name queue){ \
+    if(queue->order_valid){ \
+        return true; \
+    } \
+    int* order = realloc(queue->order, sizeof(*order) * queue->capacity * 2); \
+    if(order == NULL){ \
+        return false; \
+    } \
+    queue->order = order; \
+    int* source = order; \
+    int* target = order + queue->capacity; \
+    for(int i = 0; i < queue->size; i++){ \
+        source[i] = i; \
+    } \
+    for(int width = 1; width < queue->size; width *= 2){ \
+        for(int low = 0; low < queue->size; low += 2 * width){ \
+            int middle = low + width < queue->size ? low + width : queue->size; \
+            int high = low + 2 * width < queue->size ? low + 2 * width : queue->size; \
+            int left = low, right = middle, out = low; \
+            while(left < middle && right < high){ \
+                if(name##EntryComesBefore(&queue->heap[source[right]], &queue->heap[source[left]])){ \
+                    target[out++] = source[right++]; \
+                }else{ \
+                    target[out++] = source[left++]; \
+                } \
+            } \
+            while(left < middle){ \
+                target[out++] = source[left++]; \
+            } \
+            while(right < high){ \
+                target[out++] = source[right++]; \
+            } \
+        } \
+        int* tmp = source; \
+        source = target; \
+        target = tmp; \
+    } \
+    if(source != order){ \
+        for(int i = 0; i < queue->size; i++){ \
+            order[i] = source[i]; \
+        } \
+    } \
+    queue->order_valid = true; \
+    return true; \
+} \
+\
+static inline ElemT* name##GetFirst(name queue){ \
+    if(queue == NULL || queue->size == 0){ \
+        return NULL; \
+    } \
+    queue->iterator = 0; \
+    return &queue->heap[0].element; \
+} \
+\
+static inline ElemT* name##GetNext(name queue){ \
+    if(queue == NULL || queue->iterator == PQ_TYPED_NO_ITERATOR){ \
+        return NULL; \
+    } \
+    if(!name##BuildIterationOrder(queue)){ \
+        queue->iterator = PQ_TYPED_NO_ITERATOR; \
+        return NULL; \
+    } \
+    queue->iterator++; \
+    if(queue->iterator >= queue->size){ \
+        queue->iterator = PQ_TYPED_NO_ITERATOR; \
+        return NULL; \
+    } \
+    return &queue->heap[queue->order[queue->iterator]].element; \
+} \
+\
+static inline PriorityQueueResult name##Clear(name queue){ \
+    if(queue == NULL){ \
+        return PQ_NULL_ARGUMENT; \
+    } \
+    name##InvalidateIteration(queue); \
+    queue->size = 0; \
+    return PQ_SUCCESS; \
+}
+
+#endif /* PRIORITY_QUEUE_TYPED_H */
@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include "string_table.h"
+
+#define INITIAL_BUCKETS 64
+#define EXPAND_FACTOR 2
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+
+/* an interned string is allocated together with its entry, so its entry is found from its address */
+typedef struct interned_t {
+    struct interned_t* next_in_bucket;
+    StringTable table;
+    unsigned int hash;
+    int references;
+    char characters[];
+} *Interned;
+
+/* a destroyed table lives on while strings interned in it do */
+struct StringTable_t {
+    Interned* buckets;
+    int bucket_count;
+    int string_count;
+    bool destroyed;
+};
+
+/*=========================================================================*/
+
+static unsigned int hashOf(const char* string){
+    unsigned int hash = FNV_OFFSET_BASIS;
+    for(const unsigned char* character = (const unsigned char*)string; *character != '\0'; character++){
+        hash = (hash ^ *character) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static Interned entryOf(const char* interned){
+    return (Interned)(void*)((char*)interned - offsetof(struct interned_t, characters));
+}
+
+static Interned* bucketOf(StringTable table, unsigned int hash){
+    return &table->buckets[hash & (unsigned int)(table->bucket_count - 1)];
+}
+
+/* returns the entry of string, NULL if it is not in the table */
+static Interned findEntry(StringTable table, const char* string, unsigned int hash){
+    if(table->bucket_count == 0){
+        return NULL;
+    }
+    for(Interned entry = *bucketOf(table, hash); entry != NULL; entry = entry->next_in_bucket){
+        if(entry->hash == hash && strcmp(entry->characters, string) == 0){
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* keeps at most one string per bucket on average. failing to grow only makes the buckets longer */
+static void growBuckets(StringTable table){
+    if(table->string_count < table->bucket_count){
+        return;
+    }
+    int new_count = table->bucket_count > 0 ? table->bucket_count * EXPAND_FACTOR : INITIAL_BUCKETS;
+    Interned* new_buckets = calloc(new_count, sizeof(*new_buckets));
+    if(new_buckets == NULL){
+        return;
+    }
+    Interned* old_buckets = table->buckets;
+    int old_count = table->bucket_count;
+    table->buckets = new_buckets;
+    table->bucket_count = new_count;
+    for(int i = 0; i < old_count; i++){
+        Interned entry = old_buckets[i];
+        while(entry != NULL){
+            Interned next = entry->next_in_bucket;
+            Interned* bucket = bucketOf(table, entry->hash);
+            entry->next_in_bucket = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
+    free(old_buckets);
+}
+
+static void freeTable(StringTable table){
+    free(table->buckets);
+    free(table);
+}
+
+StringTable stringTableCreate(void){
+    StringTable table = malloc(sizeof(*table));
+    if(table == NULL){
+        return NULL;
+    }
+    table->buckets = NULL;
+    table->bucket_count = 0;
+    table->string_count = 0;
+    table->destroyed = false;
+    return table;
+}
+
+void stringTableDestroy(StringTable table){
+    if(table == NULL){
+        return;
+    }
+    table->destroyed = true;
+    if(table->string_count == 0){
+        freeTable(table);
+    }
+}
+
+const char* stringIntern(StringTable table, const char* string){
+    if(table == NULL || string == NULL){
+        return NULL;
+    }
+    unsigned int hash = hashOf(string);
+    Interned entry = findEntry(table, string, hash);
+    if(entry == NULL){
+        growBuckets(table);
+        size_t length = strlen(string);
+        entry = table->bucket_count == 0 ? NULL : malloc(sizeof(*entry) + length + 1);
+        if(entry == NULL){
+            return NULL;
+        }
+        memcpy(entry->characters, string, length + 1);
+        entry->table = table;
+        entry->hash = hash;
+        entry->references = 0;
+        Interned* bucket = bucketOf(table, hash);
+        entry->next_in_bucket = *bucket;
+        *bucket = entry;
+        table->string_count++;
+    }
+    entry->references++;
+    return entry->characters;
+}
+
+const char* stringFind(StringTable table, const char* string){
+    if(table == NULL || string == NULL){
+        return NULL;
+    }
+    Interned entry = findEntry(table, string, hashOf(string));
+    return entry == NULL ? NULL : entry->characters;
+}
+
+const char* stringRetain(const char* interned){
+    if(interned == NULL){
+        return NULL;
+    }
+    entryOf(interned)->references++;
+    return interned;
+}
+
+void stringRelease(const char* interned){
+    if(interned == NULL){
+        return;
+    }
+    Interned entry = entryOf(interned);
+    entry->references--;
+    if(entry->references > 0){
+        return;
+    }
+    StringTable table = entry->table;
+    Interned* link = bucketOf(table, entry->hash);
+    while(*link != entry){
+        link = &(*link)->next_in_bucket;
+    }
+    *link = entry->next_in_bucket;
+    free(entry);
+    table->string_count--;
+    if(table->string_count > 0){
+        return;
+    }
+    //an empty table gives its buckets back, and a destroyed one is freed:
+    if(table->destroyed){
+        freeTable(table);
+        return;
+    }
+    free(table->buckets);
+    table->buckets = NULL;
+    table->bucket_count = 0;
+}
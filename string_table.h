@@ -0,0 +1,54 @@
+#ifndef STRING_TABLE_H
+#define STRING_TABLE_H
+
+/**
+* String Table
+*
+* Interns strings: every distinct string is stored once in a table, and whoever interns it there gets
+* the same pointer. Two strings interned in the same table are equal exactly when their pointers are,
+* so they can be compared and hashed by address. Each interned string counts its references, and is
+* freed when the last one is released.
+* A table and the strings interned in it are not locked, so they may only be used by one thread at a
+* time. Interned strings must not be changed.
+*
+* The following functions are available:
+*   stringTableCreate   - Creates a new empty string table
+*   stringTableDestroy  - Deletes a string table once its strings are released
+*   stringIntern        - Returns the interned copy of a string and takes a reference to it
+*   stringFind          - Returns the interned copy of a string if there is one, without taking a reference
+*   stringRetain        - Takes another reference to an interned string
+*   stringRelease       - Releases a reference to an interned string
+*/
+
+typedef struct StringTable_t *StringTable;
+
+
+/* this function creates a new empty string table. returns NULL if an allocation failed */
+StringTable stringTableCreate(void);
+
+
+/* this function deletes the table. strings interned in it that still have references stay valid, and
+   the table is freed with the last of them. does nothing if NULL was sent */
+void stringTableDestroy(StringTable table);
+
+
+/* this function returns the interned copy of string in table, adding it if it is not there, and
+   takes a reference to it. returns NULL if NULL was sent or an allocation failed */
+const char* stringIntern(StringTable table, const char* string);
+
+
+/* this function returns the interned copy of string in table without taking a reference, or NULL if it
+   is not there or NULL was sent. the result is only valid until the string's last reference is
+   released, so it should be compared with other interned strings right away and not kept */
+const char* stringFind(StringTable table, const char* string);
+
+
+/* this function takes another reference to an interned string, in O(1), and returns it */
+const char* stringRetain(const char* interned);
+
+
+/* this function releases a reference to an interned string, freeing it if it was the last one.
+   does nothing if NULL was sent */
+void stringRelease(const char* interned);
+
+#endif //STRING_TABLE_H
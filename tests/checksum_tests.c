@@ -0,0 +1,31 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "test_utilities.h"
+#include "../checksum.h"
+
+static bool testKnownValues(void){
+    ASSERT_TEST(checksumUpdate(CHECKSUM_EMPTY, "", 0) == CHECKSUM_EMPTY);
+    ASSERT_TEST(checksumUpdate(CHECKSUM_EMPTY, "123456789", 9) == 0xCBF43926U);
+    ASSERT_TEST(checksumUpdate(CHECKSUM_EMPTY, "a", 1) == 0xE8B7BE43U);
+    return true;
+}
+
+static bool testInPieces(void){
+    const char* text = "The quick brown fox jumps over the lazy dog";
+    int size = (int)strlen(text);
+    uint32_t whole = checksumUpdate(CHECKSUM_EMPTY, text, size);
+    ASSERT_TEST(whole == 0x414FA339U);
+    for(int split = 0; split <= size; split++){
+        uint32_t first = checksumUpdate(CHECKSUM_EMPTY, text, split);
+        ASSERT_TEST(checksumUpdate(first, text + split, size - split) == whole);
+    }
+    return true;
+}
+
+int main(void){
+    int failed = 0;
+    RUN_TEST(testKnownValues, failed);
+    RUN_TEST(testInPieces, failed);
+    return TEST_EXIT_STATUS(failed);
+}
@@ -0,0 +1,71 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "test_utilities.h"
+#include "../date.h"
+
+/* whether date is day.month.year */
+static bool dateIs(Date date, int day, int month, int year){
+    int got_day, got_month, got_year;
+    return dateGet(date, &got_day, &got_month, &got_year) &&
+           got_day == day && got_month == month && got_year == year;
+}
+
+static bool testCreateAndSerials(void){
+    ASSERT_TEST(dateCreate(0, 1, 2020) == NULL);
+    ASSERT_TEST(dateCreate(31, 1, 2020) == NULL);
+    ASSERT_TEST(dateCreate(1, 13, 2020) == NULL);
+    ASSERT_TEST(dateCreate(1, 1, DATE_MAX_YEAR + 1) == NULL);
+    Date date = dateCreate(30, 12, 2020);
+    ASSERT_TEST(date != NULL);
+    Date same = dateCreateFromSerial(dateGetSerial(date));
+    ASSERT_TEST(same != NULL && dateCompare(date, same) == 0 && dateIs(same, 30, 12, 2020));
+    ASSERT_TEST(dateCreateFromSerial(DATE_SERIAL_MAX + 1) == NULL);
+    int day, month, year;
+    ASSERT_TEST(dateSerialGet(DATE_SERIAL_MIN, &day, &month, &year));
+    ASSERT_TEST(day == 1 && month == 1 && year == DATE_MIN_YEAR);
+    dateDestroy(date);
+    dateDestroy(same);
+    return true;
+}
+
+static bool testAddDays(void){
+    Date date = dateCreate(30, 12, 2020);
+    ASSERT_TEST(date != NULL);
+    dateTick(date);
+    ASSERT_TEST(dateIs(date, 1, 1, 2021));
+    Date later = dateCopy(date);
+    ASSERT_TEST(later != NULL);
+    dateAddDays(later, 365);
+    ASSERT_TEST(dateIs(later, 6, 1, 2022));
+    ASSERT_TEST(dateDiffDays(later, date) == 365);
+    ASSERT_TEST(dateCompare(later, date) > 0 && dateCompare(date, later) < 0);
+    dateAddDays(later, -365);
+    ASSERT_TEST(dateCompare(later, date) == 0);
+    dateDestroy(date);
+    dateDestroy(later);
+    return true;
+}
+
+static bool testAddDaysStopsAtTheLimits(void){
+    Date last = dateCreate(30, 12, DATE_MAX_YEAR);
+    ASSERT_TEST(last != NULL && dateGetSerial(last) == DATE_SERIAL_MAX);
+    dateTick(last);
+    ASSERT_TEST(dateGetSerial(last) == DATE_SERIAL_MAX);
+    dateAddDays(last, 1000);
+    ASSERT_TEST(dateIs(last, 30, 12, DATE_MAX_YEAR));
+    Date first = dateCreateFromSerial(DATE_SERIAL_MIN + 1);
+    ASSERT_TEST(first != NULL);
+    dateAddDays(first, -1000);
+    ASSERT_TEST(dateGetSerial(first) == DATE_SERIAL_MIN);
+    dateDestroy(last);
+    dateDestroy(first);
+    return true;
+}
+
+int main(void){
+    int failed = 0;
+    RUN_TEST(testCreateAndSerials, failed);
+    RUN_TEST(testAddDays, failed);
+    RUN_TEST(testAddDaysStopsAtTheLimits, failed);
+    return TEST_EXIT_STATUS(failed);
+}
@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "test_utilities.h"
+#include "../event_calendar.h"
+
+#define MAX_NAME_LENGTH 16
+
+/* adds an event called "e<id>" on date to calendar */
+static CalendarResult insertEvent(EventCalendar calendar, StringTable names, int id, DateSerial date){
+    char name[MAX_NAME_LENGTH];
+    sprintf(name, "e%d", id);
+    Event event = eventCreate(id, name, date, names);
+    if(event == NULL){
+        return CALENDAR_OUT_OF_MEMORY;
+    }
+    CalendarResult result = calendarInsert(calendar, event);
+    if(result != CALENDAR_SUCCESS){
+        eventDestroy(event);
+    }
+    return result;
+}
+
+/* whether iterating over calendar gives exactly the count event ids of expected, in order */
+static bool iteratesAs(EventCalendar calendar, const int* expected, int count){
+    int i = 0;
+    CALENDAR_FOREACH(event, calendar){
+        if(i == count || eventGetId(event) != expected[i]){
+            return false;
+        }
+        i++;
+    }
+    return i == count;
+}
+
+static void countRemoved(Event event, void* removed){
+    (*(int*)removed)++;
+}
+
+static bool testInsertAndFind(void){
+    StringTable names = stringTableCreate();
+    EventCalendar calendar = calendarCreate();
+    ASSERT_TEST(names != NULL && calendar != NULL);
+    ASSERT_TEST(insertEvent(calendar, names, 1, 100) == CALENDAR_SUCCESS);
+    ASSERT_TEST(insertEvent(calendar, names, 2, 50) == CALENDAR_SUCCESS);
+    ASSERT_TEST(insertEvent(calendar, names, 3, 100) == CALENDAR_SUCCESS);
+    ASSERT_TEST(insertEvent(calendar, names, 4, -20) == CALENDAR_SUCCESS);
+    ASSERT_TEST(insertEvent(calendar, names, 1, 7) == CALENDAR_EVENT_ID_ALREADY_EXISTS);
+    ASSERT_TEST(calendarInsert(calendar, NULL) == CALENDAR_NULL_ARGUMENT);
+    ASSERT_TEST(calendarGetSize(calendar) == 4 && calendarGetSize(NULL) == -1);
+    //events on the same date keep the order they were added in:
+    ASSERT_TEST(iteratesAs(calendar, (int[]){4, 2, 1, 3}, 4));
+    ASSERT_TEST(eventGetDate(calendarFind(calendar, 3)) == 100);
+    ASSERT_TEST(calendarFind(calendar, 5) == NULL);
+    ASSERT_TEST(eventGetId(calendarFindByName(calendar, stringFind(names, "e3"), 100)) == 3);
+    ASSERT_TEST(calendarFindByName(calendar, stringFind(names, "e3"), 50) == NULL);
+    ASSERT_TEST(calendarFindByName(calendar, stringFind(names, "e5"), 100) == NULL);
+    calendarDestroy(calendar);
+    stringTableDestroy(names);
+    return true;
+}
+
+static bool testChangeDateAndRemove(void){
+    StringTable names = stringTableCreate();
+    EventCalendar calendar = calendarCreate();
+    ASSERT_TEST(names != NULL && calendar != NULL);
+    for(int i = 0; i < 4; i++){
+        ASSERT_TEST(insertEvent(calendar, names, i, 10 * (i % 2)) == CALENDAR_SUCCESS);
+    }
+    //a moved event goes after the events already on its new date:
+    ASSERT_TEST(calendarChangeDate(calendar, 0, 10) == CALENDAR_SUCCESS);
+    ASSERT_TEST(iteratesAs(calendar, (int[]){2, 1, 3, 0}, 4));
+    ASSERT_TEST(calendarFindByName(calendar, stringFind(names, "e0"), 10) == calendarFind(calendar, 0));
+    ASSERT_TEST(calendarChangeDate(calendar, 9, 10) == CALENDAR_EVENT_NOT_EXISTS);
+    ASSERT_TEST(calendarRemove(calendar, 1) == CALENDAR_SUCCESS);
+    ASSERT_TEST(calendarRemove(calendar, 1) == CALENDAR_EVENT_NOT_EXISTS);
+    ASSERT_TEST(calendarFind(calendar, 1) == NULL && stringFind(names, "e1") == NULL);
+    Event first = calendarPopFirst(calendar);
+    ASSERT_TEST(eventGetId(first) == 2 && calendarFind(calendar, 2) == NULL);
+    eventDestroy(first);
+    ASSERT_TEST(iteratesAs(calendar, (int[]){3, 0}, 2));
+    calendarDestroy(calendar);
+    stringTableDestroy(names);
+    return true;
+}
+
+static bool testRemoveBefore(void){
+    StringTable names = stringTableCreate();
+    EventCalendar calendar = calendarCreate();
+    ASSERT_TEST(names != NULL && calendar != NULL);
+    //more events than the calendar starts with buckets for, spread over more days than it has:
+    for(int i = 0; i < 1000; i++){
+        ASSERT_TEST(insertEvent(calendar, names, i, (i * 7919) % 5000) == CALENDAR_SUCCESS);
+    }
+    int removed = 0;
+    ASSERT_TEST(calendarRemoveBefore(calendar, 2500, countRemoved, &removed) == removed);
+    ASSERT_TEST(calendarGetSize(calendar) == 1000 - removed);
+    DateSerial previous = 2500;
+    int remaining = 0;
+    CALENDAR_FOREACH(event, calendar){
+        ASSERT_TEST(eventGetDate(event) >= previous);
+        previous = eventGetDate(event);
+        remaining++;
+    }
+    ASSERT_TEST(remaining == 1000 - removed);
+    ASSERT_TEST(calendarRemoveBefore(calendar, DATE_SERIAL_MAX, NULL, NULL) == remaining);
+    ASSERT_TEST(calendarGetFirst(calendar) == NULL && calendarPopFirst(calendar) == NULL);
+    ASSERT_TEST(calendarRemoveBefore(NULL, 0, NULL, NULL) == -1);
+    calendarDestroy(calendar);
+    stringTableDestroy(names);
+    return true;
+}
+
+static bool testEventsOnTheLastDates(void){
+    StringTable names = stringTableCreate();
+    EventCalendar calendar = calendarCreate();
+    ASSERT_TEST(names != NULL && calendar != NULL);
+    //enough events for the calendar to grow, all next to DATE_SERIAL_MAX:
+    for(int i = 0; i < 300; i++){
+        ASSERT_TEST(insertEvent(calendar, names, i, DATE_SERIAL_MAX - (i < 299 ? 1 : 0)) == CALENDAR_SUCCESS);
+    }
+    ASSERT_TEST(eventGetId(calendarGetFirst(calendar)) == 0);
+    for(int i = 0; i < 299; i++){
+        ASSERT_TEST(calendarRemove(calendar, i) == CALENDAR_SUCCESS);
+    }
+    ASSERT_TEST(eventGetId(calendarGetFirst(calendar)) == 299);
+    ASSERT_TEST(calendarGetNext(calendar) == NULL);
+    calendarDestroy(calendar);
+    stringTableDestroy(names);
+    return true;
+}
+
+int main(void){
+    int failed = 0;
+    RUN_TEST(testInsertAndFind, failed);
+    RUN_TEST(testChangeDateAndRemove, failed);
+    RUN_TEST(testRemoveBefore, failed);
+    RUN_TEST(testEventsOnTheLastDates, failed);
+    return TEST_EXIT_STATUS(failed);
+}
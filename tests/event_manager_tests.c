@@ -0,0 +1,380 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include "test_utilities.h"
+#include "../event_manager.h"
+
+#define PATH_LENGTH 64
+//room for a path and the suffix of one of its files:
+#define FILE_PATH_LENGTH (PATH_LENGTH + 16)
+
+/* a directory for the files of durable event managers, removed by removeDirectory */
+static bool makeDirectory(char* directory, char* path){
+    strcpy(directory, "/tmp/em_testsXXXXXX");
+    if(mkdtemp(directory) == NULL){
+        return false;
+    }
+    sprintf(path, "%s/em", directory);
+    return true;
+}
+
+static void removeDirectory(const char* directory, const char* path){
+    char file[FILE_PATH_LENGTH];
+    snprintf(file, sizeof(file), "%s.snapshot", path);
+    unlink(file);
+    snprintf(file, sizeof(file), "%s.log", path);
+    unlink(file);
+    rmdir(directory);
+}
+
+static EventManager createOn(int day, int month, int year){
+    Date date = dateCreate(day, month, year);
+    EventManager em = date == NULL ? NULL : createEventManager(date);
+    dateDestroy(date);
+    return em;
+}
+
+static EventManager openDurable(const char* path, EMSyncMode sync_mode, int batch_size, int snapshot_interval){
+    //recovery ignores the date, so a later one shows it was not used:
+    Date date = dateCreate(1, 1, 2030);
+    EventManager em = date == NULL ? NULL : createDurableEventManager(date, path, sync_mode, batch_size,
+                                                                      snapshot_interval);
+    dateDestroy(date);
+    return em;
+}
+
+/* adds the events a, b and c on the first three days, and member 7 to a and c, then removes b and
+   moves one day on, past a */
+static bool makeChanges(EventManager em){
+    return emAddEventByDiff(em, "a", 0, 1) == EM_SUCCESS &&
+           emAddEventByDiff(em, "b", 1, 2) == EM_SUCCESS &&
+           emAddEventByDiff(em, "c", 2, 3) == EM_SUCCESS &&
+           emAddMember(em, "m", 7) == EM_SUCCESS &&
+           emAddMemberToEvent(em, 7, 1) == EM_SUCCESS &&
+           emAddMemberToEvent(em, 7, 3) == EM_SUCCESS &&
+           emRemoveEvent(em, 2) == EM_SUCCESS &&
+           emTick(em, 1) == EM_SUCCESS;
+}
+
+/* whether em holds exactly what makeChanges leaves in an event manager created on 1.1.2020 */
+static bool hasChanges(EventManager em){
+    Date first_day = dateCreate(1, 1, 2020);
+    bool result = emGetEventsAmount(em) == 1 && strcmp(emGetNextEvent(em), "c") == 0 &&
+                  emAddEventByDate(em, "d", first_day, 4) == EM_INVALID_DATE &&
+                  emAddMember(em, "m", 7) == EM_MEMBER_ID_ALREADY_EXISTS &&
+                  emAddMemberToEvent(em, 7, 3) == EM_EVENT_AND_MEMBER_ALREADY_LINKED &&
+                  emAddMemberToEvent(em, 7, 1) == EM_EVENT_ID_NOT_EXISTS;
+    dateDestroy(first_day);
+    return result;
+}
+
+/* reads the whole file from its start into a new string, NULL if that failed */
+static char* readFile(int fd){
+    off_t size = lseek(fd, 0, SEEK_END);
+    char* content = size < 0 ? NULL : malloc(size + 1);
+    if(content == NULL || lseek(fd, 0, SEEK_SET) != 0 || read(fd, content, size) != size){
+        free(content);
+        return NULL;
+    }
+    content[size] = '\0';
+    return content;
+}
+
+/* whether both the report write_report writes to a file descriptor and the one print_report writes to
+   a file by name are content */
+static bool reportsAs(EventManager em, EventManagerResult (*write_report)(EventManager, int),
+                      void (*print_report)(EventManager, const char*), const char* content){
+    char file_name[] = "/tmp/em_reportXXXXXX";
+    int fd = mkstemp(file_name);
+    if(fd < 0){
+        return false;
+    }
+    char* written = write_report(em, fd) == EM_SUCCESS ? readFile(fd) : NULL;
+    close(fd);
+    print_report(em, file_name);
+    fd = open(file_name, O_RDONLY);
+    char* printed = fd < 0 ? NULL : readFile(fd);
+    close(fd);
+    unlink(file_name);
+    bool result = written != NULL && printed != NULL && strcmp(written, content) == 0 &&
+                  strcmp(printed, content) == 0;
+    free(written);
+    free(printed);
+    return result;
+}
+
+/*=========================================================================*/
+
+static bool testDurableArguments(void){
+    char directory[PATH_LENGTH], path[PATH_LENGTH];
+    ASSERT_TEST(makeDirectory(directory, path));
+    Date date = dateCreate(1, 1, 2020);
+    ASSERT_TEST(date != NULL);
+    ASSERT_TEST(createDurableEventManager(date, NULL, EM_SYNC_EACH_OPERATION, 1, 0) == NULL);
+    ASSERT_TEST(createDurableEventManager(date, path, EM_SYNC_EACH_BATCH, 0, 0) == NULL);
+    ASSERT_TEST(createDurableEventManager(date, path, EM_SYNC_EACH_BATCH, 1, -1) == NULL);
+    ASSERT_TEST(createDurableEventManager(NULL, path, EM_SYNC_EACH_BATCH, 1, 0) == NULL);
+    dateDestroy(date);
+    //an event manager that is not durable has nothing to sync or checkpoint:
+    EventManager em = createOn(1, 1, 2020);
+    ASSERT_TEST(em != NULL);
+    ASSERT_TEST(emSync(em) == EM_SUCCESS && emCheckpoint(em) == EM_ERROR);
+    ASSERT_TEST(emSync(NULL) == EM_NULL_ARGUMENT && emCheckpoint(NULL) == EM_NULL_ARGUMENT);
+    destroyEventManager(em);
+    removeDirectory(directory, path);
+    return true;
+}
+
+static bool testRecoveryReplaysTheLog(void){
+    char directory[PATH_LENGTH], path[PATH_LENGTH];
+    ASSERT_TEST(makeDirectory(directory, path));
+    Date date = dateCreate(1, 1, 2020);
+    ASSERT_TEST(date != NULL);
+    EventManager em = createDurableEventManager(date, path, EM_SYNC_EACH_OPERATION, 1, 0);
+    dateDestroy(date);
+    ASSERT_TEST(em != NULL && makeChanges(em));
+    destroyEventManager(em);
+    //only the first snapshot was written, so every change comes from the log:
+    em = openDurable(path, EM_SYNC_EACH_OPERATION, 1, 0);
+    ASSERT_TEST(em != NULL && hasChanges(em));
+    ASSERT_TEST(emAddEventByDiff(em, "d", 0, 4) == EM_SUCCESS);
+    ASSERT_TEST(emCheckpoint(em) == EM_SUCCESS);
+    ASSERT_TEST(emRemoveMemberFromEvent(em, 7, 3) == EM_SUCCESS);
+    destroyEventManager(em);
+    //and now from the snapshot, and the one change logged after it:
+    em = openDurable(path, EM_SYNC_EACH_OPERATION, 1, 0);
+    ASSERT_TEST(em != NULL && emGetEventsAmount(em) == 2);
+    ASSERT_TEST(emRemoveMemberFromEvent(em, 7, 3) == EM_EVENT_AND_MEMBER_NOT_LINKED);
+    destroyEventManager(em);
+    removeDirectory(directory, path);
+    return true;
+}
+
+static bool testBatchedSyncAndPeriodicSnapshots(void){
+    char directory[PATH_LENGTH], path[PATH_LENGTH];
+    ASSERT_TEST(makeDirectory(directory, path));
+    Date date = dateCreate(1, 1, 2020);
+    ASSERT_TEST(date != NULL);
+    EventManager em = createDurableEventManager(date, path, EM_SYNC_EACH_BATCH, 4, 3);
+    dateDestroy(date);
+    ASSERT_TEST(em != NULL && makeChanges(em));
+    ASSERT_TEST(emSync(em) == EM_SUCCESS);
+    destroyEventManager(em);
+    em = openDurable(path, EM_SYNC_EACH_BATCH, 4, 3);
+    ASSERT_TEST(em != NULL && hasChanges(em));
+    destroyEventManager(em);
+    removeDirectory(directory, path);
+    return true;
+}
+
+static bool testCorruptSnapshotIsRejected(void){
+    char directory[PATH_LENGTH], path[PATH_LENGTH];
+    ASSERT_TEST(makeDirectory(directory, path));
+    char snapshot[FILE_PATH_LENGTH];
+    snprintf(snapshot, sizeof(snapshot), "%s.snapshot", path);
+    FILE* file = fopen(snapshot, "w");
+    ASSERT_TEST(file != NULL);
+    fputs("not a snapshot", file);
+    fclose(file);
+    ASSERT_TEST(openDurable(path, EM_SYNC_EACH_OPERATION, 1, 0) == NULL);
+    removeDirectory(directory, path);
+    return true;
+}
+
+static bool testReportsToFileDescriptorsAndMemory(void){
+    EventManager em = createOn(1, 1, 2020);
+    ASSERT_TEST(em != NULL);
+    ASSERT_TEST(emAddEventByDiff(em, "y", 31, 2) == EM_SUCCESS);
+    ASSERT_TEST(emAddEventByDiff(em, "x", 0, 1) == EM_SUCCESS);
+    ASSERT_TEST(emAddMember(em, "m2", 2) == EM_SUCCESS && emAddMember(em, "m1", 1) == EM_SUCCESS);
+    ASSERT_TEST(emAddMemberToEvent(em, 2, 1) == EM_SUCCESS && emAddMemberToEvent(em, 1, 1) == EM_SUCCESS);
+    ASSERT_TEST(emAddMemberToEvent(em, 2, 2) == EM_SUCCESS);
+    const char* events = "x,1.1.2020,m1,m2\ny,2.2.2020,m2\n";
+    const char* members = "m2,2\nm1,1\n";
+    int length = 0;
+    char* formatted = emFormatAllEvents(em, &length);
+    ASSERT_TEST(formatted != NULL && strcmp(formatted, events) == 0 && length == (int)strlen(events));
+    free(formatted);
+    formatted = emFormatAllResponsibleMembers(em, NULL);
+    ASSERT_TEST(formatted != NULL && strcmp(formatted, members) == 0);
+    free(formatted);
+    ASSERT_TEST(reportsAs(em, emWriteAllEvents, emPrintAllEvents, events));
+    ASSERT_TEST(reportsAs(em, emWriteAllResponsibleMembers, emPrintAllResponsibleMembers, members));
+    ASSERT_TEST(emWriteAllEvents(em, -1) == EM_ERROR && emWriteAllEvents(NULL, 1) == EM_NULL_ARGUMENT);
+    ASSERT_TEST(emFormatAllEvents(NULL, &length) == NULL);
+    destroyEventManager(em);
+    return true;
+}
+
+static bool testLargeReportsAreWrittenWhole(void){
+    EventManager em = createOn(1, 1, 2020);
+    ASSERT_TEST(em != NULL);
+    //a report many times the size of the buffer it is formatted in:
+    for(int i = 0; i < 20000; i++){
+        char name[PATH_LENGTH];
+        sprintf(name, "event number %d", i);
+        ASSERT_TEST(emAddEventByDiff(em, name, i % 1000, i) == EM_SUCCESS);
+    }
+    char* events = emFormatAllEvents(em, NULL);
+    ASSERT_TEST(events != NULL && strlen(events) > 400000);
+    bool same = reportsAs(em, emWriteAllEvents, emPrintAllEvents, events);
+    free(events);
+    ASSERT_TEST(same);
+    destroyEventManager(em);
+    return true;
+}
+
+/* whether the responsible members report, limited to count lines if count is not negative, is content */
+static bool membersReportIs(EventManager em, int count, const char* content){
+    char* report = count < 0 ? emFormatAllResponsibleMembers(em, NULL) :
+                               emFormatTopResponsibleMembers(em, count, NULL);
+    bool result = report != NULL && strcmp(report, content) == 0;
+    free(report);
+    return result;
+}
+
+static bool testResponsibleMembersFollowChanges(void){
+    EventManager em = createOn(1, 1, 2020);
+    ASSERT_TEST(em != NULL);
+    char name[] = "m0";
+    for(int i = 1; i <= 5; i++){
+        name[1] = '0' + i;
+        ASSERT_TEST(emAddMember(em, name, i) == EM_SUCCESS);
+        ASSERT_TEST(emAddEventByDiff(em, name, i, i) == EM_SUCCESS);
+    }
+    int links[][2] = {{3, 1}, {3, 2}, {3, 3}, {5, 4}, {1, 5}, {1, 2}, {5, 1}, {2, 4}};
+    for(int i = 0; i < sizeof(links) / sizeof(links[0]); i++){
+        ASSERT_TEST(emAddMemberToEvent(em, links[i][0], links[i][1]) == EM_SUCCESS);
+    }
+    //members with the same number of events are ordered by id, and members with none are left out:
+    ASSERT_TEST(membersReportIs(em, -1, "m3,3\nm1,2\nm5,2\nm2,1\n"));
+    ASSERT_TEST(membersReportIs(em, 2, "m3,3\nm1,2\n"));
+    ASSERT_TEST(membersReportIs(em, 10, "m3,3\nm1,2\nm5,2\nm2,1\n"));
+    ASSERT_TEST(membersReportIs(em, 0, ""));
+    ASSERT_TEST(emFormatTopResponsibleMembers(em, -1, NULL) == NULL);
+    ASSERT_TEST(emWriteTopResponsibleMembers(em, STDOUT_FILENO, -1) == EM_ERROR);
+    //every change after a report is reflected in the next one:
+    ASSERT_TEST(emRemoveMemberFromEvent(em, 3, 3) == EM_SUCCESS);
+    ASSERT_TEST(emAddMemberToEvent(em, 4, 5) == EM_SUCCESS);
+    ASSERT_TEST(membersReportIs(em, -1, "m1,2\nm3,2\nm5,2\nm2,1\nm4,1\n"));
+    ASSERT_TEST(emRemoveEvent(em, 4) == EM_SUCCESS);
+    ASSERT_TEST(membersReportIs(em, 3, "m1,2\nm3,2\nm4,1\n"));
+    ASSERT_TEST(emTick(em, 2) == EM_SUCCESS);
+    ASSERT_TEST(membersReportIs(em, -1, "m1,2\nm3,1\nm4,1\n"));
+    destroyEventManager(em);
+    return true;
+}
+
+#define DENSE_MEMBERS 100
+#define SPARSE_MEMBERS 300
+
+/* the id of the i'th of the members testIdLookups adds, dense ones first */
+static int memberIdAt(int i){
+    if(i < DENSE_MEMBERS){
+        return i;
+    }
+    return i < DENSE_MEMBERS + SPARSE_MEMBERS ? 1000000 + (i - DENSE_MEMBERS) * 7919 : INT_MAX;
+}
+
+static bool testIdLookups(void){
+    EventManager em = createOn(1, 1, 2020);
+    ASSERT_TEST(em != NULL);
+    ASSERT_TEST(emAddEventByDiff(em, "e", 1, 5) == EM_SUCCESS);
+    ASSERT_TEST(emAddEventByDiff(em, "f", 1, 5) == EM_EVENT_ID_ALREADY_EXISTS);
+    ASSERT_TEST(emRemoveEvent(em, 6) == EM_EVENT_NOT_EXISTS);
+    ASSERT_TEST(emAddMemberToEvent(em, 0, 6) == EM_EVENT_ID_NOT_EXISTS);
+    //ids small enough to be kept directly, sparse ones that are hashed, and the largest id:
+    int count = DENSE_MEMBERS + SPARSE_MEMBERS + 1;
+    for(int i = 0; i < count; i++){
+        ASSERT_TEST(emAddMember(em, "m", memberIdAt(i)) == EM_SUCCESS);
+    }
+    for(int i = 0; i < count; i++){
+        ASSERT_TEST(emAddMember(em, "m", memberIdAt(i)) == EM_MEMBER_ID_ALREADY_EXISTS);
+        ASSERT_TEST(emAddMemberToEvent(em, memberIdAt(i), 5) == EM_SUCCESS);
+    }
+    ASSERT_TEST(emAddMemberToEvent(em, DENSE_MEMBERS, 5) == EM_MEMBER_ID_NOT_EXISTS);
+    ASSERT_TEST(emAddMemberToEvent(em, 1000001, 5) == EM_MEMBER_ID_NOT_EXISTS);
+    ASSERT_TEST(emAddMemberToEvent(em, -1, 5) == EM_INVALID_MEMBER_ID);
+    ASSERT_TEST(emRemoveMemberFromEvent(em, INT_MAX, 5) == EM_SUCCESS);
+    ASSERT_TEST(emRemoveMemberFromEvent(em, INT_MAX, 5) == EM_EVENT_AND_MEMBER_NOT_LINKED);
+    ASSERT_TEST(emRemoveMemberFromEvent(em, INT_MAX - 1, 5) == EM_MEMBER_ID_NOT_EXISTS);
+    destroyEventManager(em);
+    return true;
+}
+
+static bool testEventNamesPerDate(void){
+    EventManager em = createOn(1, 1, 2020);
+    EventManager other = createOn(1, 1, 2020);
+    ASSERT_TEST(em != NULL && other != NULL);
+    char name[] = "party";
+    ASSERT_TEST(emAddEventByDiff(em, name, 1, 1) == EM_SUCCESS);
+    //the event keeps its own copy of the name:
+    name[0] = 'P';
+    ASSERT_TEST(emAddEventByDiff(em, "party", 1, 2) == EM_EVENT_ALREADY_EXISTS);
+    ASSERT_TEST(emAddEventByDiff(em, name, 1, 2) == EM_SUCCESS);
+    ASSERT_TEST(emAddEventByDiff(em, "party", 2, 3) == EM_SUCCESS);
+    ASSERT_TEST(emAddEventByDiff(other, "party", 1, 1) == EM_SUCCESS);
+    Date second_day = dateCreate(2, 1, 2020);
+    ASSERT_TEST(second_day != NULL);
+    ASSERT_TEST(emChangeEventDate(em, 3, second_day) == EM_EVENT_ALREADY_EXISTS);
+    ASSERT_TEST(emRemoveEvent(em, 1) == EM_SUCCESS);
+    ASSERT_TEST(emChangeEventDate(em, 3, second_day) == EM_SUCCESS);
+    ASSERT_TEST(emAddEventByDate(em, "party", second_day, 4) == EM_EVENT_ALREADY_EXISTS);
+    dateDestroy(second_day);
+    destroyEventManager(other);
+    char* events = emFormatAllEvents(em, NULL);
+    ASSERT_TEST(events != NULL && strcmp(events, "Party,2.1.2020\nparty,2.1.2020\n") == 0);
+    free(events);
+    destroyEventManager(em);
+    return true;
+}
+
+#define TICK_EVENTS 1000
+
+static bool testTickExpiresPastEvents(void){
+    EventManager em = createOn(1, 1, 2020);
+    ASSERT_TEST(em != NULL);
+    ASSERT_TEST(emAddMember(em, "m", 1) == EM_SUCCESS);
+    //several events a day, added out of date order:
+    for(int i = 0; i < TICK_EVENTS; i++){
+        char name[PATH_LENGTH];
+        sprintf(name, "e%d", i);
+        ASSERT_TEST(emAddEventByDiff(em, name, (i * 37) % (TICK_EVENTS / 4), i) == EM_SUCCESS);
+        ASSERT_TEST(emAddMemberToEvent(em, 1, i) == EM_SUCCESS);
+    }
+    ASSERT_TEST(emTick(em, 0) == EM_INVALID_DATE && emTick(em, -1) == EM_INVALID_DATE);
+    ASSERT_TEST(emTick(em, DATE_SERIAL_MAX) == EM_INVALID_DATE);
+    ASSERT_TEST(emTick(NULL, 1) == EM_NULL_ARGUMENT);
+    //the events before the new date expire, the ones on it stay:
+    ASSERT_TEST(emTick(em, TICK_EVENTS / 8) == EM_SUCCESS);
+    ASSERT_TEST(emGetEventsAmount(em) == TICK_EVENTS / 2);
+    ASSERT_TEST(strcmp(emGetNextEvent(em), "e125") == 0);
+    ASSERT_TEST(membersReportIs(em, -1, "m,500\n"));
+    ASSERT_TEST(emAddMemberToEvent(em, 1, 0) == EM_EVENT_ID_NOT_EXISTS);
+    ASSERT_TEST(emTick(em, TICK_EVENTS) == EM_SUCCESS);
+    ASSERT_TEST(emGetEventsAmount(em) == 0 && emGetNextEvent(em) == NULL);
+    ASSERT_TEST(membersReportIs(em, -1, ""));
+    destroyEventManager(em);
+    return true;
+}
+
+int main(void){
+    int failed = 0;
+    RUN_TEST(testDurableArguments, failed);
+    RUN_TEST(testRecoveryReplaysTheLog, failed);
+    RUN_TEST(testBatchedSyncAndPeriodicSnapshots, failed);
+    RUN_TEST(testCorruptSnapshotIsRejected, failed);
+    RUN_TEST(testReportsToFileDescriptorsAndMemory, failed);
+    RUN_TEST(testLargeReportsAreWrittenWhole, failed);
+    RUN_TEST(testResponsibleMembersFollowChanges, failed);
+    RUN_TEST(testIdLookups, failed);
+    RUN_TEST(testEventNamesPerDate, failed);
+    RUN_TEST(testTickExpiresPastEvents, failed);
+    return TEST_EXIT_STATUS(failed);
+}
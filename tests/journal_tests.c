@@ -0,0 +1,174 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "test_utilities.h"
+#include "../journal.h"
+
+#define PATH_LENGTH 64
+#define MAX_RECORDS 16
+#define RECORD_PADDING 100
+
+/* the records a replay passed on, in order */
+typedef struct Replayed_t {
+    int values[MAX_RECORDS];
+    int count;
+} Replayed;
+
+static bool collectRecord(JournalReader* record, void* replayed){
+    Replayed* collected = replayed;
+    int value = journalGetInt(record);
+    if(record->failed || collected->count == MAX_RECORDS){
+        return false;
+    }
+    collected->values[collected->count++] = value;
+    return true;
+}
+
+/* appends a record holding value and a string long enough to make the records span a few writes */
+static bool appendRecord(Journal journal, int value){
+    char padding[RECORD_PADDING + 1];
+    memset(padding, 'x', RECORD_PADDING);
+    padding[RECORD_PADDING] = '\0';
+    JournalBuffer record;
+    journalBufferInit(&record);
+    journalPutInt(&record, value);
+    journalPutString(&record, padding);
+    bool appended = journalAppend(journal, &record);
+    journalBufferFree(&record);
+    return appended;
+}
+
+/* whether replaying the log at path after after_lsn gives exactly the values 0 to count - 1 */
+static bool replaysAs(const char* path, unsigned long long after_lsn, int count){
+    Replayed replayed = {.count = 0};
+    unsigned long long last_lsn;
+    if(!journalReplay(path, after_lsn, collectRecord, &replayed, &last_lsn) || replayed.count != count){
+        return false;
+    }
+    for(int i = 0; i < count; i++){
+        if(replayed.values[i] != (int)after_lsn + i){
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool makePath(char* path){
+    strcpy(path, "/tmp/journal_testsXXXXXX");
+    int fd = mkstemp(path);
+    if(fd < 0){
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+/*=========================================================================*/
+
+static bool testAppendAndReplay(void){
+    char path[PATH_LENGTH];
+    ASSERT_TEST(makePath(path));
+    ASSERT_TEST(journalOpen(path, 0, false, 0) == NULL);
+    Journal journal = journalOpen(path, 0, false, 3);
+    ASSERT_TEST(journal != NULL);
+    for(int i = 0; i < 5; i++){
+        ASSERT_TEST(appendRecord(journal, i));
+    }
+    ASSERT_TEST(journalLastLSN(journal) == 5);
+    //only the first batch of 3 was committed so far:
+    ASSERT_TEST(replaysAs(path, 0, 3));
+    ASSERT_TEST(journalClose(journal));
+    ASSERT_TEST(replaysAs(path, 0, 5));
+    ASSERT_TEST(replaysAs(path, 2, 3));
+    unlink(path);
+    return true;
+}
+
+static bool testTornRecordIsCut(void){
+    char path[PATH_LENGTH];
+    ASSERT_TEST(makePath(path));
+    Journal journal = journalOpen(path, 0, true, 1);
+    ASSERT_TEST(journal != NULL);
+    ASSERT_TEST(appendRecord(journal, 0) && appendRecord(journal, 1));
+    ASSERT_TEST(journalClose(journal));
+    FILE* file = fopen(path, "a");
+    ASSERT_TEST(file != NULL);
+    fputs("torn", file);
+    fclose(file);
+    ASSERT_TEST(replaysAs(path, 0, 2));
+    //the torn bytes were cut, so a record appended now is replayed after the others:
+    journal = journalOpen(path, 2, true, 1);
+    ASSERT_TEST(journal != NULL && appendRecord(journal, 2));
+    ASSERT_TEST(journalClose(journal));
+    ASSERT_TEST(replaysAs(path, 0, 3));
+    unlink(path);
+    return true;
+}
+
+static bool testFailedCommitGoesOn(void){
+    char path[PATH_LENGTH];
+    ASSERT_TEST(makePath(path));
+    Journal journal = journalOpen(path, 0, false, MAX_RECORDS);
+    ASSERT_TEST(journal != NULL);
+    for(int i = 0; i < 10; i++){
+        ASSERT_TEST(appendRecord(journal, i));
+    }
+    //a file size limit in the middle of the batch makes the commit write only part of it:
+    struct rlimit limit, small_limit;
+    ASSERT_TEST(getrlimit(RLIMIT_FSIZE, &limit) == 0);
+    small_limit = limit;
+    small_limit.rlim_cur = 5 * RECORD_PADDING;
+    signal(SIGXFSZ, SIG_IGN);
+    ASSERT_TEST(setrlimit(RLIMIT_FSIZE, &small_limit) == 0);
+    bool committed = journalCommit(journal);
+    ASSERT_TEST(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+    ASSERT_TEST(!committed);
+    ASSERT_TEST(journalCommit(journal));
+    ASSERT_TEST(journalClose(journal));
+    ASSERT_TEST(replaysAs(path, 0, 10));
+    unlink(path);
+    return true;
+}
+
+static bool testSnapshots(void){
+    char path[PATH_LENGTH];
+    ASSERT_TEST(makePath(path));
+    JournalBuffer content, read;
+    journalBufferInit(&content);
+    journalBufferInit(&read);
+    journalPutString(&content, "snapshot");
+    journalPutLong(&content, 42);
+    ASSERT_TEST(journalWriteSnapshot(path, &content));
+    bool exists = false;
+    ASSERT_TEST(journalReadSnapshot(path, &read, &exists) && exists);
+    ASSERT_TEST(read.size == content.size && memcmp(read.bytes, content.bytes, content.size) == 0);
+    journalBufferFree(&read);
+    //a changed byte no longer matches the checksum:
+    FILE* file = fopen(path, "r+");
+    ASSERT_TEST(file != NULL);
+    fseek(file, -6, SEEK_END);
+    fputc('X', file);
+    fclose(file);
+    ASSERT_TEST(!journalReadSnapshot(path, &read, &exists) && exists);
+    journalBufferFree(&read);
+    unlink(path);
+    ASSERT_TEST(!journalReadSnapshot(path, &read, &exists) && !exists);
+    journalBufferFree(&read);
+    journalBufferFree(&content);
+    return true;
+}
+
+int main(void){
+    int failed = 0;
+    RUN_TEST(testAppendAndReplay, failed);
+    RUN_TEST(testTornRecordIsCut, failed);
+    RUN_TEST(testFailedCommitGoesOn, failed);
+    RUN_TEST(testSnapshots, failed);
+    return TEST_EXIT_STATUS(failed);
+}
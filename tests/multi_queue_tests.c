@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "test_utilities.h"
+#include "../multi_queue.h"
+
+#define THREADS 4
+#define ELEMENTS_PER_THREAD 2000
+
+static PQElement copyInt(PQElement element){
+    int* copy = malloc(sizeof(*copy));
+    if(copy != NULL){
+        *copy = *(int*)element;
+    }
+    return copy;
+}
+
+static void freeInt(PQElement element){
+    free(element);
+}
+
+static bool equalInts(PQElement first, PQElement second){
+    return *(int*)first == *(int*)second;
+}
+
+static int compareInts(PQElementPriority first, PQElementPriority second){
+    return *(int*)first - *(int*)second;
+}
+
+static MultiQueue createIntMultiQueue(int queue_count){
+    return mqCreate(queue_count, copyInt, freeInt, equalInts, copyInt, freeInt, compareInts);
+}
+
+/* pops an element, returning it by value, -1 if nothing was popped */
+static int popInt(MultiQueue queue){
+    PQElement element = NULL;
+    if(mqPopTake(queue, &element, NULL) != PQ_SUCCESS){
+        return -1;
+    }
+    int value = *(int*)element;
+    free(element);
+    return value;
+}
+
+/*=========================================================================*/
+
+static bool testArguments(void){
+    ASSERT_TEST(createIntMultiQueue(0) == NULL);
+    ASSERT_TEST(mqCreate(2, NULL, freeInt, equalInts, copyInt, freeInt, compareInts) == NULL);
+    ASSERT_TEST(mqGetSize(NULL) == -1);
+    MultiQueue queue = createIntMultiQueue(2);
+    ASSERT_TEST(queue != NULL);
+    int value = 1;
+    PQElement element;
+    ASSERT_TEST(mqInsert(queue, NULL, &value) == PQ_NULL_ARGUMENT);
+    ASSERT_TEST(mqPopTake(queue, NULL, NULL) == PQ_NULL_ARGUMENT);
+    ASSERT_TEST(mqPopTake(queue, &element, NULL) == PQ_ELEMENT_DOES_NOT_EXISTS);
+    mqDestroy(queue);
+    return true;
+}
+
+/* with a single internal queue there is no rank error */
+static bool testSingleQueueIsStrict(void){
+    MultiQueue queue = createIntMultiQueue(1);
+    ASSERT_TEST(queue != NULL);
+    int values[] = {4, 9, 1, 7, 3};
+    for(int i = 0; i < 5; i++){
+        ASSERT_TEST(mqInsert(queue, &values[i], &values[i]) == PQ_SUCCESS);
+    }
+    ASSERT_TEST(mqGetSize(queue) == 5);
+    int expected[] = {9, 7, 4, 3, 1};
+    for(int i = 0; i < 5; i++){
+        ASSERT_TEST(popInt(queue) == expected[i]);
+    }
+    ASSERT_TEST(popInt(queue) == -1 && mqGetSize(queue) == 0);
+    mqDestroy(queue);
+    return true;
+}
+
+/* a lone element among many empty internal queues is still found, by the sweep if need be */
+static bool testLoneElementIsFound(void){
+    MultiQueue queue = createIntMultiQueue(64);
+    ASSERT_TEST(queue != NULL);
+    for(int round = 0; round < 100; round++){
+        ASSERT_TEST(mqInsert(queue, &round, &round) == PQ_SUCCESS);
+        ASSERT_TEST(popInt(queue) == round);
+    }
+    ASSERT_TEST(mqGetSize(queue) == 0);
+    mqDestroy(queue);
+    return true;
+}
+
+typedef struct {
+    MultiQueue queue;
+    int first;
+    bool* seen;
+    bool failed;
+} Worker;
+
+/* inserts the worker's range of values, then pops as many elements as it inserted */
+static void* insertAndPop(void* argument){
+    Worker* worker = argument;
+    for(int value = worker->first; value < worker->first + ELEMENTS_PER_THREAD; value++){
+        worker->failed = worker->failed || mqInsert(worker->queue, &value, &value) != PQ_SUCCESS;
+    }
+    for(int i = 0; i < ELEMENTS_PER_THREAD; i++){
+        int value = popInt(worker->queue);
+        if(value < 0){
+            worker->failed = true;
+            continue;
+        }
+        //every value is popped by exactly one thread, so only one writes its flag:
+        worker->seen[value] = true;
+    }
+    return NULL;
+}
+
+static bool testEveryElementIsPoppedOnce(void){
+    MultiQueue queue = createIntMultiQueue(2 * THREADS);
+    ASSERT_TEST(queue != NULL);
+    bool* seen = calloc(THREADS * ELEMENTS_PER_THREAD, sizeof(*seen));
+    ASSERT_TEST(seen != NULL);
+    Worker workers[THREADS];
+    pthread_t threads[THREADS];
+    for(int i = 0; i < THREADS; i++){
+        workers[i] = (Worker){.queue = queue, .first = i * ELEMENTS_PER_THREAD, .seen = seen, .failed = false};
+        ASSERT_TEST(pthread_create(&threads[i], NULL, insertAndPop, &workers[i]) == 0);
+    }
+    bool failed = false;
+    for(int i = 0; i < THREADS; i++){
+        pthread_join(threads[i], NULL);
+        failed = failed || workers[i].failed;
+    }
+    bool all_seen = true;
+    for(int i = 0; i < THREADS * ELEMENTS_PER_THREAD; i++){
+        all_seen = all_seen && seen[i];
+    }
+    free(seen);
+    ASSERT_TEST(!failed && all_seen);
+    ASSERT_TEST(mqGetSize(queue) == 0);
+    mqDestroy(queue);
+    return true;
+}
+
+/*=========================================================================*/
+
+int main(void){
+    int failed = 0;
+    RUN_TEST(testArguments, failed);
+    RUN_TEST(testSingleQueueIsStrict, failed);
+    RUN_TEST(testLoneElementIsFound, failed);
+    RUN_TEST(testEveryElementIsPoppedOnce, failed);
+    return TEST_EXIT_STATUS(failed);
+}
@@ -0,0 +1,208 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "test_utilities.h"
+#include "../pq_executor.h"
+
+#define TASK_COUNT 1000
+#define ORDERED_TASKS 5
+
+static PQElementPriority copyInt(PQElementPriority priority){
+    int* copy = malloc(sizeof(*copy));
+    if(copy != NULL){
+        *copy = *(int*)priority;
+    }
+    return copy;
+}
+
+static void freeInt(PQElementPriority priority){
+    free(priority);
+}
+
+static int compareInts(PQElementPriority first, PQElementPriority second){
+    return *(int*)first - *(int*)second;
+}
+
+static PQExecutor createExecutor(int threads){
+    return pqExecutorCreate(threads, copyInt, freeInt, compareInts);
+}
+
+/* what the tasks record, shared by the tasks of a test */
+typedef struct TaskLog_t {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int ran;
+    int order[ORDERED_TASKS];
+    bool gate_started;
+    bool gate_open;
+    PQExecutor executor;
+} TaskLog;
+
+static void initLog(TaskLog* log, PQExecutor executor){
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->changed, NULL);
+    log->ran = 0;
+    log->gate_started = false;
+    log->gate_open = false;
+    log->executor = executor;
+}
+
+static void destroyLog(TaskLog* log){
+    pthread_cond_destroy(&log->changed);
+    pthread_mutex_destroy(&log->lock);
+}
+
+static void countTask(void* log){
+    TaskLog* task_log = log;
+    pthread_mutex_lock(&task_log->lock);
+    task_log->ran++;
+    pthread_mutex_unlock(&task_log->lock);
+}
+
+/* submits a counted task from the running task */
+static void submitChild(void* log){
+    int priority = 0;
+    pqExecutorSubmit(((TaskLog*)log)->executor, countTask, log, &priority);
+    countTask(log);
+}
+
+/* the log recordOrder writes to, as its argument is its priority */
+static TaskLog* ordered_log;
+
+/* records the priority the task was submitted with, which is also its argument */
+static void recordOrder(void* priority){
+    pthread_mutex_lock(&ordered_log->lock);
+    ordered_log->order[ordered_log->ran++] = *(int*)priority;
+    pthread_mutex_unlock(&ordered_log->lock);
+}
+
+/* keeps its worker busy until openGate is called */
+static void waitAtGate(void* log){
+    TaskLog* task_log = log;
+    pthread_mutex_lock(&task_log->lock);
+    task_log->gate_started = true;
+    pthread_cond_broadcast(&task_log->changed);
+    while(!task_log->gate_open){
+        pthread_cond_wait(&task_log->changed, &task_log->lock);
+    }
+    pthread_mutex_unlock(&task_log->lock);
+}
+
+/* submits a gate task and returns once a worker is running it */
+static bool closeGate(TaskLog* log){
+    int priority = 0;
+    if(pqExecutorSubmit(log->executor, waitAtGate, log, &priority) != PQ_EXECUTOR_SUCCESS){
+        return false;
+    }
+    pthread_mutex_lock(&log->lock);
+    while(!log->gate_started){
+        pthread_cond_wait(&log->changed, &log->lock);
+    }
+    pthread_mutex_unlock(&log->lock);
+    return true;
+}
+
+static void openGate(TaskLog* log){
+    pthread_mutex_lock(&log->lock);
+    log->gate_open = true;
+    pthread_cond_broadcast(&log->changed);
+    pthread_mutex_unlock(&log->lock);
+}
+
+static void doNothing(void* argument){
+}
+
+static void* discardPending(void* executor){
+    pqExecutorDestroy(executor, false);
+    return NULL;
+}
+
+/*=========================================================================*/
+
+static bool testArguments(void){
+    ASSERT_TEST(createExecutor(0) == NULL);
+    ASSERT_TEST(pqExecutorCreate(1, copyInt, freeInt, NULL) == NULL);
+    PQExecutor executor = createExecutor(1);
+    ASSERT_TEST(executor != NULL);
+    int priority = 0;
+    ASSERT_TEST(pqExecutorSubmit(NULL, doNothing, NULL, &priority) == PQ_EXECUTOR_NULL_ARGUMENT);
+    ASSERT_TEST(pqExecutorSubmit(executor, NULL, NULL, &priority) == PQ_EXECUTOR_NULL_ARGUMENT);
+    ASSERT_TEST(pqExecutorSubmit(executor, doNothing, NULL, NULL) == PQ_EXECUTOR_NULL_ARGUMENT);
+    pqExecutorWait(NULL);
+    pqExecutorDestroy(NULL, true);
+    pqExecutorDestroy(executor, true);
+    return true;
+}
+
+static bool testEveryTaskRuns(void){
+    PQExecutor executor = createExecutor(4);
+    ASSERT_TEST(executor != NULL);
+    TaskLog log;
+    initLog(&log, executor);
+    for(int i = 0; i < TASK_COUNT; i++){
+        int priority = i % 10;
+        PQTask task = i % 2 == 0 ? countTask : submitChild;
+        ASSERT_TEST(pqExecutorSubmit(executor, task, &log, &priority) == PQ_EXECUTOR_SUCCESS);
+    }
+    //waiting includes the tasks submitted by tasks:
+    pqExecutorWait(executor);
+    ASSERT_TEST(log.ran == TASK_COUNT + TASK_COUNT / 2);
+    ASSERT_TEST(pqExecutorSubmit(executor, countTask, &log, &(int){0}) == PQ_EXECUTOR_SUCCESS);
+    pqExecutorDestroy(executor, true);
+    ASSERT_TEST(log.ran == TASK_COUNT + TASK_COUNT / 2 + 1);
+    destroyLog(&log);
+    return true;
+}
+
+static bool testHigherPriorityRunsFirst(void){
+    PQExecutor executor = createExecutor(1);
+    ASSERT_TEST(executor != NULL);
+    TaskLog log;
+    initLog(&log, executor);
+    ASSERT_TEST(closeGate(&log));
+    static int priorities[ORDERED_TASKS] = {2, 4, 1, 5, 3};
+    ordered_log = &log;
+    for(int i = 0; i < ORDERED_TASKS; i++){
+        ASSERT_TEST(pqExecutorSubmit(executor, recordOrder, &priorities[i], &priorities[i]) == PQ_EXECUTOR_SUCCESS);
+    }
+    openGate(&log);
+    pqExecutorWait(executor);
+    ASSERT_TEST(log.ran == ORDERED_TASKS);
+    for(int i = 0; i < ORDERED_TASKS; i++){
+        ASSERT_TEST(log.order[i] == ORDERED_TASKS - i);
+    }
+    pqExecutorDestroy(executor, true);
+    destroyLog(&log);
+    return true;
+}
+
+static bool testDestroyDiscardsPending(void){
+    PQExecutor executor = createExecutor(1);
+    ASSERT_TEST(executor != NULL);
+    TaskLog log;
+    initLog(&log, executor);
+    ASSERT_TEST(closeGate(&log));
+    for(int i = 0; i < ORDERED_TASKS; i++){
+        ASSERT_TEST(pqExecutorSubmit(executor, countTask, &log, &i) == PQ_EXECUTOR_SUCCESS);
+    }
+    pthread_t destroyer;
+    ASSERT_TEST(pthread_create(&destroyer, NULL, discardPending, executor) == 0);
+    //the executor stays until the running gate task finishes, and refuses tasks meanwhile:
+    int priority = 0;
+    while(pqExecutorSubmit(executor, doNothing, NULL, &priority) != PQ_EXECUTOR_SHUT_DOWN){
+    }
+    openGate(&log);
+    pthread_join(destroyer, NULL);
+    ASSERT_TEST(log.ran == 0);
+    destroyLog(&log);
+    return true;
+}
+
+int main(void){
+    int failed = 0;
+    RUN_TEST(testArguments, failed);
+    RUN_TEST(testEveryTaskRuns, failed);
+    RUN_TEST(testHigherPriorityRunsFirst, failed);
+    RUN_TEST(testDestroyDiscardsPending, failed);
+    return TEST_EXIT_STATUS(failed);
+}
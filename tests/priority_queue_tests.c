@@ -0,0 +1,771 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "test_utilities.h"
+#include "../priority_queue.h"
+
+/*=========================================================================*/
+/* int elements and priorities, the element also serves as an id */
+
+static PQElement copyInt(PQElement element){
+    int* copy = malloc(sizeof(*copy));
+    if(copy != NULL){
+        *copy = *(int*)element;
+    }
+    return copy;
+}
+
+static void freeInt(PQElement element){
+    free(element);
+}
+
+static bool equalInts(PQElement first, PQElement second){
+    return *(int*)first == *(int*)second;
+}
+
+static int compareInts(PQElementPriority first, PQElementPriority second){
+    return *(int*)first - *(int*)second;
+}
+
+static PriorityQueue createIntQueue(void){
+    return pqCreate(copyInt, freeInt, equalInts, copyInt, freeInt, compareInts);
+}
+
+static int serializeInt(PQElement element, unsigned char* buffer, int size){
+    if(size >= (int)sizeof(int)){
+        memcpy(buffer, element, sizeof(int));
+    }
+    return sizeof(int);
+}
+
+static PQElement deserializeInt(const unsigned char* bytes, int size){
+    if(size != sizeof(int)){
+        return NULL;
+    }
+    int value;
+    memcpy(&value, bytes, sizeof(value));
+    return copyInt(&value);
+}
+
+static PriorityQueue loadIntQueue(int fd){
+    return pqLoad(fd, deserializeInt, deserializeInt, copyInt, freeInt, equalInts, copyInt, freeInt, compareInts);
+}
+
+/* inserts element with priority, both passed by value */
+static PriorityQueueResult insertInt(PriorityQueue queue, int element, int priority){
+    return pqInsert(queue, &element, &priority);
+}
+
+/* whether iterating over queue gives exactly the count elements of expected, in order */
+static bool iteratesAs(PriorityQueue queue, const int* expected, int count){
+    int i = 0;
+    PQ_FOREACH(int*, element, queue){
+        if(i == count || *element != expected[i]){
+            return false;
+        }
+        i++;
+    }
+    return i == count;
+}
+
+/*=========================================================================*/
+
+static bool testHeapOrder(void){
+    PriorityQueue queue = createIntQueue();
+    ASSERT_TEST(queue != NULL);
+    int priorities[] = {5, 1, 9, 3, 7, 2, 8, 6, 4, 0};
+    for(int i = 0; i < 10; i++){
+        ASSERT_TEST(insertInt(queue, priorities[i], priorities[i]) == PQ_SUCCESS);
+    }
+    ASSERT_TEST(pqGetSize(queue) == 10);
+    for(int expected = 9; expected >= 0; expected--){
+        ASSERT_TEST(*(int*)pqGetFirst(queue) == expected);
+        ASSERT_TEST(pqRemove(queue) == PQ_SUCCESS);
+    }
+    ASSERT_TEST(pqGetFirst(queue) == NULL);
+    pqDestroy(queue);
+    return true;
+}
+
+static bool testEqualPrioritiesKeepInsertionOrder(void){
+    PriorityQueue queue = createIntQueue();
+    ASSERT_TEST(queue != NULL);
+    for(int i = 0; i < 6; i++){
+        ASSERT_TEST(insertInt(queue, i, i % 2) == PQ_SUCCESS);
+    }
+    int expected[] = {1, 3, 5, 0, 2, 4};
+    ASSERT_TEST(iteratesAs(queue, expected, 6));
+    pqDestroy(queue);
+    return true;
+}
+
+static bool testChangePriorityAndRemoveElement(void){
+    PriorityQueue queue = createIntQueue();
+    ASSERT_TEST(queue != NULL);
+    for(int i = 0; i < 5; i++){
+        ASSERT_TEST(insertInt(queue, i, i) == PQ_SUCCESS);
+    }
+    int element = 0, old_priority = 0, new_priority = 10;
+    ASSERT_TEST(pqChangePriority(queue, &element, &old_priority, &new_priority) == PQ_SUCCESS);
+    ASSERT_TEST(*(int*)pqGetFirst(queue) == 0);
+    ASSERT_TEST(pqChangePriority(queue, &element, &old_priority, &new_priority) == PQ_ELEMENT_DOES_NOT_EXISTS);
+    element = 3;
+    ASSERT_TEST(pqContains(queue, &element));
+    ASSERT_TEST(pqRemoveElement(queue, &element) == PQ_SUCCESS);
+    ASSERT_TEST(!pqContains(queue, &element));
+    int expected[] = {0, 4, 2, 1};
+    ASSERT_TEST(iteratesAs(queue, expected, 4));
+    pqDestroy(queue);
+    return true;
+}
+
+static bool testCopyAndClear(void){
+    PriorityQueue queue = createIntQueue();
+    ASSERT_TEST(queue != NULL);
+    for(int i = 0; i < 20; i++){
+        ASSERT_TEST(insertInt(queue, i, (i * 7) % 20) == PQ_SUCCESS);
+    }
+    PriorityQueue copy = pqCopy(queue);
+    ASSERT_TEST(copy != NULL && pqGetSize(copy) == 20);
+    ASSERT_TEST(pqClear(queue) == PQ_SUCCESS);
+    ASSERT_TEST(pqGetSize(queue) == 0);
+    ASSERT_TEST(*(int*)pqGetFirst(copy) == 17);
+    pqDestroy(queue);
+    pqDestroy(copy);
+    return true;
+}
+
+static bool testNullArguments(void){
+    int value = 1;
+    ASSERT_TEST(pqInsert(NULL, &value, &value) == PQ_NULL_ARGUMENT);
+    ASSERT_TEST(pqGetSize(NULL) == -1);
+    PriorityQueue queue = createIntQueue();
+    ASSERT_TEST(queue != NULL);
+    ASSERT_TEST(pqInsert(queue, NULL, &value) == PQ_NULL_ARGUMENT);
+    ASSERT_TEST(pqInsert(queue, &value, NULL) == PQ_NULL_ARGUMENT);
+    ASSERT_TEST(pqGetSize(queue) == 0);
+    pqDestroy(queue);
+    return true;
+}
+
+static bool testCursorSurvivesCopyOnWriteCopy(void){
+    PriorityQueue queue = createIntQueue();
+    ASSERT_TEST(queue != NULL);
+    ASSERT_TEST(pqSetCopyOnWrite(queue, true) == PQ_SUCCESS);
+    for(int i = 0; i < 10; i++){
+        ASSERT_TEST(insertInt(queue, i, i) == PQ_SUCCESS);
+    }
+    PQCursor cursor = pqCursorOpen(queue);
+    ASSERT_TEST(cursor != NULL);
+    ASSERT_TEST(*(int*)pqCursorNext(cursor) == 9);
+    PriorityQueue copy = pqCopy(queue);
+    ASSERT_TEST(copy != NULL);
+    for(int expected = 8; expected >= 0; expected--){
+        int* element = pqCursorNext(cursor);
+        ASSERT_TEST(element != NULL && *element == expected);
+    }
+    ASSERT_TEST(pqCursorNext(cursor) == NULL);
+    pqCursorClose(cursor);
+    cursor = pqCursorOpen(queue);
+    ASSERT_TEST(cursor != NULL);
+    ASSERT_TEST(*(int*)pqCursorNext(cursor) == 9);
+    ASSERT_TEST(insertInt(queue, 10, 10) == PQ_SUCCESS);
+    ASSERT_TEST(pqCursorNext(cursor) == NULL);
+    pqCursorClose(cursor);
+    pqDestroy(queue);
+    pqDestroy(copy);
+    return true;
+}
+
+/* a snapshot of count elements, read back into bytes. returns its size, -1 on failure */
+static long snapshotOf(int count, unsigned char* bytes, long size){
+    PriorityQueue queue = createIntQueue();
+    FILE* file = tmpfile();
+    for(int i = 0; queue != NULL && i < count; i++){
+        insertInt(queue, i, count - i);
+    }
+    long length = -1;
+    if(queue != NULL && file != NULL && pqSave(queue, fileno(file), serializeInt, serializeInt) == PQ_SUCCESS){
+        length = pread(fileno(file), bytes, size, 0);
+    }
+    pqDestroy(queue);
+    if(file != NULL){
+        fclose(file);
+    }
+    return length;
+}
+
+/* loads a queue from bytes written to a temporary file */
+static PriorityQueue loadBytes(const unsigned char* bytes, long size){
+    FILE* file = tmpfile();
+    if(file == NULL){
+        return NULL;
+    }
+    PriorityQueue queue = NULL;
+    if(write(fileno(file), bytes, size) == size && lseek(fileno(file), 0, SEEK_SET) == 0){
+        queue = loadIntQueue(fileno(file));
+    }
+    fclose(file);
+    return queue;
+}
+
+static bool testSaveAndLoad(void){
+    unsigned char bytes[1024];
+    long size = snapshotOf(20, bytes, sizeof(bytes));
+    ASSERT_TEST(size > 0);
+    PriorityQueue queue = loadBytes(bytes, size);
+    ASSERT_TEST(queue != NULL && pqGetSize(queue) == 20);
+    int expected[20];
+    for(int i = 0; i < 20; i++){
+        expected[i] = i;
+    }
+    ASSERT_TEST(iteratesAs(queue, expected, 20));
+    pqDestroy(queue);
+    bytes[size / 2] ^= 1;
+    ASSERT_TEST(loadBytes(bytes, size) == NULL);
+    ASSERT_TEST(loadBytes(bytes, size - 1) == NULL);
+    return true;
+}
+
+static bool testLoadRejectsForgedSizes(void){
+    unsigned char bytes[1024];
+    long size = snapshotOf(3, bytes, sizeof(bytes));
+    ASSERT_TEST(size > 0);
+    //the element count follows the magic and the version:
+    unsigned char forged[1024];
+    memcpy(forged, bytes, size);
+    forged[8] = 0x00, forged[9] = 0x00, forged[10] = 0x00, forged[11] = 0x01;
+    ASSERT_TEST(loadBytes(forged, size) == NULL);
+    //and the first element's size follows the count:
+    memcpy(forged, bytes, size);
+    forged[16] = 0xFF, forged[17] = 0xFF, forged[18] = 0xFF, forged[19] = 0x7F;
+    ASSERT_TEST(loadBytes(forged, size) == NULL);
+    return true;
+}
+
+/* operations that change nothing do not count as changes, so a cursor outlives them */
+static bool testFailedChangesKeepCursorsValid(void){
+    PriorityQueue queue = pqCreateBounded(4, copyInt, freeInt, equalInts, copyInt, freeInt, compareInts);
+    ASSERT_TEST(queue != NULL);
+    ASSERT_TEST(pqSetCopyOnWrite(queue, true) == PQ_SUCCESS);
+    for(int i = 1; i <= 4; i++){
+        ASSERT_TEST(insertInt(queue, i, i) == PQ_SUCCESS);
+    }
+    PriorityQueue copy = pqCopy(queue);
+    ASSERT_TEST(copy != NULL);
+    PQCursor cursor = pqCursorOpen(queue);
+    ASSERT_TEST(cursor != NULL);
+    ASSERT_TEST(*(int*)pqCursorNext(cursor) == 4);
+    int missing = 9, priority = 1;
+    PQHandle handle = 0;
+    ASSERT_TEST(pqRemoveElement(queue, &missing) == PQ_ELEMENT_DOES_NOT_EXISTS);
+    ASSERT_TEST(pqChangePriority(queue, &missing, &priority, &priority) == PQ_ELEMENT_DOES_NOT_EXISTS);
+    ASSERT_TEST(pqChangePriority(queue, &missing, &priority, NULL) == PQ_NULL_ARGUMENT);
+    ASSERT_TEST(pqInsertWithHandle(queue, &missing, &priority, &handle) == PQ_SUCCESS);
+    ASSERT_TEST(handle == PQ_INVALID_HANDLE);
+    ASSERT_TEST(pqRemoveByHandle(queue, handle) == PQ_ITEM_DOES_NOT_EXIST);
+    ASSERT_TEST(pqChangePriorityByHandle(queue, handle, &priority) == PQ_ITEM_DOES_NOT_EXIST);
+    ASSERT_TEST(pqInsertBatch(queue, NULL, NULL, 0) == PQ_SUCCESS);
+    ASSERT_TEST(pqPopTake(queue, NULL, NULL) == PQ_NULL_ARGUMENT);
+    for(int expected = 3; expected >= 1; expected--){
+        int* element = pqCursorNext(cursor);
+        ASSERT_TEST(element != NULL && *element == expected);
+    }
+    pqCursorClose(cursor);
+    ASSERT_TEST(pqGetSize(queue) == 4 && pqGetSize(copy) == 4);
+    pqDestroy(queue);
+    pqDestroy(copy);
+    return true;
+}
+
+/* iterates over a queue sharing its content with others, see testCopiesIterateConcurrently */
+static void* iterateRepeatedly(void* queue){
+    for(int round = 0; round < 100; round++){
+        int expected = 99;
+        PQ_FOREACH(int*, element, queue){
+            if(*element != expected){
+                return NULL;
+            }
+            expected--;
+        }
+        if(expected != -1){
+            return NULL;
+        }
+    }
+    return queue;
+}
+
+static bool testCopiesIterateConcurrently(void){
+    PriorityQueue queues[4] = {createIntQueue()};
+    ASSERT_TEST(queues[0] != NULL);
+    ASSERT_TEST(pqSetCopyOnWrite(queues[0], true) == PQ_SUCCESS);
+    for(int i = 0; i < 100; i++){
+        ASSERT_TEST(insertInt(queues[0], i, i) == PQ_SUCCESS);
+    }
+    for(int i = 1; i < 4; i++){
+        queues[i] = pqCopy(queues[0]);
+        ASSERT_TEST(queues[i] != NULL);
+    }
+    pthread_t threads[4];
+    for(int i = 0; i < 4; i++){
+        ASSERT_TEST(pthread_create(&threads[i], NULL, iterateRepeatedly, queues[i]) == 0);
+    }
+    bool iterated = true;
+    for(int i = 0; i < 4; i++){
+        void* result;
+        pthread_join(threads[i], &result);
+        iterated = iterated && result == queues[i];
+    }
+    ASSERT_TEST(iterated);
+    //the copies still share, and each keeps its own order after another changes:
+    ASSERT_TEST(pqRemove(queues[1]) == PQ_SUCCESS);
+    ASSERT_TEST(iterateRepeatedly(queues[2]) == queues[2]);
+    for(int i = 0; i < 4; i++){
+        pqDestroy(queues[i]);
+    }
+    return true;
+}
+
+/* the number of calls to operation in its latency histogram */
+static unsigned long long latencySamples(const PQStats* stats, PQOperation operation){
+    unsigned long long samples = 0;
+    for(int i = 0; i < PQ_STATS_HISTOGRAM_BUCKETS; i++){
+        samples += stats->latency[operation][i];
+    }
+    return samples;
+}
+
+static bool testStatistics(void){
+    PriorityQueue queue = createIntQueue();
+    ASSERT_TEST(queue != NULL);
+    PQStats stats;
+    ASSERT_TEST(pqGetStats(queue, &stats) == PQ_ERROR);
+    ASSERT_TEST(pqEnableStats(queue, true) == PQ_SUCCESS);
+    for(int i = 0; i < 3; i++){
+        ASSERT_TEST(insertInt(queue, i, i) == PQ_SUCCESS);
+    }
+    ASSERT_TEST(pqRemove(queue) == PQ_SUCCESS);
+    int element = 0;
+    ASSERT_TEST(pqContains(queue, &element));
+    ASSERT_TEST(pqGetStats(queue, &stats) == PQ_SUCCESS);
+    ASSERT_TEST(stats.size == 2 && stats.inserts == 3 && stats.removes == 1);
+    ASSERT_TEST(stats.element_copies == 3 && stats.priority_copies == 3);
+    ASSERT_TEST(stats.element_frees == 1 && stats.priority_frees == 1);
+    ASSERT_TEST(stats.comparisons > 0 && stats.equality_checks > 0);
+    ASSERT_TEST(latencySamples(&stats, PQ_OPERATION_INSERT) == 3);
+    ASSERT_TEST(latencySamples(&stats, PQ_OPERATION_REMOVE) == 1);
+    ASSERT_TEST(latencySamples(&stats, PQ_OPERATION_CONTAINS) == 1);
+    ASSERT_TEST(pqResetStats(queue) == PQ_SUCCESS);
+    ASSERT_TEST(pqGetStats(queue, &stats) == PQ_SUCCESS);
+    ASSERT_TEST(stats.size == 2 && stats.inserts == 0 && latencySamples(&stats, PQ_OPERATION_INSERT) == 0);
+    ASSERT_TEST(pqEnableStats(queue, false) == PQ_SUCCESS);
+    ASSERT_TEST(pqGetStats(queue, &stats) == PQ_ERROR);
+    pqDestroy(queue);
+    return true;
+}
+
+static unsigned int hashInt(PQElement element){
+    return (unsigned int)*(int*)element;
+}
+
+static bool testIndexedLookups(void){
+    PriorityQueue queue = pqCreateIndexed(copyInt, freeInt, equalInts, hashInt, copyInt, freeInt, compareInts);
+    ASSERT_TEST(queue != NULL);
+    ASSERT_TEST(pqCreateIndexed(copyInt, freeInt, equalInts, NULL, copyInt, freeInt, compareInts) == NULL);
+    for(int i = 0; i < 100; i++){
+        ASSERT_TEST(insertInt(queue, i, i) == PQ_SUCCESS);
+    }
+    int element = 42, old_priority = 42, new_priority = 1000, missing = 100;
+    ASSERT_TEST(pqContains(queue, &element));
+    ASSERT_TEST(!pqContains(queue, &missing));
+    ASSERT_TEST(pqChangePriority(queue, &element, &new_priority, &old_priority) == PQ_ELEMENT_DOES_NOT_EXISTS);
+    ASSERT_TEST(pqChangePriority(queue, &element, &old_priority, &new_priority) == PQ_SUCCESS);
+    ASSERT_TEST(*(int*)pqGetFirst(queue) == 42);
+    ASSERT_TEST(pqRemoveElement(queue, &element) == PQ_SUCCESS);
+    ASSERT_TEST(!pqContains(queue, &element));
+    ASSERT_TEST(pqRemoveElement(queue, &element) == PQ_ELEMENT_DOES_NOT_EXISTS);
+    ASSERT_TEST(pqGetSize(queue) == 99 && *(int*)pqGetFirst(queue) == 99);
+    //the index follows elements moved by removals:
+    for(int i = 99; i >= 0; i--){
+        if(i != 42){
+            ASSERT_TEST(pqContains(queue, &i) && *(int*)pqGetFirst(queue) == i);
+            ASSERT_TEST(pqRemove(queue) == PQ_SUCCESS);
+        }
+    }
+    ASSERT_TEST(pqGetSize(queue) == 0);
+    pqDestroy(queue);
+    return true;
+}
+
+static bool testHandles(void){
+    PriorityQueue queue = createIntQueue();
+    ASSERT_TEST(queue != NULL);
+    PQHandle handles[5];
+    for(int i = 0; i < 5; i++){
+        int priority = i;
+        ASSERT_TEST(pqInsertWithHandle(queue, &i, &priority, &handles[i]) == PQ_SUCCESS);
+        ASSERT_TEST(handles[i] != PQ_INVALID_HANDLE);
+    }
+    ASSERT_TEST(*(int*)pqGetByHandle(queue, handles[2]) == 2);
+    int top = 10, bottom = -1;
+    ASSERT_TEST(pqChangePriorityByHandle(queue, handles[0], &top) == PQ_SUCCESS);
+    ASSERT_TEST(pqChangePriorityByHandle(queue, handles[4], &bottom) == PQ_SUCCESS);
+    ASSERT_TEST(pqRemoveByHandle(queue, handles[2]) == PQ_SUCCESS);
+    ASSERT_TEST(iteratesAs(queue, (int[]){0, 3, 1, 4}, 4));
+    //the handles of moved elements still refer to them, and the removed one's is stale:
+    ASSERT_TEST(*(int*)pqGetByHandle(queue, handles[4]) == 4 && *(int*)pqGetByHandle(queue, handles[0]) == 0);
+    ASSERT_TEST(pqGetByHandle(queue, handles[2]) == NULL);
+    ASSERT_TEST(pqRemoveByHandle(queue, handles[2]) == PQ_ITEM_DOES_NOT_EXIST);
+    ASSERT_TEST(pqChangePriorityByHandle(queue, handles[2], &top) == PQ_ITEM_DOES_NOT_EXIST);
+    ASSERT_TEST(pqRemove(queue) == PQ_SUCCESS);
+    ASSERT_TEST(pqGetByHandle(queue, handles[0]) == NULL);
+    //a copy's handles are the original's:
+    PriorityQueue copy = pqCopy(queue);
+    ASSERT_TEST(copy != NULL);
+    ASSERT_TEST(pqRemoveByHandle(copy, handles[3]) == PQ_SUCCESS);
+    ASSERT_TEST(*(int*)pqGetByHandle(queue, handles[3]) == 3 && pqGetByHandle(copy, handles[3]) == NULL);
+    ASSERT_TEST(pqChangePriorityByHandle(queue, handles[1], NULL) == PQ_NULL_ARGUMENT);
+    pqDestroy(copy);
+    pqDestroy(queue);
+    return true;
+}
+
+static bool testShrinkToFitKeepsElements(void){
+    PriorityQueue queue = createIntQueue();
+    ASSERT_TEST(queue != NULL);
+    ASSERT_TEST(pqShrinkToFit(NULL) == PQ_NULL_ARGUMENT);
+    ASSERT_TEST(pqShrinkToFit(queue) == PQ_SUCCESS);
+    PQHandle kept[3];
+    for(int i = 0; i < 3; i++){
+        int priority = i - 3;
+        ASSERT_TEST(pqInsertWithHandle(queue, &i, &priority, &kept[i]) == PQ_SUCCESS);
+    }
+    //a spike of insertions that is removed again:
+    for(int i = 3; i < 10000; i++){
+        ASSERT_TEST(insertInt(queue, i, i) == PQ_SUCCESS);
+    }
+    ASSERT_TEST(pqRemoveByHandle(queue, kept[1]) == PQ_SUCCESS);
+    while(pqGetSize(queue) > 2){
+        ASSERT_TEST(pqRemove(queue) == PQ_SUCCESS);
+    }
+    ASSERT_TEST(pqShrinkToFit(queue) == PQ_SUCCESS);
+    ASSERT_TEST(*(int*)pqGetFirst(queue) == 2);
+    ASSERT_TEST(pqShrinkToFit(queue) == PQ_SUCCESS);
+    //the iterator and the handles are not affected:
+    ASSERT_TEST(*(int*)pqGetNext(queue) == 0);
+    ASSERT_TEST(*(int*)pqGetByHandle(queue, kept[0]) == 0 && *(int*)pqGetByHandle(queue, kept[2]) == 2);
+    ASSERT_TEST(pqGetByHandle(queue, kept[1]) == NULL);
+    //and the queue still grows afterwards:
+    for(int i = 3; i < 100; i++){
+        ASSERT_TEST(insertInt(queue, i, i) == PQ_SUCCESS);
+    }
+    ASSERT_TEST(pqGetSize(queue) == 99 && *(int*)pqGetFirst(queue) == 99);
+    pqDestroy(queue);
+    return true;
+}
+
+static bool testTakeAndPopTransferOwnership(void){
+    PriorityQueue queue = createIntQueue();
+    ASSERT_TEST(queue != NULL);
+    int value = 7;
+    int* element = copyInt(&value);
+    int* priority = copyInt(&value);
+    ASSERT_TEST(pqInsertTake(queue, NULL, priority) == PQ_NULL_ARGUMENT);
+    //the queue adopts the pointers themselves:
+    ASSERT_TEST(pqInsertTake(queue, element, priority) == PQ_SUCCESS);
+    ASSERT_TEST(pqGetFirst(queue) == element && pqGetFirstPriority(queue) == priority);
+    ASSERT_TEST(insertInt(queue, 3, 3) == PQ_SUCCESS);
+    PQElement popped_element = NULL;
+    PQElementPriority popped_priority = NULL;
+    ASSERT_TEST(pqPopTake(queue, NULL, &popped_priority) == PQ_NULL_ARGUMENT);
+    ASSERT_TEST(pqPopTake(queue, &popped_element, &popped_priority) == PQ_SUCCESS);
+    ASSERT_TEST(popped_element == element && popped_priority == priority);
+    freeInt(popped_element);
+    freeInt(popped_priority);
+    //without a place for the priority the queue frees it:
+    ASSERT_TEST(pqPopTake(queue, &popped_element, NULL) == PQ_SUCCESS);
+    ASSERT_TEST(*(int*)popped_element == 3 && pqGetSize(queue) == 0);
+    freeInt(popped_element);
+    ASSERT_TEST(pqPopTake(queue, &popped_element, NULL) == PQ_ELEMENT_DOES_NOT_EXISTS);
+    pqDestroy(queue);
+    return true;
+}
+
+#define BATCH_SIZE 64
+
+/* fills expected with the order of the elements i of priority i % 4 for every i below BATCH_SIZE, with
+   batch_count elements from BATCH_SIZE on, of priority 3, after them. returns the number of elements */
+static int batchOrder(int* expected, int batch_count){
+    int count = 0;
+    for(int priority = 3; priority >= 0; priority--){
+        for(int i = priority; i < BATCH_SIZE; i += 4){
+            expected[count++] = i;
+        }
+        for(int i = 0; priority == 3 && i < batch_count; i++){
+            expected[count++] = BATCH_SIZE + i;
+        }
+    }
+    return count;
+}
+
+static bool testBuildFromArrayAndBatches(void){
+    int values[BATCH_SIZE], priorities[BATCH_SIZE];
+    PQElement elements[BATCH_SIZE];
+    PQElementPriority element_priorities[BATCH_SIZE];
+    for(int i = 0; i < BATCH_SIZE; i++){
+        values[i] = i;
+        priorities[i] = i % 4;
+        elements[i] = &values[i];
+        element_priorities[i] = &priorities[i];
+    }
+    PriorityQueue queue = pqCreateFromArray(copyInt, freeInt, equalInts, copyInt, freeInt, compareInts,
+                                            elements, element_priorities, BATCH_SIZE);
+    ASSERT_TEST(queue != NULL && pqGetSize(queue) == BATCH_SIZE);
+    //ties keep the array order, as if the elements were inserted one by one:
+    int expected[BATCH_SIZE * 2];
+    ASSERT_TEST(iteratesAs(queue, expected, batchOrder(expected, 0)));
+    //a batch goes after the queued elements of the same priority, in array order:
+    for(int i = 0; i < BATCH_SIZE; i++){
+        values[i] = BATCH_SIZE + i;
+        priorities[i] = 3;
+    }
+    ASSERT_TEST(pqInsertBatch(queue, elements, element_priorities, 1) == PQ_SUCCESS);
+    ASSERT_TEST(pqInsertBatch(queue, elements + 1, element_priorities + 1, BATCH_SIZE - 1) == PQ_SUCCESS);
+    ASSERT_TEST(pqGetSize(queue) == 2 * BATCH_SIZE);
+    ASSERT_TEST(iteratesAs(queue, expected, batchOrder(expected, BATCH_SIZE)));
+    //a failed batch adds nothing:
+    ASSERT_TEST(pqInsertBatch(queue, elements, element_priorities, -1) == PQ_ERROR);
+    element_priorities[BATCH_SIZE - 1] = NULL;
+    ASSERT_TEST(pqInsertBatch(queue, elements, element_priorities, BATCH_SIZE) == PQ_NULL_ARGUMENT);
+    ASSERT_TEST(pqGetSize(queue) == 2 * BATCH_SIZE);
+    ASSERT_TEST(pqCreateFromArray(copyInt, freeInt, equalInts, copyInt, freeInt, compareInts,
+                                  elements, element_priorities, BATCH_SIZE) == NULL);
+    ASSERT_TEST(pqCreateFromArray(copyInt, freeInt, equalInts, copyInt, freeInt, compareInts,
+                                  elements, element_priorities, -1) == NULL);
+    PriorityQueue empty = pqCreateFromArray(copyInt, freeInt, equalInts, copyInt, freeInt, compareInts,
+                                            elements, element_priorities, 0);
+    ASSERT_TEST(empty != NULL && pqGetSize(empty) == 0);
+    pqDestroy(empty);
+    pqDestroy(queue);
+    return true;
+}
+
+/* whether the priority is at least the int context points to */
+static bool isAtLeast(PQElement element, PQElementPriority priority, void* context){
+    return *(int*)priority >= *(int*)context;
+}
+
+static bool testPopBatchAndDrainWhile(void){
+    PriorityQueue queue = createIntQueue();
+    ASSERT_TEST(queue != NULL);
+    for(int i = 0; i < 10; i++){
+        ASSERT_TEST(insertInt(queue, i, i) == PQ_SUCCESS);
+    }
+    PQElement elements[10];
+    PQElementPriority priorities[10];
+    ASSERT_TEST(pqPopBatch(queue, -1, elements, priorities) == -1);
+    ASSERT_TEST(pqPopBatch(queue, 1, NULL, priorities) == -1);
+    ASSERT_TEST(pqPopBatch(queue, 0, elements, priorities) == 0);
+    ASSERT_TEST(pqPopBatch(queue, 3, elements, priorities) == 3);
+    for(int i = 0; i < 3; i++){
+        ASSERT_TEST(*(int*)elements[i] == 9 - i && *(int*)priorities[i] == 9 - i);
+        freeInt(elements[i]);
+        freeInt(priorities[i]);
+    }
+    int threshold = 4;
+    ASSERT_TEST(pqDrainWhile(queue, NULL, &threshold, elements, NULL, 10) == -1);
+    //stops at the capacity, and then at the first element the predicate rejects:
+    ASSERT_TEST(pqDrainWhile(queue, isAtLeast, &threshold, elements, NULL, 2) == 2);
+    ASSERT_TEST(*(int*)elements[0] == 6 && *(int*)elements[1] == 5);
+    freeInt(elements[0]);
+    freeInt(elements[1]);
+    ASSERT_TEST(pqDrainWhile(queue, isAtLeast, &threshold, elements, priorities, 10) == 1);
+    ASSERT_TEST(*(int*)elements[0] == 4 && *(int*)priorities[0] == 4);
+    freeInt(elements[0]);
+    freeInt(priorities[0]);
+    ASSERT_TEST(pqDrainWhile(queue, isAtLeast, &threshold, elements, NULL, 10) == 0);
+    ASSERT_TEST(pqGetSize(queue) == 4);
+    //a batch larger than the queue takes all of it:
+    ASSERT_TEST(pqPopBatch(queue, 10, elements, NULL) == 4);
+    for(int i = 0; i < 4; i++){
+        ASSERT_TEST(*(int*)elements[i] == 3 - i);
+        freeInt(elements[i]);
+    }
+    ASSERT_TEST(pqGetSize(queue) == 0);
+    pqDestroy(queue);
+    return true;
+}
+
+static int compareIntsReversed(PQElementPriority first, PQElementPriority second){
+    return compareInts(second, first);
+}
+
+static bool testMeld(void){
+    PriorityQueue destination = createIntQueue();
+    PriorityQueue small = createIntQueue();
+    PriorityQueue large = createIntQueue();
+    ASSERT_TEST(destination != NULL && small != NULL && large != NULL);
+    PQHandle handle;
+    int element = 0, priority = 1;
+    ASSERT_TEST(pqInsertWithHandle(destination, &element, &priority, &handle) == PQ_SUCCESS);
+    ASSERT_TEST(insertInt(destination, 1, 2) == PQ_SUCCESS);
+    ASSERT_TEST(insertInt(destination, 2, 1) == PQ_SUCCESS);
+    ASSERT_TEST(insertInt(small, 10, 1) == PQ_SUCCESS);
+    for(int i = 20; i < 26; i++){
+        ASSERT_TEST(insertInt(large, i, i % 2 + 1) == PQ_SUCCESS);
+    }
+    //source's elements go after destination's of the same priority, whichever queue is larger:
+    ASSERT_TEST(pqMeld(destination, small) == PQ_SUCCESS);
+    ASSERT_TEST(pqGetSize(small) == 0);
+    ASSERT_TEST(iteratesAs(destination, (int[]){1, 0, 2, 10}, 4));
+    ASSERT_TEST(pqMeld(destination, large) == PQ_SUCCESS);
+    ASSERT_TEST(pqGetSize(large) == 0);
+    ASSERT_TEST(iteratesAs(destination, (int[]){1, 21, 23, 25, 0, 2, 10, 20, 22, 24}, 10));
+    ASSERT_TEST(*(int*)pqGetByHandle(destination, handle) == 0);
+    //a source that is empty, the destination itself, or created with other functions:
+    ASSERT_TEST(pqMeld(destination, small) == PQ_SUCCESS && pqGetSize(destination) == 10);
+    ASSERT_TEST(pqMeld(destination, destination) == PQ_ERROR);
+    ASSERT_TEST(pqMeld(destination, NULL) == PQ_NULL_ARGUMENT);
+    PriorityQueue reversed = pqCreate(copyInt, freeInt, equalInts, copyInt, freeInt, compareIntsReversed);
+    ASSERT_TEST(reversed != NULL && insertInt(reversed, 30, 1) == PQ_SUCCESS);
+    ASSERT_TEST(pqMeld(destination, reversed) == PQ_ERROR);
+    ASSERT_TEST(pqGetSize(destination) == 10 && pqGetSize(reversed) == 1);
+    pqDestroy(reversed);
+    pqDestroy(large);
+    pqDestroy(small);
+    pqDestroy(destination);
+    return true;
+}
+
+#define CONCURRENT_THREADS 4
+#define INSERTS_PER_THREAD 2000
+
+/* what a thread of testConcurrentInsertsAndPops inserts and pops */
+typedef struct ConcurrentWork_t {
+    PriorityQueue queue;
+    int first;
+    int popped[INSERTS_PER_THREAD];
+    int popped_count;
+    bool failed;
+} ConcurrentWork;
+
+/* inserts INSERTS_PER_THREAD elements from work->first on, popping an element after every other insert */
+static void* insertAndPop(void* argument){
+    ConcurrentWork* work = argument;
+    for(int i = 0; i < INSERTS_PER_THREAD; i++){
+        int element = work->first + i;
+        if(pqInsert(work->queue, &element, &element) != PQ_SUCCESS){
+            work->failed = true;
+        }
+        PQElement popped;
+        if(i % 2 == 1 && pqPopTake(work->queue, &popped, NULL) == PQ_SUCCESS){
+            work->popped[work->popped_count++] = *(int*)popped;
+            freeInt(popped);
+        }
+    }
+    return NULL;
+}
+
+static bool testConcurrentInsertsAndPops(void){
+    PriorityQueue queue = pqCreateConcurrent(copyInt, freeInt, equalInts, copyInt, freeInt, compareInts);
+    ASSERT_TEST(queue != NULL);
+    static ConcurrentWork works[CONCURRENT_THREADS];
+    pthread_t threads[CONCURRENT_THREADS];
+    for(int i = 0; i < CONCURRENT_THREADS; i++){
+        works[i] = (ConcurrentWork){.queue = queue, .first = i * INSERTS_PER_THREAD};
+        ASSERT_TEST(pthread_create(&threads[i], NULL, insertAndPop, &works[i]) == 0);
+    }
+    for(int i = 0; i < CONCURRENT_THREADS; i++){
+        pthread_join(threads[i], NULL);
+    }
+    //every element inserted is either popped by a thread or still queued, exactly once:
+    static bool seen[CONCURRENT_THREADS * INSERTS_PER_THREAD];
+    int popped_total = 0;
+    for(int i = 0; i < CONCURRENT_THREADS; i++){
+        ASSERT_TEST(!works[i].failed);
+        for(int j = 0; j < works[i].popped_count; j++){
+            ASSERT_TEST(!seen[works[i].popped[j]]);
+            seen[works[i].popped[j]] = true;
+        }
+        popped_total += works[i].popped_count;
+    }
+    ASSERT_TEST(popped_total == CONCURRENT_THREADS * INSERTS_PER_THREAD / 2);
+    ASSERT_TEST(pqGetSize(queue) == CONCURRENT_THREADS * INSERTS_PER_THREAD - popped_total);
+    int previous = CONCURRENT_THREADS * INSERTS_PER_THREAD;
+    PQElement element;
+    while(pqPopTake(queue, &element, NULL) == PQ_SUCCESS){
+        int value = *(int*)element;
+        freeInt(element);
+        ASSERT_TEST(value < previous && !seen[value]);
+        seen[value] = true;
+        previous = value;
+    }
+    ASSERT_TEST(pqGetSize(queue) == 0);
+    pqDestroy(queue);
+    return true;
+}
+
+static bool testBoundedKeepsTheBest(void){
+    ASSERT_TEST(pqCreateBounded(0, copyInt, freeInt, equalInts, copyInt, freeInt, compareInts) == NULL);
+    PriorityQueue queue = pqCreateBounded(3, copyInt, freeInt, equalInts, copyInt, freeInt, compareInts);
+    ASSERT_TEST(queue != NULL);
+    for(int i = 1; i <= 3; i++){
+        ASSERT_TEST(insertInt(queue, i, i) == PQ_SUCCESS);
+    }
+    //an insert that is not above the lowest priority is dropped:
+    PQHandle handle;
+    int element = 4, priority = 1;
+    ASSERT_TEST(pqInsertWithHandle(queue, &element, &priority, &handle) == PQ_SUCCESS);
+    ASSERT_TEST(handle == PQ_INVALID_HANDLE);
+    ASSERT_TEST(pqInsertTake(queue, copyInt(&element), copyInt(&priority)) == PQ_SUCCESS);
+    ASSERT_TEST(iteratesAs(queue, (int[]){3, 2, 1}, 3));
+    //any other insert evicts the element that would come last:
+    ASSERT_TEST(insertInt(queue, 5, 2) == PQ_SUCCESS);
+    ASSERT_TEST(iteratesAs(queue, (int[]){3, 2, 5}, 3));
+    ASSERT_TEST(insertInt(queue, 6, 10) == PQ_SUCCESS);
+    ASSERT_TEST(iteratesAs(queue, (int[]){6, 3, 2}, 3));
+    //a copy has the same capacity:
+    PriorityQueue copy = pqCopy(queue);
+    ASSERT_TEST(copy != NULL);
+    ASSERT_TEST(insertInt(copy, 7, 5) == PQ_SUCCESS);
+    ASSERT_TEST(iteratesAs(copy, (int[]){6, 7, 3}, 3));
+    //once an element is removed there is room again:
+    ASSERT_TEST(pqRemove(queue) == PQ_SUCCESS);
+    ASSERT_TEST(insertInt(queue, 8, 0) == PQ_SUCCESS);
+    ASSERT_TEST(iteratesAs(queue, (int[]){3, 2, 8}, 3));
+    pqDestroy(copy);
+    pqDestroy(queue);
+    return true;
+}
+
+/*=========================================================================*/
+
+int main(void){
+    int failed = 0;
+    RUN_TEST(testHeapOrder, failed);
+    RUN_TEST(testEqualPrioritiesKeepInsertionOrder, failed);
+    RUN_TEST(testChangePriorityAndRemoveElement, failed);
+    RUN_TEST(testCopyAndClear, failed);
+    RUN_TEST(testNullArguments, failed);
+    RUN_TEST(testCursorSurvivesCopyOnWriteCopy, failed);
+    RUN_TEST(testSaveAndLoad, failed);
+    RUN_TEST(testLoadRejectsForgedSizes, failed);
+    RUN_TEST(testFailedChangesKeepCursorsValid, failed);
+    RUN_TEST(testCopiesIterateConcurrently, failed);
+    RUN_TEST(testStatistics, failed);
+    RUN_TEST(testIndexedLookups, failed);
+    RUN_TEST(testHandles, failed);
+    RUN_TEST(testShrinkToFitKeepsElements, failed);
+    RUN_TEST(testTakeAndPopTransferOwnership, failed);
+    RUN_TEST(testBuildFromArrayAndBatches, failed);
+    RUN_TEST(testPopBatchAndDrainWhile, failed);
+    RUN_TEST(testMeld, failed);
+    RUN_TEST(testConcurrentInsertsAndPops, failed);
+    RUN_TEST(testBoundedKeepsTheBest, failed);
+    return TEST_EXIT_STATUS(failed);
+}
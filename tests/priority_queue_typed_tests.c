@@ -0,0 +1,75 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "test_utilities.h"
+#include "../priority_queue_typed.h"
+
+/* ints keyed by int, the lower key comes first */
+PQ_DEFINE(IntQueue, int, int, b - a, x == y)
+
+/* whether iterating over queue gives exactly the count elements of expected, in order */
+static bool iteratesAs(IntQueue queue, const int* expected, int count){
+    int i = 0;
+    PQ_TYPED_FOREACH(IntQueue, int, element, queue){
+        if(i == count || *element != expected[i]){
+            return false;
+        }
+        i++;
+    }
+    return i == count;
+}
+
+static bool testOrderAndTies(void){
+    IntQueue queue = IntQueueCreate();
+    ASSERT_TEST(queue != NULL);
+    //more than the initial capacity, so the heap grows:
+    for(int i = 0; i < 20; i++){
+        ASSERT_TEST(IntQueueInsert(queue, i, i % 4) == PQ_SUCCESS);
+    }
+    ASSERT_TEST(IntQueueGetSize(queue) == 20);
+    int expected[20];
+    for(int i = 0; i < 20; i++){
+        expected[i] = (i % 5) * 4 + i / 5;
+    }
+    ASSERT_TEST(iteratesAs(queue, expected, 20));
+    int element, priority;
+    for(int i = 0; i < 20; i++){
+        ASSERT_TEST(IntQueuePop(queue, &element, &priority) == PQ_SUCCESS);
+        ASSERT_TEST(element == expected[i] && priority == expected[i] % 4);
+    }
+    ASSERT_TEST(IntQueuePop(queue, &element, NULL) == PQ_ELEMENT_DOES_NOT_EXISTS);
+    ASSERT_TEST(IntQueueGetFirst(queue) == NULL);
+    IntQueueDestroy(queue);
+    return true;
+}
+
+static bool testChangesAndCopy(void){
+    IntQueue queue = IntQueueCreate();
+    ASSERT_TEST(queue != NULL);
+    for(int i = 1; i <= 4; i++){
+        ASSERT_TEST(IntQueueInsert(queue, i, i) == PQ_SUCCESS);
+    }
+    ASSERT_TEST(IntQueueContains(queue, 3) && !IntQueueContains(queue, 5));
+    ASSERT_TEST(IntQueueChangePriority(queue, 3, 1, 0) == PQ_ELEMENT_DOES_NOT_EXISTS);
+    ASSERT_TEST(IntQueueChangePriority(queue, 3, 3, 0) == PQ_SUCCESS);
+    ASSERT_TEST(IntQueueRemoveElement(queue, 2) == PQ_SUCCESS);
+    ASSERT_TEST(IntQueueRemoveElement(queue, 2) == PQ_ELEMENT_DOES_NOT_EXISTS);
+    ASSERT_TEST(iteratesAs(queue, (int[]){3, 1, 4}, 3));
+    IntQueue copy = IntQueueCopy(queue);
+    ASSERT_TEST(copy != NULL);
+    ASSERT_TEST(IntQueueRemove(queue) == PQ_SUCCESS);
+    ASSERT_TEST(iteratesAs(queue, (int[]){1, 4}, 2));
+    ASSERT_TEST(iteratesAs(copy, (int[]){3, 1, 4}, 3));
+    ASSERT_TEST(IntQueueClear(copy) == PQ_SUCCESS && IntQueueGetSize(copy) == 0);
+    ASSERT_TEST(IntQueueInsert(NULL, 1, 1) == PQ_NULL_ARGUMENT);
+    ASSERT_TEST(IntQueueGetSize(NULL) == -1);
+    IntQueueDestroy(copy);
+    IntQueueDestroy(queue);
+    return true;
+}
+
+int main(void){
+    int failed = 0;
+    RUN_TEST(testOrderAndTies, failed);
+    RUN_TEST(testChangesAndCopy, failed);
+    return TEST_EXIT_STATUS(failed);
+}
@@ -0,0 +1,100 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "test_utilities.h"
+#include "../string_table.h"
+
+static bool testInternedStringsAreShared(void){
+    StringTable table = stringTableCreate();
+    ASSERT_TEST(table != NULL);
+    char name[] = "meeting";
+    const char* first = stringIntern(table, name);
+    const char* second = stringIntern(table, "meeting");
+    ASSERT_TEST(first != NULL && first == second && first != name);
+    ASSERT_TEST(strcmp(first, "meeting") == 0);
+    ASSERT_TEST(stringIntern(table, "lecture") != first);
+    ASSERT_TEST(stringFind(table, "meeting") == first);
+    ASSERT_TEST(stringFind(table, "party") == NULL);
+    ASSERT_TEST(stringIntern(table, NULL) == NULL && stringFind(table, NULL) == NULL);
+    stringRelease(first);
+    stringRelease(second);
+    stringRelease(stringFind(table, "lecture"));
+    stringTableDestroy(table);
+    return true;
+}
+
+static bool testTablesAreSeparate(void){
+    StringTable first_table = stringTableCreate();
+    StringTable second_table = stringTableCreate();
+    ASSERT_TEST(first_table != NULL && second_table != NULL);
+    const char* first = stringIntern(first_table, "meeting");
+    ASSERT_TEST(first != NULL);
+    ASSERT_TEST(stringFind(second_table, "meeting") == NULL);
+    const char* second = stringIntern(second_table, "meeting");
+    ASSERT_TEST(second != NULL && second != first);
+    stringRelease(first);
+    stringRelease(second);
+    stringTableDestroy(first_table);
+    stringTableDestroy(second_table);
+    return true;
+}
+
+static bool testLastReleaseRemovesTheString(void){
+    StringTable table = stringTableCreate();
+    ASSERT_TEST(table != NULL);
+    const char* interned = stringIntern(table, "meeting");
+    ASSERT_TEST(stringRetain(interned) == interned);
+    stringRelease(interned);
+    ASSERT_TEST(stringFind(table, "meeting") == interned);
+    stringRelease(interned);
+    ASSERT_TEST(stringFind(table, "meeting") == NULL);
+    stringRelease(NULL);
+    stringTableDestroy(table);
+    return true;
+}
+
+/* enough strings to make the table grow, each still found afterwards */
+static bool testManyStrings(void){
+    StringTable table = stringTableCreate();
+    ASSERT_TEST(table != NULL);
+    const char* interned[1000];
+    char name[16];
+    for(int i = 0; i < 1000; i++){
+        sprintf(name, "event%d", i);
+        interned[i] = stringIntern(table, name);
+        ASSERT_TEST(interned[i] != NULL);
+    }
+    for(int i = 0; i < 1000; i++){
+        sprintf(name, "event%d", i);
+        ASSERT_TEST(stringFind(table, name) == interned[i]);
+        stringRelease(interned[i]);
+    }
+    stringTableDestroy(table);
+    return true;
+}
+
+/* strings outlive the table they were interned in until they are released */
+static bool testDestroyedTableKeepsReferencedStrings(void){
+    StringTable table = stringTableCreate();
+    ASSERT_TEST(table != NULL);
+    const char* interned = stringIntern(table, "meeting");
+    ASSERT_TEST(interned != NULL);
+    stringTableDestroy(table);
+    ASSERT_TEST(strcmp(interned, "meeting") == 0);
+    ASSERT_TEST(stringRetain(interned) == interned);
+    stringRelease(interned);
+    stringRelease(interned);
+    stringTableDestroy(NULL);
+    return true;
+}
+
+int main(void){
+    int failed = 0;
+    RUN_TEST(testInternedStringsAreShared, failed);
+    RUN_TEST(testTablesAreSeparate, failed);
+    RUN_TEST(testLastReleaseRemovesTheString, failed);
+    RUN_TEST(testManyStrings, failed);
+    RUN_TEST(testDestroyedTableKeepsReferencedStrings, failed);
+    return TEST_EXIT_STATUS(failed);
+}
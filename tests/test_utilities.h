@@ -0,0 +1,37 @@
+#ifndef TEST_UTILITIES_H_
+#define TEST_UTILITIES_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+* Test Utilities
+*
+* A test is a function that takes no arguments and returns true if it passed. It checks its conditions
+* with ASSERT_TEST, which makes it print the failed condition and return false.
+* A test program runs its tests with RUN_TEST, counting the failed ones, and returns
+* TEST_EXIT_STATUS(failed) from main, so ctest sees whether every test passed.
+*/
+
+#define ASSERT_TEST(expr)                                                          \
+    do {                                                                           \
+        if (!(expr)) {                                                             \
+            printf("\nAssertion failed at %s:%d %s ", __FILE__, __LINE__, #expr);  \
+            return false;                                                          \
+        }                                                                          \
+    } while (0)
+
+#define RUN_TEST(test, failed)                  \
+    do {                                        \
+        printf("Running %s ... ", #test);       \
+        if (test()) {                           \
+            printf("[OK]\n");                   \
+        } else {                                \
+            printf("[Failed]\n");               \
+            (failed)++;                         \
+        }                                       \
+    } while (0)
+
+#define TEST_EXIT_STATUS(failed) ((failed) == 0 ? 0 : 1)
+
+#endif //TEST_UTILITIES_H_